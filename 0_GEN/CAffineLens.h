@@ -29,6 +29,7 @@ public:
     void UpdateTFormLHS( TAffine &T, int cam, bool inv );
 
     const TAffine& GetTf( int cam ) {return Tf[cam];};
+    const TAffine& GetTi( int cam ) {return Ti[cam];};
 };
 
 
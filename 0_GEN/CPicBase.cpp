@@ -250,13 +250,11 @@ void PicBase::MakeFFTExist( int i )
 // rapid intensity variation, usually, near object edges. This is
 // usually a few pixels, so choose {r1, r2} around {3, 6}.
 //
-// Note: We calc filter out to length = fltsz = 3 sigma = 3 x r2.
+// Note: Filter extends to 3 sigma = 3 x r2. See DoGFilter.
 //
-void PicBase::MakeDoGExist( vector<CD> &filter, int r1, int r2 )
+void PicBase::MakeDoGExist( int r1, int r2 )
 {
-    int		npix	= w * h,
-            fltsz	= 3 * r2;
-    int		i, x, y;
+    int	npix = w * h;
 
 // Early exit?
 
@@ -265,98 +263,29 @@ void PicBase::MakeDoGExist( vector<CD> &filter, int r1, int r2 )
 
     DoG.resize( npix );
 
-    if( r2 <= 0.0 ) {
+    if( r2 <= 0 ) {
         memcpy( &DoG[0], &raster[0], npix );
         return;
     }
 
-// Set FFT sizing
-
-    int	N = CeilPow2( max( w, h ) + fltsz );
-
-    printf( "MakeDoGExist: Using size %d\n", N );
-
-    int M = N * (N/2 + 1);	// size of array of complex coefficients
-
-// Construct filter
-
-    if( !filter.size() ) {
-
-        vector<double>	image( N * N, 0.0 );
-        double			sum1 = 0.0,	// for normalizing.
-                        sum2 = 0.0;	// each integral should = 2*pi
-
-        // they are not quite the same due to
-        // quantization and removal of tails.
-
-        for( x = -fltsz; x <= fltsz; ++x ) {
-
-            for( y = -fltsz; y <= fltsz; ++y ) {
-
-                double	rad2 = x*x + y*y;
-
-                sum1 += exp( -( rad2/(2*r1*r1) ) );
-                sum2 += exp( -( rad2/(2*r2*r2) ) );
-            }
-        }
-
-        printf( "MakeDoGExist: Check %f equals %f equals 2pi.\n",
-            sum1/(r1*r1), sum2/(r2*r2) );
-
-        for( x = -fltsz; x <= fltsz; ++x ) {
-
-            for( y = -fltsz; y <= fltsz; ++y ) {
-
-                double	rad2	= x*x + y*y;
-                double	v1		= exp( -( rad2/(2*r1*r1) ) );
-                double	v2		= exp( -( rad2/(2*r2*r2) ) );
-                int		ix		= (x >= 0 ? x : N + x);
-                int		iy		= (y >= 0 ? y : N + y);
-
-                image[ix + N*iy] = v1/sum1 - v2/sum2;
-            }
-        }
-
-        // Now fft it
-        FFT_2D( filter, image, N, N, false );
-    }
-
 // Normalize image values
 
     vector<double>	v( npix );
 
-    for( i = 0; i < npix; ++i )
+    for( int i = 0; i < npix; ++i )
         v[i] = raster[i];
 
     Normalize( v );
 
-// Copy values to the large image, then FFT
-
-    vector<double>	imag( N * N, 0.0 );
-    vector<CD>		freq;
-
-    CopyRaster( &imag[0], N, &v[0], w, w, h );
-
-    FFT_2D( freq, imag, N, N, false );
-
-// Convolve with filter
-
-    for( i = 0; i < M; ++i )
-        freq[i] *= filter[i];
-
-// FFT back
-
-    IFT_2D( imag, freq, N, N );
-
-// Copy back to v for normalization
+// Filter and renormalize
 
-    CopyRaster( &v[0], w, &imag[0], N, w, h );
+    DoGFilter( v, v, w, h, r1, r2 );
 
     Normalize( v );
 
 // Copy v to DoG
 
-    for( i = 0; i < npix; ++i ) {
+    for( int i = 0; i < npix; ++i ) {
 
         int pix	= 127 + int(32 * v[i]);
 
@@ -40,7 +40,7 @@ public:
     void CopyOriginal();
     void DownsampleIfNeeded( FILE* flog );
     void MakeFFTExist( int i );
-    void MakeDoGExist( vector<CD> &filter, int r1, int r2 );
+    void MakeDoGExist( int r1, int r2 );
 };
 
 
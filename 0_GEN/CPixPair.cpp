@@ -5,10 +5,14 @@
 #include	"Maths.h"
 #include	"CAffineLens.h"
 #include	"Correlation.h"
+#include	"EZThreads.h"
 #include	"Timer.h"
 
+#include	<math.h>
 #include	<string.h>
 
+#include	<list>
+
 
 /* --------------------------------------------------------------- */
 /* Macros -------------------------------------------------------- */
@@ -16,72 +20,35 @@
 
 #define	MAX1DPIX	2048
 
-
-
-
-
+// Lens threading: pixels per band, max bands.
+#define	LENS_THRPTS	(1024 * 1024)
+#define	LENS_MAXTHR	8
 
 /* --------------------------------------------------------------- */
-/* MakeDoGKernel ------------------------------------------------- */
+/* Types --------------------------------------------------------- */
 /* --------------------------------------------------------------- */
 
-// This is an edge enhancement filter. Each Gaussian is a blurring
-// filter that passes frequencies longer than its (inverse) standard
-// dev (here, specified as a radius). The difference, then, passes
-// frequencies between the two (inverse) radii: r1 < r2. The length
-// scale of interest is the number of pixels over which there is
-// rapid intensity variation, usually, near object edges. This is
-// usually a few pixels, so choose {r1, r2} around {3, 6}.
-//
-// Note: Radius of kernel: 3 sigma = 3 x r2.
+// Conditioned (flattened and optionally DoG filtered) full
+// size pixels of one tile, as kept in the tile cache.
 //
-static int MakeDoGKernel(
-    vector<double>	&DoG,
-    int				r1,
-    int				r2,
-    FILE*			flog )
-{
-    int	d = 3 * r2,
-        D = 2 * d + 1;
-
-// Normalization sums should ideally equal 2pi. They will differ
-// slightly due to quantization and the finite tail length.
-
-    double	sum1 = 0.0, sum2 = 0.0;
+class CondTile {
+public:
+    string			key;
+    vector<double>	vf, vfflt;
+    uint32			w, h;
+};
 
-    for( int y = -d; y <= d; ++y ) {
-
-        for( int x = -d; x <= d; ++x ) {
-
-            double	R = x*x + y*y;
-
-            sum1 += exp( -( R/(2*r1*r1) ) );
-            sum2 += exp( -( R/(2*r2*r2) ) );
-        }
-    }
-
-    fprintf( flog,
-    "MakeDoGKernel: Check %f equals %f equals 2pi.\n",
-    sum1/(r1*r1), sum2/(r2*r2) );
+/* --------------------------------------------------------------- */
+/* Statics ------------------------------------------------------- */
+/* --------------------------------------------------------------- */
 
-// Store values
+static list<CondTile>	cache;			// most recently used first
+static long				cachemax = 0;	// bytes; zero disables caching
 
-    DoG.resize( D * D );
 
-    for( int y = -d; y <= d; ++y ) {
 
-        for( int x = -d; x <= d; ++x ) {
 
-            double	R	= x*x + y*y;
-            double	v1	= exp( -( R/(2*r1*r1) ) );
-            double	v2	= exp( -( R/(2*r2*r2) ) );
 
-            DoG[x+d + D*(y+d)] = v1/sum1 - v2/sum2;
-        }
-    }
-
-    return D;
-}
 
 /* --------------------------------------------------------------- */
 /* PixPair::Downsample ------------------------------------------- */
@@ -170,6 +137,76 @@ static bool HasTissue( const char *path, FILE *flog )
 /* Lens ---------------------------------------------------------- */
 /* --------------------------------------------------------------- */
 
+// Lens correction is a gather: each dst row is walked in src
+// coords by inverse map Ti, stepping (t[0], t[3]) per pixel, and
+// bilinearly sampled. Src neighbors off the image count as zero,
+// so edges fade as before under the forward scatter. Rows are
+// split into bands over up to LENS_MAXTHR threads, made per call.
+
+class LensBand {
+public:
+    const double	*src;
+    double			*dst;
+    const TAffine	*Ti;
+    int				w, h, y0, ylim;
+};
+
+
+static void* _LensRows( void* arg )
+{
+    const LensBand	&B = *(LensBand*)arg;
+    const double	*t = B.Ti->t,
+                    *S = B.src;
+    int				w = B.w, h = B.h;
+
+    for( int y = B.y0; y < B.ylim; ++y ) {
+
+        double	*D = B.dst + w*y,
+                sx = t[1]*y + t[2],
+                sy = t[4]*y + t[5];
+
+        for( int x = 0; x < w; ++x, sx += t[0], sy += t[3] ) {
+
+            if( sx <= -1.0 || sx >= w || sy <= -1.0 || sy >= h ) {
+                D[x] = 0.0;
+                continue;
+            }
+
+            int		ix = (int)floor( sx ),
+                    iy = (int)floor( sy );
+            double	fx = sx - ix,
+                    fy = sy - iy,
+                    v00 = 0.0, v10 = 0.0,
+                    v01 = 0.0, v11 = 0.0;
+            int		i = ix + w*iy;
+
+            if( iy >= 0 ) {
+
+                if( ix >= 0 )
+                    v00 = S[i];
+
+                if( ix + 1 < w )
+                    v10 = S[i + 1];
+            }
+
+            if( iy + 1 < h ) {
+
+                if( ix >= 0 )
+                    v01 = S[i + w];
+
+                if( ix + 1 < w )
+                    v11 = S[i + w + 1];
+            }
+
+            D[x] = (1.0-fy) * ((1.0-fx)*v00 + fx*v10)
+                 +      fy  * ((1.0-fx)*v01 + fx*v11);
+        }
+    }
+
+    return NULL;
+}
+
+
 static void Lens(
     vector<double>	&vout,
     CAffineLens		&LN,
@@ -179,27 +216,248 @@ static void Lens(
     int				order,
     int				cam )
 {
-// Flatten and release raster
+// Flatten
 
     vector<double>	vflat;
     LegPolyFlatten( vflat, ras, w, h, order );
 
-// Transform into vout
+// Gather into vout
+
+    const TAffine	&Ti = LN.GetTi( cam );
+
+    vout.resize( w * h );
+
+    int	nb = EZBandCount( (long)w * h, LENS_THRPTS, LENS_MAXTHR, h );
+
+    vector<LensBand>	vb( nb );
+
+    for( int i = 0; i < nb; ++i ) {
+
+        LensBand	&B = vb[i];
+
+        B.src	= &vflat[0];
+        B.dst	= &vout[0];
+        B.Ti	= &Ti;
+        B.w		= w;
+        B.h		= h;
+        B.y0	= (long)h * i / nb;
+        B.ylim	= (long)h * (i + 1) / nb;
+    }
+
+    EZRunBands( _LensRows, &vb[0], nb, sizeof(LensBand) );
+}
+
+/* --------------------------------------------------------------- */
+/* Condition ----------------------------------------------------- */
+/* --------------------------------------------------------------- */
+
+// Load tile P and flatten into C.vf. If DoG radius r2 given,
+// also create filtered C.vfflt.
+//
+// Raster is returned in ras for caller's use and release, even
+// on failure.
+//
+static bool Condition(
+    CondTile				&C,
+    uint8*					&ras,
+    const PicSpec			&P,
+    const string			&idb,
+    bool					lens,
+    int						order,
+    int						r1,
+    int						r2,
+    FILE*					flog,
+    bool					transpose )
+{
+    ras = Raster8FromAny( P.t2i.path.c_str(),
+            C.w, C.h, flog, transpose );
+
+    if( !ras ) {
+        fprintf( flog,
+        "FAIL: PixPair: Picture load failure.\n" );
+        return false;
+    }
 
-    TAffine	T = LN.GetTf( cam );
-    int		np = w * h;
+    if( lens ) {
 
-    vout.resize( np, 0.0 );
+        CAffineLens	LN;
+
+        if( !LN.ReadIDB( idb, flog ) )
+            return false;
 
-    for( int i = 0; i < np; ++i ) {
+        Lens( C.vf, LN, ras, C.w, C.h, order, P.t2i.cam );
+        //VectorDblToTif8( "Lens.tif", C.vf, C.w, C.h, flog );
+    }
+    else
+        LegPolyFlatten( C.vf, ras, C.w, C.h, order );
 
-        int		y = i / w,
-                x = i - w*y;
-        Point	p( x, y );
+    if( r2 ) {
 
-        T.Transform( p );
-        DistributePixel( p.x, p.y, vflat[i], vout, w, h );
+        DoGFilter( C.vfflt, C.vf, C.w, C.h, r1, r2 );
+        Normalize( C.vfflt );
     }
+
+    return true;
+}
+
+/* --------------------------------------------------------------- */
+/* TrimCache ----------------------------------------------------- */
+/* --------------------------------------------------------------- */
+
+// Drop least recently used tiles beyond cachemax bytes. The most
+// recent tile is always kept (GetTile copies out from it).
+//
+static void TrimCache()
+{
+    list<CondTile>::iterator	it = cache.begin();
+    long						sum = 0;
+
+    for( ; it != cache.end(); ++it ) {
+
+        sum += (it->vf.size() + it->vfflt.size()) * sizeof(double);
+
+        if( sum > cachemax && it != cache.begin() )
+            break;
+    }
+
+    cache.erase( it, cache.end() );
+}
+
+/* --------------------------------------------------------------- */
+/* GetTile ------------------------------------------------------- */
+/* --------------------------------------------------------------- */
+
+// Get conditioned pixels for tile P, from the cache if enabled.
+//
+// Cache entries are keyed on tile path, camera and (prms), a
+// string encoding all other conditioning parameters.
+//
+// Callers needing the raw raster (keepras) bypass the cache and
+// receive the raster in ras, which they must release. Otherwise,
+// ras is returned NULL.
+//
+static bool GetTile(
+    vector<double>			&vf,
+    vector<double>			&vfflt,
+    uint32					&w,
+    uint32					&h,
+    uint8*					&ras,
+    bool					keepras,
+    const char				*prms,
+    const PicSpec			&P,
+    const string			&idb,
+    bool					lens,
+    int						order,
+    int						r1,
+    int						r2,
+    FILE*					flog,
+    bool					transpose )
+{
+    ras = NULL;
+
+// Uncached
+
+    if( !cachemax || keepras ) {
+
+        CondTile	C;
+
+        if( !Condition( C, ras, P, idb, lens, order,
+                r1, r2, flog, transpose ) ) {
+
+            return false;
+        }
+
+        vf.swap( C.vf );
+        vfflt.swap( C.vfflt );
+        w = C.w;
+        h = C.h;
+
+        return true;
+    }
+
+// Lookup
+
+    char	buf[4096];
+
+    sprintf( buf, "%s|%d|%s", P.t2i.path.c_str(), P.t2i.cam, prms );
+
+    list<CondTile>::iterator	it;
+
+    for( it = cache.begin(); it != cache.end(); ++it ) {
+
+        if( it->key == buf )
+            break;
+    }
+
+    if( it != cache.end() ) {
+
+        fprintf( flog, "PixPair: Cache hit [%s].\n",
+            P.t2i.path.c_str() );
+
+        cache.splice( cache.begin(), cache, it );
+    }
+    else {
+
+        CondTile	C;
+        bool		ok;
+
+        ok = Condition( C, ras, P, idb, lens, order,
+                r1, r2, flog, transpose );
+
+        if( ras ) {
+            RasterFree( ras );
+            ras = NULL;
+        }
+
+        if( !ok )
+            return false;
+
+        cache.push_front( CondTile() );
+
+        CondTile	&F = cache.front();
+
+        F.key = buf;
+        F.vf.swap( C.vf );
+        F.vfflt.swap( C.vfflt );
+        F.w = C.w;
+        F.h = C.h;
+
+        TrimCache();
+    }
+
+// Copy out
+
+    const CondTile	&F = cache.front();
+
+    vf		= F.vf;
+    vfflt	= F.vfflt;
+    w		= F.w;
+    h		= F.h;
+
+    return true;
+}
+
+/* --------------------------------------------------------------- */
+/* PixPair::SetCache --------------------------------------------- */
+/* --------------------------------------------------------------- */
+
+// Set max megabytes of conditioned tiles retained across successive
+// Load calls, so batch drivers matching many pairs decode, flatten
+// and filter each tile just once. Zero (default) disables caching.
+//
+// A full size tile costs 16 bytes/pixel (vf and vfflt doubles), so
+// a 4k x 4k tile is 256 MB.
+//
+// Note: Not thread-safe; call Load from one thread when enabled.
+//
+void PixPair::SetCache( int maxMB )
+{
+    cachemax = (maxMB > 0 ? (long)maxMB << 20 : 0);
+
+    if( cachemax )
+        TrimCache();
+    else
+        cache.clear();
 }
 
 /* --------------------------------------------------------------- */
@@ -226,19 +484,30 @@ bool PixPair::Load(
 /* ----------------------------- */
 
     clock_t	t0 = StartTiming();
-    uint8	*aras, *bras;
+    uint8	*aras = NULL, *bras = NULL;
     uint32	wa, ha, wb, hb;
     int		ok = false;
 
-    aras = Raster8FromAny( A.t2i.path.c_str(),
-            wa, ha, flog, transpose );
+/* ----------------------------------------- */
+/* Load, flatten and filter; check dimension */
+/* ----------------------------------------- */
 
-    bras = Raster8FromAny( B.t2i.path.c_str(),
-            wb, hb, flog, transpose );
+    char	prms[2048];
+
+    if( r2 <= 0 )
+        bDoG = false;
+
+    if( !bDoG )
+        r1 = r2 = 0;
+
+    sprintf( prms, "%s|%d|%d|%d|%d|%d", idb.c_str(),
+        lens, order, r1, r2, transpose );
+
+    if( !GetTile( _avf, _avfflt, wa, ha, aras, resmsk, prms,
+            A, idb, lens, order, r1, r2, flog, transpose ) ||
+        !GetTile( _bvf, _bvfflt, wb, hb, bras, resmsk, prms,
+            B, idb, lens, order, r1, r2, flog, transpose ) ) {
 
-    if( !aras || !bras ) {
-        fprintf( flog,
-        "FAIL: PixPair: Picture load failure.\n" );
         goto exit;
     }
 
@@ -275,28 +544,6 @@ bool PixPair::Load(
     hs		= ha;
     scl		= 1;
 
-/* ------- */
-/* Flatten */
-/* ------- */
-
-    if( lens ) {
-
-        CAffineLens	LN;
-
-        if( !LN.ReadIDB( idb, flog ) )
-            goto exit;
-
-        Lens( _avf, LN, aras, wf, hf, order, A.t2i.cam );
-        Lens( _bvf, LN, bras, wf, hf, order, B.t2i.cam );
-        //VectorDblToTif8( "LensA.tif", _avf, wf, hf, flog );
-        //VectorDblToTif8( "LensB.tif", _bvf, wf, hf, flog );
-    }
-    else {
-
-        LegPolyFlatten( _avf, aras, wf, hf, order );
-        LegPolyFlatten( _bvf, bras, wf, hf, order );
-    }
-
 /* ------------- */
 /* Resin masking */
 /* ------------- */
@@ -364,24 +611,7 @@ bool PixPair::Load(
     avs_vfy	= avs_aln = avf_vfy	= avf_aln = &_avf;
     bvs_vfy	= bvs_aln = bvf_vfy	= bvf_aln = &_bvf;
 
-/* ------------- */
-/* Apply filters */
-/* ------------- */
-
     if( bDoG ) {
-
-        vector<double>	DoG;
-        vector<CD>		kfft;
-        int				dim = MakeDoGKernel( DoG, r1, r2, flog );
-
-        Convolve( _avfflt, _avf, wf, hf,
-            &DoG[0], dim, dim, true, true, kfft, flog );
-        Normalize( _avfflt );
-
-        Convolve( _bvfflt, _bvf, wf, hf,
-            &DoG[0], dim, dim, true, true, kfft, flog );
-        Normalize( _bvfflt );
-
         avs_aln = avf_aln = &_avfflt;
         bvs_aln = bvf_aln = &_bvfflt;
     }
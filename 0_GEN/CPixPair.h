@@ -40,6 +40,8 @@ private:
         const vector<double>	&src );
 
 public:
+    static void SetCache( int maxMB );
+
     bool Load(
         const PicSpec	&A,
         const PicSpec	&B,
@@ -3,6 +3,7 @@
 #include	"CThmScan.h"
 #include	"Correlation.h"
 #include	"EZThreads.h"
+#include	"Geometry.h"
 #include	"Maths.h"
 #include	"Timer.h"
 
@@ -60,6 +61,354 @@ static double NewXFromParabola(
     return x1;
 }
 
+/* --------------------------------------------------------------- */
+/* Fourier-Mellin support ---------------------------------------- */
+/* --------------------------------------------------------------- */
+
+// Rotation is found from the FFT magnitude spectra of A and B,
+// which are translation invariant and rotate with the image. In
+// log-polar coordinates (theta, log rho) an image rotation (and
+// scale) becomes a plain shift, measured by phase correlation.
+// Magnitude spectra are centrosymmetric, so angles are known only
+// modulo 180; the caller verifies both members of each pair.
+
+const int	kFMMaxN	= 512;	// max spectrum side (decimate above)
+const int	kFMNAng	= 360;	// angle bins over [0,180)
+const int	kFMNRad	= 128;	// log radius bins
+const double kFMScl	= 1.25;	// max scale ratio considered
+
+/* --------------------------------------------------------------- */
+/* FMRaster ------------------------------------------------------ */
+/* --------------------------------------------------------------- */
+
+// Box-decimate valid pixels of D by dec into the low corner of
+// an NxN image, subtract mean and apply a Hann window over the
+// occupied area.
+//
+static void FMRaster(
+    vector<double>			&I,
+    const DenseImg			&D,
+    int						dec,
+    int						N )
+{
+    int	w  = (D.w - 1) / dec + 1,
+        h  = (D.h - 1) / dec + 1;
+
+    vector<double>	sum( w * h, 0.0 );
+    vector<int>		cnt( w * h, 0 );
+
+    for( int y = 0; y < D.h; ++y ) {
+
+        for( int x = 0; x < D.w; ++x ) {
+
+            int	i = x + D.w*y;
+
+            if( D.Valid( i ) ) {
+
+                int	j = x/dec + w*(y/dec);
+
+                sum[j] += D.v[i];
+                ++cnt[j];
+            }
+        }
+    }
+
+    double	mean = 0.0;
+    int		nset = 0;
+
+    for( int i = 0; i < w * h; ++i ) {
+
+        if( cnt[i] ) {
+            sum[i] /= cnt[i];
+            mean   += sum[i];
+            ++nset;
+        }
+    }
+
+    if( nset )
+        mean /= nset;
+
+    I.assign( N * N, 0.0 );
+
+    for( int y = 0; y < h; ++y ) {
+
+        double	wy = 0.5 - 0.5 * cos( 2*PI * (y + 0.5) / h );
+
+        for( int x = 0; x < w; ++x ) {
+
+            if( cnt[x + w*y] ) {
+
+                double	wx = 0.5 - 0.5 * cos( 2*PI * (x + 0.5) / w );
+
+                I[x + N*y] = wx * wy * (sum[x + w*y] - mean);
+            }
+        }
+    }
+}
+
+/* --------------------------------------------------------------- */
+/* FMSpectrum ---------------------------------------------------- */
+/* --------------------------------------------------------------- */
+
+// Replace I (NxN) by its high-pass filtered log magnitude
+// spectrum, as r2c half-plane M[kx + (N/2+1)*ky].
+//
+static void FMSpectrum( vector<double> &I, int N, FILE *flog )
+{
+    vector<CD>	F;
+    int			nh = N/2 + 1;
+
+    FFT_2D( F, I, N, N, false, flog );
+
+    I.resize( nh * N );
+
+    for( int ky = 0; ky < N; ++ky ) {
+
+        double	cy = cos( PI * (ky <= N/2 ? ky : ky - N) / N );
+
+        for( int kx = 0; kx < nh; ++kx ) {
+
+            double	X = cos( PI * kx / N ) * cy;
+
+            I[kx + nh*ky] = (1.0 - X) * (2.0 - X)
+                            * log( 1.0 + abs( F[kx + nh*ky] ) );
+        }
+    }
+}
+
+/* --------------------------------------------------------------- */
+/* FMMag --------------------------------------------------------- */
+/* --------------------------------------------------------------- */
+
+// Spectrum sample at integer (kx,ky), using |F(-k)| = |F(k)|.
+//
+static inline double FMMag( const vector<double> &M, int N, int kx, int ky )
+{
+    if( kx < 0 ) {
+        kx = -kx;
+        ky = -ky;
+    }
+
+    if( kx > N/2 )
+        return 0.0;
+
+    if( ky < 0 )
+        ky += N;
+
+    if( ky < 0 || ky >= N )
+        return 0.0;
+
+    return M[kx + (N/2 + 1)*ky];
+}
+
+/* --------------------------------------------------------------- */
+/* FMLogPolar ---------------------------------------------------- */
+/* --------------------------------------------------------------- */
+
+// Resample spectrum M onto L[ir + nfast*ia], with angle rows
+// ia spanning [0,180) and log radius columns ir in [0,kFMNRad).
+// Columns [kFMNRad,nfast) are zero padding. Return dlogrho.
+//
+static double FMLogPolar(
+    vector<double>			&L,
+    const vector<double>	&M,
+    int						N,
+    int						nfast )
+{
+    double	rmin = 2.0,
+            rmax = N/2 - 1,
+            dlr  = log( rmax / rmin ) / (kFMNRad - 1);
+
+    L.assign( nfast * kFMNAng, 0.0 );
+
+    for( int ia = 0; ia < kFMNAng; ++ia ) {
+
+        double	t = ia * PI / kFMNAng,
+                c = cos( t ),
+                s = sin( t );
+
+        for( int ir = 0; ir < kFMNRad; ++ir ) {
+
+            double	r  = rmin * exp( ir * dlr ),
+                    fx = r * c,
+                    fy = r * s;
+            int		x0 = (int)floor( fx ),
+                    y0 = (int)floor( fy );
+            double	ax = fx - x0,
+                    ay = fy - y0;
+
+            L[ir + nfast*ia] =
+                (1-ax)*(1-ay) * FMMag( M, N, x0,   y0   ) +
+                   ax *(1-ay) * FMMag( M, N, x0+1, y0   ) +
+                (1-ax)*   ay  * FMMag( M, N, x0,   y0+1 ) +
+                   ax *   ay  * FMMag( M, N, x0+1, y0+1 );
+        }
+    }
+
+// Zero mean and taper along radius
+
+    double	mean = 0.0;
+
+    for( int ia = 0; ia < kFMNAng; ++ia ) {
+        for( int ir = 0; ir < kFMNRad; ++ir )
+            mean += L[ir + nfast*ia];
+    }
+
+    mean /= kFMNAng * kFMNRad;
+
+    for( int ir = 0; ir < kFMNRad; ++ir ) {
+
+        double	w = 0.5 - 0.5 * cos( 2*PI * (ir + 0.5) / kFMNRad );
+
+        for( int ia = 0; ia < kFMNAng; ++ia ) {
+            double	&v = L[ir + nfast*ia];
+            v = w * (v - mean);
+        }
+    }
+
+    return dlr;
+}
+
+/* --------------------------------------------------------------- */
+/* FMCandidates -------------------------------------------------- */
+/* --------------------------------------------------------------- */
+
+// Fill vang with up to ncand rotation estimates (deg, in [0,180))
+// taking A onto B, best first. A is first mapped by R part of T.
+// Also report the scale (B/A) found with the best candidate.
+//
+static void FMCandidates(
+    vector<double>			&vang,
+    double					&scl,
+    const DenseImg			&a,
+    const DenseImg			&b,
+    const TAffine			&T,
+    int						ncand,
+    FILE					*flog )
+{
+    vang.clear();
+    scl = 1.0;
+
+    if( !a.NValid() || !b.NValid() )
+        return;
+
+// Common decimation and square spectrum size
+
+    DenseImg	ar;
+    TAffine		R( T );
+
+    R.SetXY( 0, 0 );
+    a.Resample( ar, R );
+
+    double	dim = max( max( ar.w, ar.h ), max( b.w, b.h ) );
+    int		dec = (int)ceil( dim / kFMMaxN ),
+            N   = CeilPow2( (int)ceil( dim / dec ) );
+
+// Log-polar spectra
+
+    int				nfast = 2 * kFMNRad,
+                    nslow = kFMNAng;
+    vector<double>	IA, IB, LA, LB;
+    double			dlr;
+
+    FMRaster( IA, ar, dec, N );
+    FMSpectrum( IA, N, flog );
+    FMLogPolar( LA, IA, N, nfast );
+
+    FMRaster( IB, b, dec, N );
+    FMSpectrum( IB, N, flog );
+    dlr = FMLogPolar( LB, IB, N, nfast );
+
+// Phase correlation: peak at -(shift of B rel. A)
+
+    vector<CD>	FA, FB;
+    int			M = FFT_2D( FA, LA, nfast, nslow, false, flog );
+
+    FFT_2D( FB, LB, nfast, nslow, false, flog );
+
+    for( int i = 0; i < M; ++i ) {
+
+        CD		c = FA[i] * conj( FB[i] );
+        double	m = abs( c );
+
+        FA[i] = (m > 1e-30 ? c / m : CD( 0.0, 0.0 ));
+    }
+
+    vector<double>	P;
+
+    IFT_2D( P, FA, nfast, nslow, flog );
+
+// Angle profile: best over plausible scale lags
+
+    int				drmax = (int)ceil( log( kFMScl ) / dlr );
+    vector<double>	prof( nslow );
+    vector<int>		plag( nslow );
+
+    for( int ia = 0; ia < nslow; ++ia ) {
+
+        prof[ia] = -1e30;
+
+        for( int dr = -drmax; dr <= drmax; ++dr ) {
+
+            double	v = P[(dr + nfast) % nfast + nfast*ia];
+
+            if( v > prof[ia] ) {
+                prof[ia] = v;
+                plag[ia] = dr;
+            }
+        }
+    }
+
+// Take highest local maxima, interpolated
+
+    vector<int>	ipk;
+
+    for( int ia = 0; ia < nslow; ++ia ) {
+
+        double	v = prof[ia];
+
+        if( v > prof[(ia + nslow - 1) % nslow] &&
+            v >= prof[(ia + 1) % nslow] ) {
+
+            ipk.push_back( ia );
+        }
+    }
+
+    for( int i = 0; i < ipk.size() && i < ncand; ++i ) {
+
+        int	k = i;
+
+        for( int j = i + 1; j < ipk.size(); ++j ) {
+
+            if( prof[ipk[j]] > prof[ipk[k]] )
+                k = j;
+        }
+
+        swap( ipk[i], ipk[k] );
+
+        int		ia = ipk[i];
+        double	y0 = prof[(ia + nslow - 1) % nslow],
+                y1 = prof[ia],
+                y2 = prof[(ia + 1) % nslow],
+                s  = NewXFromParabola( ia, 1, y0, y1, y2 ),
+                a  = -s * 180.0 / nslow;
+
+        while( a < 0 )
+            a += 180.0;
+
+        while( a >= 180.0 )
+            a -= 180.0;
+
+        vang.push_back( a );
+
+        if( !i )
+            scl = exp( plag[ia] * dlr );
+
+        fprintf( flog, "FMPeak: A=%7.3f (+180), P=%.4f\n",
+        a, y1 / (nfast * nslow) );
+    }
+}
+
 /* --------------------------------------------------------------- */
 /* _TCDDo1 ------------------------------------------------------- */
 /* --------------------------------------------------------------- */
@@ -84,6 +433,45 @@ void* _TCDGet( void* icstart )
     return NULL;
 }
 
+/* --------------------------------------------------------------- */
+/* SweepEnvelope ------------------------------------------------- */
+/* --------------------------------------------------------------- */
+
+// Set E to bbox of resampled thm.a over all TCD.vC angles,
+// padded a pixel for Resample's corner snapping.
+//
+void CThmScan::SweepEnvelope( IBox &E, const ThmRec &thm )
+{
+    const DenseImg	&a = thm.a;
+    int				nc = TCD.vC.size();
+
+    E.L = BIG;
+    E.R = -BIG;
+    E.B = BIG;
+    E.T = -BIG;
+
+    for( int ic = 0; ic < nc; ++ic ) {
+
+        TAffine	T;
+
+        XfmFromAngle( T, TCD.vC[ic].A, ic );
+        T.SetXY( 0, 0 );
+
+        for( int k = 0; k < 4; ++k ) {
+
+            Point	p( a.x0 + (k & 1 ? a.w - 1 : 0),
+                       a.y0 + (k & 2 ? a.h - 1 : 0) );
+
+            T.Transform( p );
+
+            E.L = min( E.L, (int)floor( p.x ) - 1 );
+            E.R = max( E.R, (int)ceil( p.x ) + 1 );
+            E.B = min( E.B, (int)floor( p.y ) - 1 );
+            E.T = max( E.T, (int)ceil( p.y ) + 1 );
+        }
+    }
+}
+
 /* --------------------------------------------------------------- */
 /* TCDGet -------------------------------------------------------- */
 /* --------------------------------------------------------------- */
@@ -91,6 +479,9 @@ void* _TCDGet( void* icstart )
 // (1) Caller must previously init public TCD fields.
 // (2) Call TCDGet to calculate specified CorRecs.
 //
+// While the sweep runs, thm.ftc gets the sweep's image1
+// envelope, so all angles share the cached B-side FFT.
+//
 void CThmScan::TCDGet( int nthr )
 {
     ME = this;
@@ -102,8 +493,17 @@ void CThmScan::TCDGet( int nthr )
 
     TCD.nthr = nthr;
 
+    IBox	E;
+
+    SweepEnvelope( E, *TCD.thm );
+    TCD.thm->ftc.SetEnvelope( E );
+
     if( !EZThreads( _TCDGet, nthr, 24, "_TCDGet", flog ) )
         exit( 42 );
+
+    E.L = 0;
+    E.R = -1;
+    TCD.thm->ftc.SetEnvelope( E );
 }
 
 /* --------------------------------------------------------------- */
@@ -170,6 +570,7 @@ CThmScan::CThmScan()
     swpPretweak	= true;
     swpNThreads	= 1;
     useCorrR	= false;
+    swpFMCand	= 0;
     Ox			= 0;
     Oy			= 0;
     Rx			= -1;
@@ -322,6 +723,28 @@ bool CThmScan::Pretweaks( double bestR, double deg, ThmRec &thm )
     return anychange;
 }
 
+/* --------------------------------------------------------------- */
+/* XfmFromAngle -------------------------------------------------- */
+/* --------------------------------------------------------------- */
+
+// Set T = full image1 transform for angle deg, including
+// pretweak TCD.vT[iaux] if that exists.
+//
+void CThmScan::XfmFromAngle( TAffine &T, double deg, int iaux )
+{
+    TAffine	R, P( Tptwk );
+
+    R.NUSetRot( deg * PI/180.0 );
+
+    if( iaux >= 0 && iaux < TCD.vT.size() ) {
+        TAffine	M;
+        M.NUSelect( TCD.vT[iaux].sel, TCD.vT[iaux].a );
+        P = M * Tptwk;
+    }
+
+    T = R * (Tdfm * P);
+}
+
 /* --------------------------------------------------------------- */
 /* RFromAngle ---------------------------------------------------- */
 /* --------------------------------------------------------------- */
@@ -332,21 +755,16 @@ void CThmScan::RFromAngle(
     ThmRec	&thm,
     int		iaux )
 {
-    vector<Point>	pts = thm.ap;
-    TAffine			R, T( Tptwk );
-    int				ox, oy, rx, ry;
+    DenseImg	A;
+    int			ox, oy, rx, ry;
 
     C.A = deg;
-    R.NUSetRot( deg * PI/180.0 );
+    XfmFromAngle( C.T, deg, iaux );
 
-    if( iaux >= 0 && iaux < TCD.vT.size() ) {
-        TAffine	M;
-        M.NUSelect( TCD.vT[iaux].sel, TCD.vT[iaux].a );
-        T = M * Tptwk;
-    }
+    TAffine	Tr( C.T );
 
-    C.T = R * (Tdfm * T);
-    C.T.Apply_R_Part( pts );
+    Tr.SetXY( 0, 0 );
+    thm.a.Resample( A, Tr );
 
     if( newAngProc )
         newAngProc( ox, oy, rx, ry, deg );
@@ -357,12 +775,24 @@ void CThmScan::RFromAngle(
 
     olap1D = thm.olap1D;
 
-    C.R = (useCorrR ? CorrImagesS : CorrImagesF)(
-        flog, false, C.X, C.Y,
-        pts, thm.av, thm.bp, thm.bv,
-        BigEnough, (void*)thm.reqArea,
-        EnoughPoints, (void*)thm.reqArea,
-        0.0, nbmaxht, ox, oy, rx, ry, thm.ftc );
+    if( useCorrR ) {
+
+        C.R = CorrImagesS(
+            flog, false, C.X, C.Y,
+            A, thm.b,
+            BigEnough, (void*)thm.reqArea,
+            EnoughPoints, (void*)thm.reqArea,
+            0.0, nbmaxht, ox, oy, rx, ry, thm.ftc );
+    }
+    else {
+
+        C.R = CorrImagesF(
+            flog, false, C.X, C.Y,
+            A, thm.b,
+            BigEnough, (void*)thm.reqArea,
+            EnoughPoints, (void*)thm.reqArea,
+            0.0, nbmaxht, ox, oy, rx, ry, thm.ftc );
+    }
 }
 
 /* --------------------------------------------------------------- */
@@ -667,6 +1097,109 @@ double CThmScan::AngleScanWithTweaks(
     return best.R;
 }
 
+/* --------------------------------------------------------------- */
+/* FMBestAngle --------------------------------------------------- */
+/* --------------------------------------------------------------- */
+
+// Fourier-Mellin alternative to a denovo angle sweep. The top
+// swpFMCand spectral estimates (each with its 180 twin) within
+// [center-hlfwid, center+hlfwid] are verified by RFromAngle.
+// Pretweaks are tried as in AngleScanWithTweaks.
+//
+// Return best R; set res to the estimator's angular resolution.
+//
+double CThmScan::FMBestAngle(
+    CorRec	&best,
+    double	center,
+    double	hlfwid,
+    double	&res,
+    ThmRec	&thm )
+{
+    fprintf( flog,
+    "FMScan: center=%.3f, hlfwid=%.3f, ncand=%d\n",
+    center, hlfwid, swpFMCand );
+
+    clock_t	t0 = StartTiming();
+
+    vector<double>	vfm, vang;
+    double			scl;
+
+    res = 180.0 / kFMNAng;
+
+    FMCandidates( vfm, scl, thm.a, thm.b,
+        Tdfm * Tptwk, swpFMCand, flog );
+
+    fprintf( flog, "FMScan: scale B/A=%.3f\n", scl );
+
+// Place each estimate and its twin in the search window
+
+    int	nfm = vfm.size();
+
+    for( int i = 0; i < nfm; ++i ) {
+
+        for( int k = 0; k < 2; ++k ) {
+
+            double	a = vfm[i] + 180.0 * k;
+
+            while( a > center + hlfwid )
+                a -= 360.0;
+
+            while( a < center - hlfwid )
+                a += 360.0;
+
+            if( a <= center + hlfwid )
+                vang.push_back( a );
+        }
+    }
+
+    int	nc = vang.size();
+
+    best.R = 0.0;
+
+    if( !nc ) {
+        fprintf( flog, "FMScan: No candidates in range.\n" );
+        return 0.0;
+    }
+
+// Verify; retry with pretweaks if weak
+
+    for( int pass = 0; pass < 2; ++pass ) {
+
+        TCD.thm = &thm;
+        TCD.vC.clear();
+
+        for( int ic = 0; ic < nc; ++ic )
+            TCD.vC.push_back( CorRec( vang[ic] ) );
+
+        TCDGet( swpNThreads );
+
+        best = TCD.vC[0];
+
+        for( int ic = 0; ic < nc; ++ic ) {
+
+            const CorRec&	C = TCD.vC[ic];
+            RecordAngle( flog, "  Cand", C );
+
+            if( C.R > best.R )
+                best = C;
+        }
+
+        TCD.vC.clear();
+
+        if( pass || best.R >= rthresh || !swpPretweak ||
+            !Pretweaks( best.R, best.A, thm ) ) {
+
+            break;
+        }
+    }
+
+    RecordAngle( flog, "  Best", best );
+
+    StopTiming( flog, "FMScan", t0 );
+
+    return best.R;
+}
+
 /* --------------------------------------------------------------- */
 /* PeakHunt ------------------------------------------------------ */
 /* --------------------------------------------------------------- */
@@ -769,6 +1302,23 @@ bool CThmScan::DenovoBestAngle(
     ThmRec	&thm,
     bool	failmsg )
 {
+    if( swpFMCand > 0 ) {
+
+        // FM pass may pretweak; fallback sweep starts as if not
+
+        TAffine	T0( Tptwk );
+        double	res;
+
+        if( FMBestAngle( best, ang0, hfangdn, res, thm ) >= rthresh &&
+            PeakHunt( best, res * 1.5, thm ) >= rthresh ) {
+
+            return true;
+        }
+
+        fprintf( flog, "FMScan: Falling back to angle sweep.\n" );
+        Tptwk = T0;
+    }
+
     if( AngleScanWithTweaks( best, ang0, hfangdn, step, thm )
             < rthresh ||
         AngleScanSel( best, best.A, step*2.0, step*0.05, false, thm )
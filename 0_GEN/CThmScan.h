@@ -4,6 +4,7 @@
 
 
 #include	"GenDefs.h"
+#include	"Correlation.h"
 #include	"TAffine.h"
 
 #include	<vector>
@@ -25,9 +26,8 @@ enum thmerrs {
 /* --------------------------------------------------------------- */
 
 typedef struct {
-    vector<double>	av, bv;
-    vector<Point>	ap, bp;
-    vector<CD>		ftc;		// fourier transform cache
+    DenseImg		a, b;		// normalized thumbnails
+    CorrCtxB		ftc;		// B-side correlation cache
     long			reqArea;
     int				olap1D,
                     scl;		// for caller convenience
@@ -92,13 +92,17 @@ private:
                     swpPretweak,
                     swpNThreads,
                     useCorrR,
+                    swpFMCand,
                     Ox, Oy, Rx, Ry,
                     olap1D;
 
 private:
     void _TCDDo1( int ic );
+    void SweepEnvelope( IBox &E, const ThmRec &thm );
     void TCDGet( int nthr );
 
+    void XfmFromAngle( TAffine &T, double deg, int iaux );
+
     double PTWInterp(
         double	&ynew,
         int		sel,
@@ -137,6 +141,9 @@ public:
     void SetUseCorrR( int useCorrR )
         {this->useCorrR = useCorrR;};
 
+    void SetSweepFMCand( int swpFMCand )
+        {this->swpFMCand = swpFMCand;};
+
     void SetDisc( int Ox, int Oy, int Rx, int Ry )
         {this->Ox = Ox; this->Oy = Oy; this->Rx = Rx; this->Ry = Ry;};
 
@@ -200,6 +207,13 @@ public:
         double	step,
         ThmRec	&thm );
 
+    double FMBestAngle(
+        CorRec	&best,
+        double	center,
+        double	hlfwid,
+        double	&res,
+        ThmRec	&thm );
+
     double PeakHunt( CorRec &best, double hlfwid, ThmRec &thm );
 
     bool UsePriorAngles(
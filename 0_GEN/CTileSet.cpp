@@ -1049,6 +1049,130 @@ double CTileSet::ABOlap( int a, int b, const TAffine *Tab )
     return AreaOfPolygon( pgon ) / (gW * gH);
 }
 
+/* --------------------------------------------------------------- */
+/* IndexLayer ---------------------------------------------------- */
+/* --------------------------------------------------------------- */
+
+// Build spatial index for overlap queries on tiles [is0,isN),
+// replacing any previous index. Call again if transforms change.
+//
+void CTileSet::IndexLayer( int is0, int isN )
+{
+    CTileGrid		&G = grid;
+    vector<Point>	cnr;
+    DBox			B;
+    int				nt = isN - is0;
+
+    Set4Corners( cnr, gW, gH );
+
+    G.is0	= is0;
+    G.isN	= isN;
+    G.box.resize( nt );
+
+    B.L = BIGD, B.R = -BIGD,
+    B.B = BIGD, B.T = -BIGD;
+
+    for( int i = 0; i < nt; ++i ) {
+
+        DBox	&b = G.box[i];
+
+        b.L = BIGD, b.R = -BIGD,
+        b.B = BIGD, b.T = -BIGD;
+
+        BoundsPlus1( b, cnr, is0 + i );
+
+        B.L = fmin( B.L, b.L );
+        B.R = fmax( B.R, b.R );
+        B.B = fmin( B.B, b.B );
+        B.T = fmax( B.T, b.T );
+    }
+
+    G.d		= fmax( 1.0, fmax( gW, gH ) );
+    G.x0	= B.L;
+    G.y0	= B.B;
+    G.nx	= (nt ? int((B.R - B.L) / G.d) + 1 : 0);
+    G.ny	= (nt ? int((B.T - B.B) / G.d) + 1 : 0);
+
+    G.cell.clear();
+    G.cell.resize( G.nx * G.ny );
+
+    for( int i = 0; i < nt; ++i ) {
+
+        const DBox	&b = G.box[i];
+        int			xL = int((b.L - G.x0) / G.d),
+                    xR = int((b.R - G.x0) / G.d),
+                    yB = int((b.B - G.y0) / G.d),
+                    yT = int((b.T - G.y0) / G.d);
+
+        for( int iy = yB; iy <= yT; ++iy ) {
+
+            for( int ix = xL; ix <= xR; ++ix )
+                G.cell[ix + G.nx*iy].push_back( is0 + i );
+        }
+    }
+}
+
+/* --------------------------------------------------------------- */
+/* TilesOverlapping ---------------------------------------------- */
+/* --------------------------------------------------------------- */
+
+// Fill vi with indexed tiles (ascending) whose global bbox meets
+// that of polygon poly (global coords), expanded by pad pixels.
+//
+// This is a conservative candidate list: callers refine it with
+// exact tests like ABOlap().
+//
+void CTileSet::TilesOverlapping(
+    vector<int>				&vi,
+    const vector<Point>		&poly,
+    double					pad ) const
+{
+    const CTileGrid	&G = grid;
+    DBox			q;
+
+    vi.clear();
+
+    if( !G.cell.size() || !poly.size() )
+        return;
+
+    BBoxFromPoints( q, poly );
+
+    q.L -= pad;
+    q.R += pad;
+    q.B -= pad;
+    q.T += pad;
+
+    int	xL = max( 0, int(floor( (q.L - G.x0) / G.d )) ),
+        xR = min( G.nx - 1, int(floor( (q.R - G.x0) / G.d )) ),
+        yB = max( 0, int(floor( (q.B - G.y0) / G.d )) ),
+        yT = min( G.ny - 1, int(floor( (q.T - G.y0) / G.d )) );
+
+    for( int iy = yB; iy <= yT; ++iy ) {
+
+        for( int ix = xL; ix <= xR; ++ix ) {
+
+            const vector<int>	&c = G.cell[ix + G.nx*iy];
+            int					nc = c.size();
+
+            for( int k = 0; k < nc; ++k ) {
+
+                const DBox	&b = G.box[c[k] - G.is0];
+
+                if( b.L <= q.R && b.R >= q.L &&
+                    b.B <= q.T && b.T >= q.B ) {
+
+                    vi.push_back( c[k] );
+                }
+            }
+        }
+    }
+
+// Tiles spanning cells are found more than once
+
+    sort( vi.begin(), vi.end() );
+    vi.erase( unique( vi.begin(), vi.end() ), vi.end() );
+}
+
 /* --------------------------------------------------------------- */
 /* WriteTrakEM2Layer --------------------------------------------- */
 /* --------------------------------------------------------------- */
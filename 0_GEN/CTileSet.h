@@ -17,7 +17,10 @@ using namespace std;
 enum TSConst {
 // ApplyClix()::tfType
     tsClixSimilar	= 0,
-    tsClixAffine	= 1
+    tsClixAffine	= 1,
+
+// TilesOverlapping() pad covering ABOlap()'s 2-pixel vertex snapping
+    tsOlapPad		= 4
 };
 
 /* --------------------------------------------------------------- */
@@ -54,16 +57,32 @@ typedef struct TSClix {
         {return Az < rhs.Az;};
 } TSClix;
 
+// Uniform grid over the global bboxes of tiles [is0,isN).
+// Cells are tile-sized, so each tile occupies a few cells.
+//
+class CTileGrid {
+
+public:
+    vector<vector<int> >	cell;	// tile indices per cell
+    vector<DBox>			box;	// box[i-is0] = bbox of tile i
+    double					x0, y0,	// grid origin
+                            d;		// cell edge
+    int						is0, isN,
+                            nx, ny;
+
+public:
+    CTileGrid() : is0(0), isN(0), nx(0), ny(0) {};
+};
+
 /* --------------------------------------------------------------- */
 /* Class --------------------------------------------------------- */
 /* --------------------------------------------------------------- */
 
 class CTileSet {
 
-    friend void* _Scape_Paint( void *ithr );
-
 private:
     FILE*			flog;
+    CTileGrid		grid;	// spatial index of one layer
     int				gW, gH;	// each tile dims
 
 public:
@@ -117,6 +136,12 @@ public:
 
     double ABOlap( int a, int b, const TAffine *Tab = NULL );
 
+    void IndexLayer( int is0, int isN );
+    void TilesOverlapping(
+        vector<int>				&vi,
+        const vector<Point>		&poly,
+        double					pad = 0.0 ) const;
+
     void WriteTrakEM2Layer(
         FILE*	f,
         int		&oid,
@@ -157,7 +182,9 @@ private:
         double				scale,
         int					szmult ) const;
 
-    void Scape_PaintTH( int nthr ) const;
+    void Scape_Names(
+        vector<string>		&vname,
+        const vector<int>	&vid ) const;
 
 public:
     uint8* Scape(
@@ -173,6 +200,23 @@ public:
         int					sdnorm,
         bool				resmask,
         int					nthr ) const;
+
+    bool ScapeToTif(
+        const char			*path,
+        uint32				&ws,
+        uint32				&hs,
+        double				&x0,
+        double				&y0,
+        const vector<int>	&vid,
+        double				scale,
+        int					szmult,
+        int					bkval,
+        int					lgord,
+        int					sdnorm,
+        bool				resmask,
+        int					nthr,
+        int					tile,
+        int					cacheMB ) const;
 };
 
 
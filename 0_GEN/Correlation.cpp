@@ -11,20 +11,44 @@
 #include	<stdlib.h>
 #include	<string.h>
 
+#if defined(__AVX2__) || defined(__AVX512F__)
+#include	<immintrin.h>
+#endif
+
 #include	<algorithm>
 using namespace std;
 
 
+/* --------------------------------------------------------------- */
+/* Globals ------------------------------------------------------- */
+/* --------------------------------------------------------------- */
+
+#ifdef ALN_CORR_FLOAT
+bool corrFloat = true;
+#else
+bool corrFloat = false;
+#endif
+
 /* --------------------------------------------------------------- */
 /* Macros -------------------------------------------------------- */
 /* --------------------------------------------------------------- */
 
+// Cropped-lag mode: lags computed beyond search oval, and
+// max ratio of cropped to full FFT area to make it worthwhile.
+#define	CROP_MARGIN		8
+#define	CROP_MAXAREA	0.5
+
+// Max B-side FFTs kept per CorrCtxB.
+#define	FT_MAXCACHE		4
+
 /* --------------------------------------------------------------- */
 /* Statics ------------------------------------------------------- */
 /* --------------------------------------------------------------- */
 
-// mutex_fft guards {fftw interface, cached fft2 array}
+// mutex_fft guards {cached fft2 array, CorrCtxB}
+// cond_fft signals CorrCtxB::FT fill completion
 static pthread_mutex_t	mutex_fft = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t	cond_fft = PTHREAD_COND_INITIALIZER;
 static int _dbg_simgidx = 0;
 
 
@@ -42,6 +66,84 @@ static int _dbg_simgidx = 0;
 #include	"Correlation_fft_fftw.cpp"
 #endif
 
+/* --------------------------------------------------------------- */
+/* CorrWS -------------------------------------------------------- */
+/* --------------------------------------------------------------- */
+
+// Per-thread workspace for correlation temporaries.
+//
+// Buffers keep their high-water capacity across calls, so after
+// its first correlation a sweep thread no longer pays for heap
+// allocation or first-touch zeroing of fresh pages. A thread runs
+// one correlation at a time: entry points fetch the workspace
+// with ThreadWS() and hand it down to the helpers they use.
+//
+class CorrWS {
+public:
+    // padded images, spectra, lags
+    vector<double>	i1, i2, rslt;
+    vector<float>	i1f, rsltf;
+    vector<CD>		fft1, fft2, ffts;
+    vector<CF>		fft1f, fftsf;
+    // integral tables, RCalc row queue
+    vector<double>	i1sum, i1sum2, i2sum, i2sum2;
+    vector<int>		i1nz, i2nz;
+    vector<double>	vn, vs1, vq1, vs2, vq2, vr;
+    // CCorImg surfaces
+    vector<double>	R, F, S;
+    vector<uint8>	A, mask;
+    vector<int>		forder;
+    // MakeF kernel spectrum (valid for R dims {kw,kh}),
+    // Convolve work image and spectrum
+    vector<CD>		kfft;
+    int				kw, kh;
+    vector<double>	cvi;
+    vector<CD>		cvfft;
+public:
+    CorrWS() : kw(0), kh(0) {};
+};
+
+static pthread_key_t	key_ws;
+static pthread_once_t	once_ws	= PTHREAD_ONCE_INIT;
+
+/* --------------------------------------------------------------- */
+/* FreeWS -------------------------------------------------------- */
+/* --------------------------------------------------------------- */
+
+// Thread exit destructor for that thread's workspace.
+//
+static void FreeWS( void *v )
+{
+    delete (CorrWS*)v;
+}
+
+/* --------------------------------------------------------------- */
+/* MakeWSKey ----------------------------------------------------- */
+/* --------------------------------------------------------------- */
+
+static void MakeWSKey()
+{
+    pthread_key_create( &key_ws, FreeWS );
+}
+
+/* --------------------------------------------------------------- */
+/* ThreadWS ------------------------------------------------------ */
+/* --------------------------------------------------------------- */
+
+static CorrWS& ThreadWS()
+{
+    pthread_once( &once_ws, MakeWSKey );
+
+    CorrWS	*ws = (CorrWS*)pthread_getspecific( key_ws );
+
+    if( !ws ) {
+        ws = new CorrWS;
+        pthread_setspecific( key_ws, ws );
+    }
+
+    return *ws;
+}
+
 /* --------------------------------------------------------------- */
 /* IntegrateImage ------------------------------------------------ */
 /* --------------------------------------------------------------- */
@@ -158,9 +260,9 @@ static void IntegrateImage(
 // Inverts IntegrateImage bookkeeping.
 //
 static double IntegralTable(
-    vector<double>	&t,
-    int				wS,
-    const IBox		&B )
+    const vector<double>	&t,
+    int						wS,
+    const IBox				&B )
 {
     double	rslt = t[B.R + wS*B.T];
 
@@ -182,9 +284,9 @@ static double IntegralTable(
 // Inverts IntegrateImage bookkeeping.
 //
 static int IntegralTable(
-    vector<int>		&t,
-    int				wS,
-    const IBox		&B )
+    const vector<int>			&t,
+    int						wS,
+    const IBox				&B )
 {
     int		rslt = t[B.R + wS*B.T];
 
@@ -208,12 +310,12 @@ static int IntegralTable(
 // the definition. Not efficient - only for debugging.
 //
 static double DebugLinearCorr(
-    FILE			*flog,
-    vector<double>	&I1,
-    vector<double>	&I2,
-    int				wI,
-    const IBox		&B1,
-    const IBox		&B2 )
+    FILE					*flog,
+    const vector<double>	&I1,
+    const vector<double>	&I2,
+    int						wI,
+    const IBox				&B1,
+    const IBox				&B2 )
 {
     double	suma	= 0.0,
             sumb	= 0.0;
@@ -313,7 +415,8 @@ static double LkFFT(
 // Returns:
 //	Storage allocation size that should be used for each array:
 //	{'a' data, 'b' data, correlation results}. Return value
-//	accounts for needed zero padding and is a power of two.
+//	accounts for needed zero padding and is an even number
+//	of the form (2^a)(3^b)(5^c)(7^d).
 //
 // Result data ordering
 // --------------------
@@ -330,20 +433,27 @@ static double LkFFT(
 //	...
 //	R[N-(n1-1)]	= lag -(n1-1)	=> (n1-1) lags are < zero.
 //
-// Why a power of two?
-// -------------------
+// Why 7-smooth?
+// -------------
 // Although the FFTW library works correctly for storage sizes
 // that are just large enough to accommodate wrap-around, the
-// performance is much better for powers of two. Here are some
-// representative time measurements (arbs)---
+// performance is much better for sizes with only small prime
+// factors. Here are some representative time measurements
+// (arbs)---
 //
 //	power of 2 dims:	1
 //	even dims:			1.75
 //	odd dims:			2.20+
 //
+// But rounding up to a power of two can nearly double each
+// axis (e.g. 1100+1100 -> 4096), while the next even 7-smooth
+// size (2240) runs at close to power-of-two speed per point.
+// Even sizes are kept because r2c transforms prefer them.
+// Use BK_Experiments/fftbench to re-check on new hardware.
+//
 int FFTSize( int n1, int n2 )
 {
-    return CeilPow2( n1 + n2 - 1 );
+    return 2 * CeilSmooth( (n1 + n2) / 2 );
 }
 
 /* --------------------------------------------------------------- */
@@ -368,7 +478,9 @@ int FFTSizeSQR( int w1, int h1, int w2, int h2 )
 //
 // dst can be same as src if desired.
 //
-void Convolve(
+// SS and sfft are caller's work image and spectrum.
+//
+static void _Convolve(
     vector<double>			&dst,
     const vector<double>	&src,
     int						ws,
@@ -379,6 +491,8 @@ void Convolve(
     bool					kIsSymmetric,
     bool					preNormK,
     vector<CD>				&kfft,
+    vector<double>			&SS,
+    vector<CD>				&sfft,
     FILE					*flog )
 {
     int	Ns	= ws * hs,
@@ -430,8 +544,7 @@ void Convolve(
 
 // Prepare src fft
 
-    vector<double>	SS( Nxy, 0.0 );
-    vector<CD>		sfft;
+    SS.assign( Nxy, 0.0 );
 
     CopyRaster( &SS[0], Nx, &src[0], ws, ws, hs );
 
@@ -456,6 +569,27 @@ void Convolve(
         dst[i] /= Nxy;
 }
 
+
+void Convolve(
+    vector<double>			&dst,
+    const vector<double>	&src,
+    int						ws,
+    int						hs,
+    const double			*K,
+    int						wk,
+    int						hk,
+    bool					kIsSymmetric,
+    bool					preNormK,
+    vector<CD>				&kfft,
+    FILE					*flog )
+{
+    vector<double>	SS;
+    vector<CD>		sfft;
+
+    _Convolve( dst, src, ws, hs, K, wk, hk,
+        kIsSymmetric, preNormK, kfft, SS, sfft, flog );
+}
+
 /* --------------------------------------------------------------- */
 /* ParabPeakFFT -------------------------------------------------- */
 /* --------------------------------------------------------------- */
@@ -592,10 +726,10 @@ double RVectors(
 class CLinCorr {
 
 private:
-    vector<double>	I1,    I2,
-                    i1sum, i1sum2,
-                    i2sum, i2sum2;
-    vector<int>		i1nz,  i2nz;
+    const vector<double>	*I1, *I2;
+    vector<double>	&i1sum, &i1sum2,
+                    &i2sum, &i2sum2;
+    vector<int>		&i1nz,  &i2nz;
     FILE			*flog;
     int				w1,  h1,
                     w2,  h2,
@@ -608,6 +742,11 @@ private:
                     i1c, i2c;
 
 public:
+    CLinCorr( CorrWS &ws )
+    : i1sum(ws.i1sum), i1sum2(ws.i1sum2),
+      i2sum(ws.i2sum), i2sum2(ws.i2sum2),
+      i1nz(ws.i1nz), i2nz(ws.i2nz) {};
+
     void Initialize(
         FILE					*flog,
         const vector<double>	&I1,
@@ -636,6 +775,9 @@ public:
 };
 
 
+// Integral tables live in ws; I1, I2 must outlive this
+// object (they are consulted only by DebugLinearCorr).
+//
 void CLinCorr::Initialize(
         FILE					*flog,
         const vector<double>	&I1,
@@ -647,8 +789,8 @@ void CLinCorr::Initialize(
         int						Nx,
         int						Ny )
 {
-    this->I1	= I1;
-    this->I2	= I2;
+    this->I1	= &I1;
+    this->I2	= &I2;
     this->flog	= flog;
     this->w1	= w1;
     this->h1	= h1;
@@ -746,7 +888,7 @@ double CLinCorr::GetCorr()
         "NormCorr: num d1 d2: %f %f %f\n",
         im1sum, im1sum2, im2sum, im2sum2, num, d1, d2 );
 
-        DebugLinearCorr( flog, I1, I2, Nx, OL1, OL2 );
+        DebugLinearCorr( flog, *I1, *I2, Nx, OL1, OL2 );
         exit(44);
     }
 
@@ -898,6 +1040,8 @@ int CCrossCorr::SizeIndex()
 // 'fft2' is a cache of the patch2 FFT. On entry, if fft2 has
 // the correct size it is used. Otherwise recomputed here.
 //
+// Temporaries are kept in the calling thread's CorrWS.
+//
 double CorrPatches(
     FILE					*flog,
     int						verbose,
@@ -952,19 +1096,21 @@ double CorrPatches(
 
 // Create images from point lists.
 
-    vector<double>	i1, i2;
+    CorrWS			&ws		= ThreadWS();
+    vector<double>	&i1		= ws.i1,
+                    &i2		= ws.i2;
 
     ImageFromValuesAndPoints( i1, Nx, Ny, iv1, ip1, B1.L, B1.B );
     ImageFromValuesAndPoints( i2, Nx, Ny, iv2, ip2, B2.L, B2.B );
 
 // FFTs and lags
 
-    vector<double>	rslt;
-    vector<CD>		fft1;
+    vector<double>	&rslt	= ws.rslt;
+    vector<CD>		&fft1	= ws.fft1;
 
 #ifdef ALN_USE_MKL
 
-    vector<CD>	_fft2;
+    vector<CD>	&_fft2 = ws.fft2;
 
     FFT_2D( _fft2, i2, Nx, Ny, false, flog );
     FFT_2D( fft1, i1, Nx, Ny, false, flog );
@@ -974,16 +1120,36 @@ double CorrPatches(
 
 #else
 
+    // Cached fft2 may be shared by the caller's threads, and one
+    // of them can refill it at another size at any time. So read
+    // it only under mutex_fft, and if it no longer matches, use a
+    // private transform instead.
+
     FFT_2D( fft2, i2, Nx, Ny, true, flog );
     FFT_2D( fft1, i1, Nx, Ny, false, flog );
 
     pthread_mutex_lock( &mutex_fft );
 
-    for( int i = 0; i < M; ++i )
-        fft1[i] = fft2[i] * conj( fft1[i] );
+    bool	match = (fft2.size() == M);
+
+    if( match ) {
+
+        for( int i = 0; i < M; ++i )
+            fft1[i] = fft2[i] * conj( fft1[i] );
+    }
 
     pthread_mutex_unlock( &mutex_fft );
 
+    if( !match ) {
+
+        vector<CD>	&_fft2 = ws.fft2;
+
+        FFT_2D( _fft2, i2, Nx, Ny, false, flog );
+
+        for( int i = 0; i < M; ++i )
+            fft1[i] = _fft2[i] * conj( fft1[i] );
+    }
+
 #endif
 
     IFT_2D( rslt, fft1, Nx, Ny, flog );
@@ -998,7 +1164,7 @@ double CorrPatches(
 
 // Prepare correlation calculator
 
-    CLinCorr	ccalc;	// uses Pearson's r
+    CLinCorr	ccalc( ws );	// uses Pearson's r
 //	CCrossCorr	ccalc;	// uses 1/n * SUM(a*b)
 
     ccalc.Initialize( flog, i1, w1, h1, i2, w2, h2, Nx, Ny );
@@ -1234,7 +1400,10 @@ double CorrPatchToImage(
 
 // Image1 from point list
 
-    vector<double>	i1( Nsqr, 0.0 );
+    CorrWS			&ws = ThreadWS();
+    vector<double>	&i1 = ws.i1;
+
+    i1.assign( Nsqr, 0.0 );
 
     for( i = 0; i < np1; ++i ) {
 
@@ -1246,8 +1415,9 @@ double CorrPatchToImage(
 
 // FFTs and lags
 
-    vector<double>	rslt;
-    vector<CD>		fft1, fft2;
+    vector<double>	&rslt	= ws.rslt;
+    vector<CD>		&fft1	= ws.fft1,
+                    &fft2	= ws.fft2;
 
     M =	FFT_2D( fft2, i2, N, N, false );
         FFT_2D( fft1, i1, N, N, false );
@@ -1732,24 +1902,28 @@ double ImproveControlPts(
 class RCalc {
 
 private:
-    vector<double>	i1sum, i1sum2,
-                    i2sum, i2sum2;
-    vector<int>		i1nz,  i2nz;
+    vector<double>	&i1sum, &i1sum2;
+    vector<int>		&i1nz;
+    const CorrCtxB	*ctxb;	// image2 tables
     int				w1,  h1,
                     w2,  h2,
                     Nx,  Ny,
                     Nxy;
     IBox			OL1, OL2;
     int				olw, olh;
+    vector<double>	&vn, &vs1, &vq1, &vs2, &vq2, &vr;	// row queue
 
 public:
+    RCalc( CorrWS &ws )
+    : i1sum(ws.i1sum), i1sum2(ws.i1sum2), i1nz(ws.i1nz),
+      vn(ws.vn), vs1(ws.vs1), vq1(ws.vq1),
+      vs2(ws.vs2), vq2(ws.vq2), vr(ws.vr) {};
+
     void Initialize(
         const vector<double>	&I1,
         int						w1,
         int						h1,
-        const vector<double>	&I2,
-        int						w2,
-        int						h2,
+        const CorrCtxB			&ctxb,
         int						Nx,
         int						Ny );
 
@@ -1761,33 +1935,42 @@ public:
         int			dx,
         int			dy );
 
-    double CalcR( double rslt );
+    void PushR( double rslt );
+    void FlushR( double *R );
 
     inline double CalcS( double rslt )
         {return rslt / Nxy;};
 };
 
 
+// Image2 tables are shared from ctxb; image1 tables
+// and the row queue live in ws.
+//
 void RCalc::Initialize(
         const vector<double>	&I1,
         int						w1,
         int						h1,
-        const vector<double>	&I2,
-        int						w2,
-        int						h2,
+        const CorrCtxB			&ctxb,
         int						Nx,
         int						Ny )
 {
+    this->ctxb	= &ctxb;
     this->w1	= w1;
     this->h1	= h1;
-    this->w2	= w2;
-    this->h2	= h2;
+    this->w2	= ctxb.w2;
+    this->h2	= ctxb.h2;
     this->Nx	= Nx;
     this->Ny	= Ny;
     Nxy			= Nx * Ny;
 
     IntegrateImage( i1sum, i1sum2, i1nz, w1, h1, I1, Nx );
-    IntegrateImage( i2sum, i2sum2, i2nz, w2, h2, I2, Nx );
+
+    vn.clear();
+    vs1.clear();
+    vq1.clear();
+    vs2.clear();
+    vq2.clear();
+    vr.clear();
 }
 
 
@@ -1816,7 +1999,7 @@ bool RCalc::Valid(
     if( LegalCnt ) {
 
         int	i1c = IntegralTable( i1nz, w1, OL1 );
-        int	i2c = IntegralTable( i2nz, w2, OL2 );
+        int	i2c = IntegralTable( ctxb->nz, w2, OL2 );
 
         if( !LegalCnt( i1c, i2c, arglc ) )
             ok = false;
@@ -1826,22 +2009,290 @@ bool RCalc::Valid(
 }
 
 
-double RCalc::CalcR( double rslt )
+// Queue correlation inputs for current OL boxes (set by Valid).
+//
+void RCalc::PushR( double rslt )
 {
-    double	n = olw * olh;
+    vn.push_back( olw * olh );
+    vs1.push_back( IntegralTable( i1sum,  w1, OL1 ) );
+    vq1.push_back( IntegralTable( i1sum2, w1, OL1 ) );
+    vs2.push_back( IntegralTable( ctxb->sum,  w2, OL2 ) );
+    vq2.push_back( IntegralTable( ctxb->sum2, w2, OL2 ) );
+    vr.push_back( rslt );
+}
 
-    double	im1sum	= IntegralTable( i1sum,  w1, OL1 );
-    double	im1sum2	= IntegralTable( i1sum2, w1, OL1 );
-    double	im2sum	= IntegralTable( i2sum,  w2, OL2 );
-    double	im2sum2	= IntegralTable( i2sum2, w2, OL2 );
 
-    double	num	= n * rslt / Nxy - im1sum * im2sum;
-    double	d1	= n * im1sum2 - im1sum * im1sum;
-    double	d2	= n * im2sum2 - im2sum * im2sum;
-    double	d	= d1 * d2;
-    double	r	= (d < n * n * 1.0E-9 ? 0.0 : num / sqrt( d ));
+// Evaluate queued Pearson r's into R[0..nqueued), clear queue.
+// The gathers are done in PushR; this arithmetic vectorizes.
+//
+void RCalc::FlushR( double *R )
+{
+    int				m	= vr.size(), i = 0;
+    const double	*n	= &vn[0],
+                    *s1	= &vs1[0], *q1 = &vq1[0],
+                    *s2	= &vs2[0], *q2 = &vq2[0],
+                    *rs	= &vr[0];
+
+#if defined(__AVX512F__)
+
+    __m512d	vN = _mm512_set1_pd( Nxy ),
+            vE = _mm512_set1_pd( 1.0E-9 ),
+            v1 = _mm512_set1_pd( 1.0 ),
+            vm = _mm512_set1_pd( -1.0 ),
+            v0 = _mm512_setzero_pd();
+
+    for( ; i + 8 <= m; i += 8 ) {
+
+        __m512d	N	= _mm512_loadu_pd( n + i ),
+                S1	= _mm512_loadu_pd( s1 + i ),
+                S2	= _mm512_loadu_pd( s2 + i ),
+                num	= _mm512_sub_pd(
+                        _mm512_div_pd( _mm512_mul_pd( N,
+                            _mm512_loadu_pd( rs + i ) ), vN ),
+                        _mm512_mul_pd( S1, S2 ) ),
+                d1	= _mm512_sub_pd(
+                        _mm512_mul_pd( N, _mm512_loadu_pd( q1 + i ) ),
+                        _mm512_mul_pd( S1, S1 ) ),
+                d2	= _mm512_sub_pd(
+                        _mm512_mul_pd( N, _mm512_loadu_pd( q2 + i ) ),
+                        _mm512_mul_pd( S2, S2 ) ),
+                d	= _mm512_mul_pd( d1, d2 ),
+                r	= _mm512_div_pd( num, _mm512_sqrt_pd( d ) );
+
+        __mmask8	ok =
+            _mm512_cmp_pd_mask( d,
+                _mm512_mul_pd( _mm512_mul_pd( N, N ), vE ), _CMP_GE_OQ )
+            & _mm512_cmp_pd_mask( r, vm, _CMP_GT_OQ )
+            & _mm512_cmp_pd_mask( r, v1, _CMP_LT_OQ );
+
+        _mm512_storeu_pd( R + i, _mm512_mask_blend_pd( ok, v0, r ) );
+    }
+
+#elif defined(__AVX2__)
+
+    __m256d	vN = _mm256_set1_pd( Nxy ),
+            vE = _mm256_set1_pd( 1.0E-9 ),
+            v1 = _mm256_set1_pd( 1.0 ),
+            vm = _mm256_set1_pd( -1.0 );
+
+    for( ; i + 4 <= m; i += 4 ) {
+
+        __m256d	N	= _mm256_loadu_pd( n + i ),
+                S1	= _mm256_loadu_pd( s1 + i ),
+                S2	= _mm256_loadu_pd( s2 + i ),
+                num	= _mm256_sub_pd(
+                        _mm256_div_pd( _mm256_mul_pd( N,
+                            _mm256_loadu_pd( rs + i ) ), vN ),
+                        _mm256_mul_pd( S1, S2 ) ),
+                d1	= _mm256_sub_pd(
+                        _mm256_mul_pd( N, _mm256_loadu_pd( q1 + i ) ),
+                        _mm256_mul_pd( S1, S1 ) ),
+                d2	= _mm256_sub_pd(
+                        _mm256_mul_pd( N, _mm256_loadu_pd( q2 + i ) ),
+                        _mm256_mul_pd( S2, S2 ) ),
+                d	= _mm256_mul_pd( d1, d2 ),
+                r	= _mm256_div_pd( num, _mm256_sqrt_pd( d ) ),
+                ok	= _mm256_and_pd(
+                        _mm256_cmp_pd( d,
+                            _mm256_mul_pd( _mm256_mul_pd( N, N ), vE ),
+                            _CMP_GE_OQ ),
+                        _mm256_and_pd(
+                            _mm256_cmp_pd( r, vm, _CMP_GT_OQ ),
+                            _mm256_cmp_pd( r, v1, _CMP_LT_OQ ) ) );
+
+        _mm256_storeu_pd( R + i, _mm256_and_pd( ok, r ) );
+    }
+
+#endif
+
+    for( ; i < m; ++i ) {
+
+        double	num	= n[i] * rs[i] / Nxy - s1[i] * s2[i];
+        double	d1	= n[i] * q1[i] - s1[i] * s1[i];
+        double	d2	= n[i] * q2[i] - s2[i] * s2[i];
+        double	d	= d1 * d2;
+        double	r	= (d < n[i] * n[i] * 1.0E-9 ? 0.0 : num / sqrt( d ));
+
+        R[i] = (r > -1.0 && r < 1.0 ? r : 0.0);
+    }
+
+    vn.clear();
+    vs1.clear();
+    vq1.clear();
+    vs2.clear();
+    vq2.clear();
+    vr.clear();
+}
+
+/* --------------------------------------------------------------- */
+/* CorrCtxB::Tables ---------------------------------------------- */
+/* --------------------------------------------------------------- */
+
+// Make bbox and integral tables for bound image2.
+//
+void CorrCtxB::Tables()
+{
+    vector<double>	i2;
 
-    return (r > -1.0 && r < 1.0 ? r : 0.0);
+    lft.clear();
+
+    B2.L = I2.x0;
+    B2.R = I2.x0 + I2.w - 1;
+    B2.B = I2.y0;
+    B2.T = I2.y0 + I2.h - 1;
+
+    w2 = I2.w;
+    h2 = I2.h;
+
+    I2.Pad( i2, w2, h2 );
+    IntegrateImage( sum, sum2, nz, w2, h2, i2, w2 );
+}
+
+/* --------------------------------------------------------------- */
+/* CorrCtxB::Bind ------------------------------------------------ */
+/* --------------------------------------------------------------- */
+
+// Rasterize image2 and make its tables, unless already done.
+// Safe to call from concurrent sweep threads.
+//
+void CorrCtxB::Bind(
+    const vector<Point>		&ip2,
+    const vector<double>	&iv2 )
+{
+    pthread_mutex_lock( &mutex_fft );
+
+    if( n2 != ip2.size() ) {
+
+        n2 = ip2.size();
+        I2.FromPoints( ip2, iv2 );
+        Tables();
+    }
+
+    pthread_mutex_unlock( &mutex_fft );
+}
+
+
+// Dense image2 is copied on first bind; thereafter the
+// caller's image is not consulted until clear().
+//
+void CorrCtxB::Bind( const DenseImg &I )
+{
+    pthread_mutex_lock( &mutex_fft );
+
+    if( !n2 ) {
+
+        n2 = max( 1, I.w * I.h );
+        I2 = I;
+        Tables();
+    }
+
+    pthread_mutex_unlock( &mutex_fft );
+}
+
+/* --------------------------------------------------------------- */
+/* CorrCtxB::FFT ------------------------------------------------- */
+/* --------------------------------------------------------------- */
+
+// Return FFT of image2 window {x0,y0,wc,hc} padded to (Nx,Ny),
+// making it if needed. The full image is {0,0,w2,h2}. Entry
+// has fftf if corrFloat, else fft.
+//
+// The entry is pinned for the caller, who must Release() it
+// when done. On a miss, the new entry is filled outside the
+// mutex; other threads wanting it wait on cond_fft, and those
+// wanting other entries proceed. Unpinned entries beyond
+// FT_MAXCACHE are evicted, least recently used first.
+//
+const CorrCtxB::FT& CorrCtxB::FFT(
+    int						Nx,
+    int						Ny,
+    int						x0,
+    int						y0,
+    int						wc,
+    int						hc,
+    FILE					*flog )
+{
+    pthread_mutex_lock( &mutex_fft );
+
+    list<FT>::iterator	it;
+
+    for( it = lft.begin(); it != lft.end(); ++it ) {
+
+        if( it->Nx == Nx && it->Ny == Ny &&
+            it->x0 == x0 && it->y0 == y0 &&
+            it->wc == wc && it->hc == hc ) {
+
+            break;
+        }
+    }
+
+    if( it == lft.end() ) {
+
+        it = lft.insert( lft.begin(), FT() );
+        it->Nx = Nx;
+        it->Ny = Ny;
+        it->x0 = x0;
+        it->y0 = y0;
+        it->wc = wc;
+        it->hc = hc;
+    }
+    else if( it != lft.begin() )
+        lft.splice( lft.begin(), lft, it );
+
+    ++it->nref;
+
+    while( it->filling )
+        pthread_cond_wait( &cond_fft, &mutex_fft );
+
+    if( corrFloat ? !it->fftf.size() : !it->fft.size() ) {
+
+        it->filling = true;
+        pthread_mutex_unlock( &mutex_fft );
+
+        vector<double>	i2;
+
+        I2.Pad( i2, Nx, Ny, x0, y0, wc, hc );
+
+        if( corrFloat ) {
+            vector<float>	i2f( i2.begin(), i2.end() );
+            FFT_2DF( it->fftf, i2f, Nx, Ny, flog );
+        }
+        else
+            FFT_2D( it->fft, i2, Nx, Ny, false, flog );
+
+        pthread_mutex_lock( &mutex_fft );
+        it->filling = false;
+        pthread_cond_broadcast( &cond_fft );
+    }
+
+// Evict from LRU end
+
+    list<FT>::iterator	ie = lft.end();
+
+    for( int n = lft.size(); n > FT_MAXCACHE && ie != lft.begin(); ) {
+
+        if( !(--ie)->nref ) {
+            ie = lft.erase( ie );
+            --n;
+        }
+    }
+
+    pthread_mutex_unlock( &mutex_fft );
+
+    return *it;
+}
+
+/* --------------------------------------------------------------- */
+/* CorrCtxB::Release --------------------------------------------- */
+/* --------------------------------------------------------------- */
+
+// Unpin entry returned by FFT().
+//
+void CorrCtxB::Release( const FT &ft )
+{
+    pthread_mutex_lock( &mutex_fft );
+    --const_cast<FT&>( ft ).nref;
+    pthread_mutex_unlock( &mutex_fft );
 }
 
 /* --------------------------------------------------------------- */
@@ -1851,20 +2302,32 @@ double RCalc::CalcR( double rslt )
 class CCorImg {
 
 private:
+    CorrWS	*ws;
     FILE	*flog;
     int		verbose;
-    IBox	B1, B2;
-    int		w1, h1, w2, h2,
+    IBox	B1, B2,
+            E;					// image1 envelope
+    int		we, he,
+            w1, h1, w2, h2,
             nnegx, nposx,
             nnegy, nposy,
-            cx, cy, wR, hR, nR;
+            cx, cy, wR, hR, nR,
+            x0, y0, wc, hc,		// B window, B-local coords
+            rx0, rx1, ry0, ry1;	// computed R pixels
 
 public:
     bool SetDims(
+        CorrWS					&iws,
         FILE					*iflog,
         int						iverbose,
-        const vector<Point>		&ip1,
-        const vector<Point>		&ip2 );
+        const DenseImg			&I1,
+        const CorrCtxB			&ctxb );
+
+    void CropB(
+        int						Ox,
+        int						Oy,
+        int						Rx,
+        int						Ry );
 
     void MaskA(
         vector<uint8>			&A,
@@ -1876,10 +2339,7 @@ public:
     void MakeRandA(
         vector<double>			&R,
         vector<uint8>			&A,
-        const vector<Point>		&ip1,
-        const vector<double>	&iv1,
-        const vector<Point>		&ip2,
-        const vector<double>	&iv2,
+        const DenseImg			&I1,
         EvalType				LegalRgn,
         void*					arglr,
         EvalType				LegalCnt,
@@ -1888,16 +2348,13 @@ public:
         int						Oy,
         int						Rx,
         int						Ry,
-        vector<CD>				&fft2 );
+        CorrCtxB				&ctxb );
 
     void MakeSandRandA(
         vector<double>			&S,
         vector<double>			&R,
         vector<uint8>			&A,
-        const vector<Point>		&ip1,
-        const vector<double>	&iv1,
-        const vector<Point>		&ip2,
-        const vector<double>	&iv2,
+        const DenseImg			&I1,
         EvalType				LegalRgn,
         void*					arglr,
         EvalType				LegalCnt,
@@ -1906,7 +2363,7 @@ public:
         int						Oy,
         int						Rx,
         int						Ry,
-        vector<CD>				&fft2 );
+        CorrCtxB				&ctxb );
 
     void MakeF(
         vector<double>			&F,
@@ -1946,23 +2403,45 @@ public:
 /* CCorImg::SetDims ---------------------------------------------- */
 /* --------------------------------------------------------------- */
 
+// Temporaries of all later steps are kept in iws.
+//
 bool CCorImg::SetDims(
+    CorrWS					&iws,
     FILE					*iflog,
     int						iverbose,
-    const vector<Point>		&ip1,
-    const vector<Point>		&ip2 )
+    const DenseImg			&I1,
+    const CorrCtxB			&ctxb )
 {
+    ws		= &iws;
     flog	= iflog;
     verbose	= iverbose;
 
-    BBoxFromPoints( B1, ip1 );
-    BBoxFromPoints( B2, ip2 );
+    B1.L = I1.x0;
+    B1.R = I1.x0 + I1.w - 1;
+    B1.B = I1.y0;
+    B1.T = I1.y0 + I1.h - 1;
+    B2 = ctxb.B2;
 
-    w1 = B1.R - B1.L + 1;
-    h1 = B1.T - B1.B + 1;
+    w1 = I1.w;
+    h1 = I1.h;
 
-    w2 = B2.R - B2.L + 1;
-    h2 = B2.T - B2.B + 1;
+    w2 = ctxb.w2;
+    h2 = ctxb.h2;
+
+// Sizes and B window follow the sweep envelope if it applies
+
+    const IBox	&E1 = ctxb.E1;
+
+    if( E1.L <= B1.L && E1.R >= B1.R &&
+        E1.B <= B1.B && E1.T >= B1.T ) {
+
+        E = E1;
+    }
+    else
+        E = B1;
+
+    we = E.R - E.L + 1;
+    he = E.T - E.B + 1;
 
     nnegx = w1 - 1;
     nposx = w2;
@@ -1975,6 +2454,15 @@ bool CCorImg::SetDims(
     hR = nnegy + nposy,
     nR = wR * hR;
 
+    x0	= 0;
+    y0	= 0;
+    wc	= w2;
+    hc	= h2;
+    rx0	= 0;
+    rx1	= wR - 1;
+    ry0	= 0;
+    ry1	= hR - 1;
+
     if( verbose ) {
 
         fprintf( flog,
@@ -2003,13 +2491,23 @@ bool CCorImg::SetDims(
 }
 
 /* --------------------------------------------------------------- */
-/* CCorImg::MaskA ------------------------------------------------ */
+/* CCorImg::CropB ------------------------------------------------ */
 /* --------------------------------------------------------------- */
 
-// Oval described as x^2 + (a^2)*(y^2) = Rx^2, where a = Rx/Ry.
+// Cropped-lag mode.
 //
-void CCorImg::MaskA(
-    vector<uint8>			&A,
+// If the search oval {Ox,Oy,Rx,Ry} is small, only R pixels in
+// its bbox (plus CROP_MARGIN) are needed. Those lags see only
+// the B window that image1 can reach from them, so we correlate
+// image1 against that window, using a much smaller FFT. The
+// window is adopted only if it saves enough FFT area.
+//
+// The window and the decision are made for the envelope E, not
+// this image1, so an angle sweep keeps one window (and FFT).
+//
+// Other R pixels are left zero and invalid.
+//
+void CCorImg::CropB(
     int						Ox,
     int						Oy,
     int						Rx,
@@ -2018,35 +2516,101 @@ void CCorImg::MaskA(
     if( Rx <= 0 || Ry <= 0 )
         return;
 
-    Ox += B1.L - B2.L + cx;
-    Oy += B1.B - B2.B + cy;
+// Computed R pixels
 
-    int	xmin = Ox - Rx,
-        xmax = Ox + Rx,
-        ymin = Oy - Ry,
-        ymax = Oy + Ry;
+    int	ox = Ox + B1.L - B2.L + cx,
+        oy = Oy + B1.B - B2.B + cy;
 
-    double	rx2 = Rx * Rx,
-            asq = rx2 / ((double)Ry * Ry);
+    int	xlo = max( 0, ox - Rx - CROP_MARGIN ),
+        xhi = min( wR - 1, ox + Rx + CROP_MARGIN ),
+        ylo = max( 0, oy - Ry - CROP_MARGIN ),
+        yhi = min( hR - 1, oy + Ry + CROP_MARGIN );
 
-    for( int i = 0; i < nR; ++i ) {
+    if( xlo > xhi || ylo > yhi )
+        return;
 
-        int	y = i / wR;
+// B window reached from oval lags by any image1 within E;
+// contains the window reached from [xlo-cx, xhi-cx] etc.
 
-        if( y < ymin || y > ymax ) {
-            A[i] = 0;
-            continue;
-        }
+    int	bxlo = max( 0, Ox - Rx - CROP_MARGIN + E.L - B2.L ),
+        bxhi = min( w2 - 1, Ox + Rx + CROP_MARGIN + E.R - B2.L ),
+        bylo = max( 0, Oy - Ry - CROP_MARGIN + E.B - B2.B ),
+        byhi = min( h2 - 1, Oy + Ry + CROP_MARGIN + E.T - B2.B );
 
-        int	x = i - wR * y;
+    if( bxlo > bxhi || bylo > byhi )
+        return;
 
-        if( x < xmin || x > xmax ) {
-            A[i] = 0;
-            continue;
-        }
+    int	cw = bxhi - bxlo + 1,
+        ch = byhi - bylo + 1;
 
-        x -= Ox;
-        y -= Oy;
+    double	afull = (double)FFTSize( we, w2 ) * FFTSize( he, h2 ),
+            acrop = (double)FFTSize( we, cw ) * FFTSize( he, ch );
+
+    if( acrop > CROP_MAXAREA * afull )
+        return;
+
+    x0	= bxlo;
+    y0	= bylo;
+    wc	= cw;
+    hc	= ch;
+    rx0	= xlo;
+    rx1	= xhi;
+    ry0	= ylo;
+    ry1	= yhi;
+
+    if( verbose ) {
+        fprintf( flog,
+        "Corr: Cropped B to [%d %d] in x, [%d %d] in y.\n",
+        B2.L + x0, B2.L + x0 + wc - 1,
+        B2.B + y0, B2.B + y0 + hc - 1 );
+    }
+}
+
+/* --------------------------------------------------------------- */
+/* CCorImg::MaskA ------------------------------------------------ */
+/* --------------------------------------------------------------- */
+
+// Oval described as x^2 + (a^2)*(y^2) = Rx^2, where a = Rx/Ry.
+//
+void CCorImg::MaskA(
+    vector<uint8>			&A,
+    int						Ox,
+    int						Oy,
+    int						Rx,
+    int						Ry )
+{
+    if( Rx <= 0 || Ry <= 0 )
+        return;
+
+    Ox += B1.L - B2.L + cx;
+    Oy += B1.B - B2.B + cy;
+
+    int	xmin = Ox - Rx,
+        xmax = Ox + Rx,
+        ymin = Oy - Ry,
+        ymax = Oy + Ry;
+
+    double	rx2 = Rx * Rx,
+            asq = rx2 / ((double)Ry * Ry);
+
+    for( int i = 0; i < nR; ++i ) {
+
+        int	y = i / wR;
+
+        if( y < ymin || y > ymax ) {
+            A[i] = 0;
+            continue;
+        }
+
+        int	x = i - wR * y;
+
+        if( x < xmin || x > xmax ) {
+            A[i] = 0;
+            continue;
+        }
+
+        x -= Ox;
+        y -= Oy;
 
         if( x*x + asq*y*y > rx2 )
             A[i] = 0;
@@ -2060,10 +2624,7 @@ void CCorImg::MaskA(
 void CCorImg::MakeRandA(
     vector<double>			&R,
     vector<uint8>			&A,
-    const vector<Point>		&ip1,
-    const vector<double>	&iv1,
-    const vector<Point>		&ip2,
-    const vector<double>	&iv2,
+    const DenseImg			&I1,
     EvalType				LegalRgn,
     void*					arglr,
     EvalType				LegalCnt,
@@ -2072,91 +2633,107 @@ void CCorImg::MakeRandA(
     int						Oy,
     int						Rx,
     int						Ry,
-    vector<CD>				&fft2 )
+    CorrCtxB				&ctxb )
 {
 // Get array sizes (Nx,Ny) and FFT size M
 
     int	Nx, Ny, M;
 
-    Nx = FFTSize( w1, w2 ),
-    Ny = FFTSize( h1, h2 ),
+    CropB( Ox, Oy, Rx, Ry );
+
+    Nx = FFTSize( we, wc ),
+    Ny = FFTSize( he, hc ),
     M  = Ny*(Nx/2+1);
 
     if( verbose )
         fprintf( flog, "Corr: Nx = %d, Ny = %d\n", Nx, Ny );
 
-// Create images from point lists
+// Pad image1
 
-    vector<double>	i1, i2;
+    vector<double>	&i1 = ws->i1;
 
-    ImageFromValuesAndPoints( i1, Nx, Ny, iv1, ip1, B1.L, B1.B );
-    ImageFromValuesAndPoints( i2, Nx, Ny, iv2, ip2, B2.L, B2.B );
+    I1.Pad( i1, Nx, Ny );
 
 // FFTs and lags
+// Once returned, ft2 is complete and pinned until Release().
 
-    vector<double>	rslt;
-    vector<CD>		fft1;
+    const CorrCtxB::FT	&ft2 =
+        ctxb.FFT( Nx, Ny, x0, y0, wc, hc, flog );
+    vector<double>		&rslt	= ws->rslt;
+    vector<float>		&rsltf	= ws->rsltf;
 
-#ifdef ALN_USE_MKL
+    if( corrFloat ) {
 
-    vector<CD>	_fft2;
+        vector<float>	&i1f	= ws->i1f;
+        vector<CF>		&fft1	= ws->fft1f;
 
-    FFT_2D( _fft2, i2, Nx, Ny, false, flog );
-    FFT_2D( fft1, i1, Nx, Ny, false, flog );
+        i1f.assign( i1.begin(), i1.end() );
 
-    for( int i = 0; i < M; ++i )
-        fft1[i] = _fft2[i] * conj( fft1[i] );
+        FFT_2DF( fft1, i1f, Nx, Ny, flog );
 
-#else
+        for( int i = 0; i < M; ++i )
+            fft1[i] = ft2.fftf[i] * conj( fft1[i] );
 
-    FFT_2D( fft2, i2, Nx, Ny, true, flog );
-    FFT_2D( fft1, i1, Nx, Ny, false, flog );
+        IFT_2DF( rsltf, fft1, Nx, Ny, flog );
+    }
+    else {
 
-    pthread_mutex_lock( &mutex_fft );
+        vector<CD>	&fft1 = ws->fft1;
 
-    for( int i = 0; i < M; ++i )
-        fft1[i] = fft2[i] * conj( fft1[i] );
+        FFT_2D( fft1, i1, Nx, Ny, false, flog );
 
-    pthread_mutex_unlock( &mutex_fft );
+        for( int i = 0; i < M; ++i )
+            fft1[i] = ft2.fft[i] * conj( fft1[i] );
 
-#endif
+        IFT_2D( rslt, fft1, Nx, Ny, flog );
+    }
 
-    IFT_2D( rslt, fft1, Nx, Ny, flog );
+    ctxb.Release( ft2 );
 
 // Prepare correlation calculator
 
-    RCalc	calc;
+    RCalc	calc( *ws );
 
-    calc.Initialize( i1, w1, h1, i2, w2, h2, Nx, Ny );
+    calc.Initialize( i1, w1, h1, ctxb, Nx, Ny );
 
 // Reorganize valid entries of rslt image so that (dx,dy)=(0,0)
 // is at the image center and (cx,cy)+(dx,dy) indexes all pixels
-// of any sign.
+// of any sign. With a B window, rslt lags are relative to its
+// origin (x0,y0).
 
-    R.resize( nR );
-    A.resize( nR );
+    R.assign( nR, 0.0 );
+    A.assign( nR, 0 );
 
     double	vmin = 1e7, vmax = -1e7;
 
-    for( int y = -nnegy; y < nposy; ++y ) {
+    for( int y = ry0 - cy; y <= ry1 - cy; ++y ) {
 
-        int	iy = Nx * (y >= 0 ? y : Ny + y);
+        int	yc = y - y0,
+            iy = Nx * (yc >= 0 ? yc : Ny + yc);
 
-        for( int x = -nnegx; x < nposx; ++x ) {
+        for( int x = rx0 - cx; x <= rx1 - cx; ++x ) {
 
-            int	ix = (x >= 0 ? x : Nx + x);
+            int	xc = x - x0,
+                ix = (xc >= 0 ? xc : Nx + xc);
             int	ir = cx+x + wR*(cy+y);
 
             A[ir] = calc.Valid( LegalRgn, arglr,
                         LegalCnt, arglc, x, y );
 
-            R[ir] = calc.CalcR( rslt[ix+iy] );
+            calc.PushR( corrFloat ? rsltf[ix+iy] : rslt[ix+iy] );
+        }
 
-            if( R[ir] < vmin )
-                vmin = R[ir];
+        double	*Rrow = &R[rx0 + wR*(cy+y)];
 
-            if( R[ir] > vmax )
-                vmax = R[ir];
+        calc.FlushR( Rrow );
+
+        for( int x = 0; x <= rx1 - rx0; ++x ) {
+
+            if( Rrow[x] < vmin )
+                vmin = Rrow[x];
+
+            if( Rrow[x] > vmax )
+                vmax = Rrow[x];
         }
     }
 
@@ -2177,8 +2754,11 @@ void CCorImg::MakeRandA(
         sprintf( simg, "thmA_%d.tif", _dbg_simgidx );
         CorrThmToTif8( simg, i1, Nx, w1, h1, flog );
 
+        vector<double>	i2;
+        ctxb.I2.Pad( i2, w2, h2 );
+
         sprintf( simg, "thmB_%d.tif", _dbg_simgidx );
-        CorrThmToTif8( simg, i2, Nx, w2, h2, flog );
+        CorrThmToTif8( simg, i2, w2, w2, h2, flog );
 
         sprintf( simg, "corr_A_%d.tif", _dbg_simgidx );
         Raster8ToTif8( simg, &A[0], wR, hR, flog );
@@ -2196,10 +2776,7 @@ void CCorImg::MakeSandRandA(
     vector<double>			&S,
     vector<double>			&R,
     vector<uint8>			&A,
-    const vector<Point>		&ip1,
-    const vector<double>	&iv1,
-    const vector<Point>		&ip2,
-    const vector<double>	&iv2,
+    const DenseImg			&I1,
     EvalType				LegalRgn,
     void*					arglr,
     EvalType				LegalCnt,
@@ -2208,91 +2785,127 @@ void CCorImg::MakeSandRandA(
     int						Oy,
     int						Rx,
     int						Ry,
-    vector<CD>				&fft2 )
+    CorrCtxB				&ctxb )
 {
 // Get array sizes (Nx,Ny) and FFT size M
 
     int	Nx, Ny, M;
 
-    Nx = FFTSize( w1, w2 ),
-    Ny = FFTSize( h1, h2 ),
+    // No CropB here: S whitening would see only the window,
+    // changing S scale.
+
+    Nx = FFTSize( we, wc ),
+    Ny = FFTSize( he, hc ),
     M  = Ny*(Nx/2+1);
 
     if( verbose )
         fprintf( flog, "Corr: Nx = %d, Ny = %d\n", Nx, Ny );
 
-// Create images from point lists
+// Pad image1
 
-    vector<double>	i1, i2;
+    vector<double>	&i1 = ws->i1;
 
-    ImageFromValuesAndPoints( i1, Nx, Ny, iv1, ip1, B1.L, B1.B );
-    ImageFromValuesAndPoints( i2, Nx, Ny, iv2, ip2, B2.L, B2.B );
+    I1.Pad( i1, Nx, Ny );
 
 // FFTs and lags
+// Once returned, ft2 is complete and pinned until Release().
+// Whitened spectrum for S is kept (IFT destroys fft1).
 
-    vector<double>	rslt;
-    vector<CD>		fft1;
+    const CorrCtxB::FT	&ft2 =
+        ctxb.FFT( Nx, Ny, x0, y0, wc, hc, flog );
+    vector<double>		&rslt	= ws->rslt;
+    vector<float>		&rsltf	= ws->rsltf;
+    vector<CD>			&ffts	= ws->ffts;
+    vector<CF>			&fftsf	= ws->fftsf;
 
-#ifdef ALN_USE_MKL
+    if( corrFloat ) {
 
-    vector<CD>	_fft2;
+        vector<float>	&i1f	= ws->i1f;
+        vector<CF>		&fft1	= ws->fft1f;
 
-    FFT_2D( _fft2, i2, Nx, Ny, false, flog );
-    FFT_2D( fft1, i1, Nx, Ny, false, flog );
+        i1f.assign( i1.begin(), i1.end() );
 
-    for( int i = 0; i < M; ++i )
-        fft1[i] = _fft2[i] * conj( fft1[i] );
+        FFT_2DF( fft1, i1f, Nx, Ny, flog );
 
-#else
+        fftsf.resize( M );
 
-    FFT_2D( fft2, i2, Nx, Ny, true, flog );
-    FFT_2D( fft1, i1, Nx, Ny, false, flog );
+        for( int i = 0; i < M; ++i ) {
 
-    pthread_mutex_lock( &mutex_fft );
+            fft1[i] = ft2.fftf[i] * conj( fft1[i] );
 
-    for( int i = 0; i < M; ++i )
-        fft1[i] = fft2[i] * conj( fft1[i] );
+            float	mag = abs( fft1[i] );
 
-    pthread_mutex_unlock( &mutex_fft );
+            fftsf[i] = (mag > 1e-10f ? fft1[i] / sqrt( mag ) : fft1[i]);
+        }
 
-#endif
+        IFT_2DF( rsltf, fft1, Nx, Ny, flog );
+    }
+    else {
 
-    IFT_2D( rslt, fft1, Nx, Ny, flog );
+        vector<CD>	&fft1 = ws->fft1;
+
+        FFT_2D( fft1, i1, Nx, Ny, false, flog );
+
+        ffts.resize( M );
+
+        for( int i = 0; i < M; ++i ) {
+
+            fft1[i] = ft2.fft[i] * conj( fft1[i] );
+
+            double	mag = abs( fft1[i] );
+
+            ffts[i] = (mag > 1e-10 ? fft1[i] / sqrt( mag ) : fft1[i]);
+        }
+
+        IFT_2D( rslt, fft1, Nx, Ny, flog );
+    }
+
+    ctxb.Release( ft2 );
 
 // Prepare correlation calculator
 
-    RCalc	calc;
+    RCalc	calc( *ws );
 
-    calc.Initialize( i1, w1, h1, i2, w2, h2, Nx, Ny );
+    calc.Initialize( i1, w1, h1, ctxb, Nx, Ny );
 
 // Reorganize valid entries of rslt image so that (dx,dy)=(0,0)
 // is at the image center and (cx,cy)+(dx,dy) indexes all pixels
-// of any sign.
+// of any sign. With a B window, rslt lags are relative to its
+// origin (x0,y0).
 
-    R.resize( nR );
-    A.resize( nR );
+    R.assign( nR, 0.0 );
+    A.assign( nR, 0 );
 
     double	vmin = 1e7, vmax = -1e7;
 
-    for( int y = -nnegy; y < nposy; ++y ) {
+    for( int y = ry0 - cy; y <= ry1 - cy; ++y ) {
 
-        int	iy = Nx * (y >= 0 ? y : Ny + y);
+        int	yc = y - y0,
+            iy = Nx * (yc >= 0 ? yc : Ny + yc);
 
-        for( int x = -nnegx; x < nposx; ++x ) {
+        for( int x = rx0 - cx; x <= rx1 - cx; ++x ) {
 
-            int	ix = (x >= 0 ? x : Nx + x);
+            int	xc = x - x0,
+                ix = (xc >= 0 ? xc : Nx + xc);
             int	ir = cx+x + wR*(cy+y);
 
             A[ir] = calc.Valid( LegalRgn, arglr,
                         LegalCnt, arglc, x, y );
 
-            R[ir] = calc.CalcR( rslt[ix+iy] );
+            calc.PushR( corrFloat ? rsltf[ix+iy] : rslt[ix+iy] );
+        }
+
+        double	*Rrow = &R[rx0 + wR*(cy+y)];
+
+        calc.FlushR( Rrow );
+
+        for( int x = 0; x <= rx1 - rx0; ++x ) {
 
-            if( R[ir] < vmin )
-                vmin = R[ir];
+            if( Rrow[x] < vmin )
+                vmin = Rrow[x];
 
-            if( R[ir] > vmax )
-                vmax = R[ir];
+            if( Rrow[x] > vmax )
+                vmax = Rrow[x];
         }
     }
 
@@ -2308,30 +2921,27 @@ void CCorImg::MakeSandRandA(
 
 // Create S =========================================
 
-    for( int i = 0; i < M; ++i ) {
-
-        double	mag = abs( fft1[i] );
-
-        if( mag > 1e-10 )
-            fft1[i] /= sqrt( mag );
-    }
-
-    IFT_2D( rslt, fft1, Nx, Ny, flog );
+    if( corrFloat )
+        IFT_2DF( rsltf, fftsf, Nx, Ny, flog );
+    else
+        IFT_2D( rslt, ffts, Nx, Ny, flog );
 
-    S.resize( nR );
+    S.assign( nR, 0.0 );
 
     vmin = 1e7, vmax = -1e7;
 
-    for( int y = -nnegy; y < nposy; ++y ) {
+    for( int y = ry0 - cy; y <= ry1 - cy; ++y ) {
 
-        int	iy = Nx * (y >= 0 ? y : Ny + y);
+        int	yc = y - y0,
+            iy = Nx * (yc >= 0 ? yc : Ny + yc);
 
-        for( int x = -nnegx; x < nposx; ++x ) {
+        for( int x = rx0 - cx; x <= rx1 - cx; ++x ) {
 
-            int	ix = (x >= 0 ? x : Nx + x);
+            int	xc = x - x0,
+                ix = (xc >= 0 ? xc : Nx + xc);
             int	ir = cx+x + wR*(cy+y);
 
-            S[ir] = calc.CalcS( rslt[ix+iy] );
+            S[ir] = calc.CalcS( corrFloat ? rsltf[ix+iy] : rslt[ix+iy] );
 
             if( S[ir] < vmin )
                 vmin = S[ir];
@@ -2355,8 +2965,11 @@ void CCorImg::MakeSandRandA(
         sprintf( simg, "thmA_%d.tif", _dbg_simgidx );
         CorrThmToTif8( simg, i1, Nx, w1, h1, flog );
 
+        vector<double>	i2;
+        ctxb.I2.Pad( i2, w2, h2 );
+
         sprintf( simg, "thmB_%d.tif", _dbg_simgidx );
-        CorrThmToTif8( simg, i2, Nx, w2, h2, flog );
+        CorrThmToTif8( simg, i2, w2, w2, h2, flog );
 
         sprintf( simg, "corr_A_%d.tif", _dbg_simgidx );
         Raster8ToTif8( simg, &A[0], wR, hR, flog );
@@ -2409,12 +3022,15 @@ void CCorImg::MakeSandRandA(
 //-1, -1, -1, -1, -1, -1, -1, -1, -1,
 //-1, -1, -1, -1, -1, -1, -1, -1, -1};
 
+// The kernel spectrum depends only on the R dims, so it is
+// kept in ws until those change.
+//
 void CCorImg::MakeF(
     vector<double>			&F,
     vector<uint8>			&A,
     const vector<double>	&R )
 {
-    vector<CD>	kfft;
+    vector<CD>	&kfft = ws->kfft;
     double		K[] = {
                 -1, -1, -1,
                 -1,  9, -1,
@@ -2423,7 +3039,14 @@ void CCorImg::MakeF(
     int			ksize	= (int)sqrt( sizeof(K) / sizeof(double) );
     int			grd		= ksize / 2;
 
-    Convolve( F, R, wR, hR, K, ksize, ksize, true, true, kfft, flog );
+    if( ws->kw != wR || ws->kh != hR ) {
+        kfft.clear();
+        ws->kw = wR;
+        ws->kh = hR;
+    }
+
+    _Convolve( F, R, wR, hR, K, ksize, ksize, true, true, kfft,
+        ws->cvi, ws->cvfft, flog );
 
 // Zero invalid border of width = grd (guard band)
 
@@ -2458,6 +3081,26 @@ void CCorImg::MakeF(
         }
     }
 
+    // outside computed R window, where R is only fill (CropB)
+    if( rx0 > 0 || ry0 > 0 || rx1 < wR - 1 || ry1 < hR - 1 ) {
+
+        for( int y = 0; y < hR; ++y ) {
+
+            bool	yin = (y >= ry0 + grd && y <= ry1 - grd);
+
+            for( int x = 0; x < wR; ++x ) {
+
+                if( !yin || x < rx0 + grd || x > rx1 - grd ) {
+
+                    int	i = x + wR*y;
+
+                    A[i] = 0;
+                    F[i] = 0.0;
+                }
+            }
+        }
+    }
+
 // Normalize the filtered image, keep positive only
 
     vmax = 1e-7;
@@ -2515,6 +3158,7 @@ bool CCorImg::OrderF(
 {
 // List F pixels in A
 
+    forder.clear();
     forder.reserve( nR );
 
     if( mincor > 0.0 ) {
@@ -2589,7 +3233,9 @@ bool CCorImg::FPeak(
 /* For efficiency, mask innermost peak areas as visited */
 /* ---------------------------------------------------- */
 
-    vector<uint8>	mask( nR, 0 );
+    vector<uint8>	&mask = ws->mask;
+
+    mask.assign( nR, 0 );
 
 /* --------------------------------------- */
 /* For each peak candidate (highest first) */
@@ -2780,7 +3426,9 @@ bool CCorImg::FPeak(
 /* For efficiency, mask innermost peak areas as visited */
 /* ---------------------------------------------------- */
 
-    vector<uint8>	mask( nR, 0 );
+    vector<uint8>	&mask = ws->mask;
+
+    mask.assign( nR, 0 );
 
 /* --------------------------------------- */
 /* For each peak candidate (highest first) */
@@ -3047,7 +3695,7 @@ double CCorImg::ReturnR(
 /* --------------------------------------------------------------- */
 
 // Return cross-correlation and additive displacement
-// (dx, dy) that places set ip1 into bounding box of ip2.
+// (dx, dy) that places image1 into bounding box of image2.
 //
 // mincor: If non-zero, used to prescreen F values during the
 // peak-hunting phase.
@@ -3056,22 +3704,21 @@ double CCorImg::ReturnR(
 // contains another pixel with F > nbmaxht*peak.
 //
 // {Ox,Oy,Rx,Ry}: If Rx > 0 and Ry > 0, search narrowed to oval
-// with origin (Ox,Oy) and semimajor axes Rx,Ry.
+// with origin (Ox,Oy) and semimajor axes Rx,Ry. A small oval
+// also narrows the correlation itself to the B window that
+// can reach it (see CCorImg::CropB).
 //
-// fft2: Cache of image2 FFT. On entry, if fft2 has the
-// correct size it is used. Otherwise recomputed here.
+// ctxb: Cache of image2 tables and FFTs, filled as needed.
+// Reuse it across calls that share the same image2.
 //
 // Version using F and well isolated F peak.
 //
-double CorrImagesF(
+static double _CorrImagesF(
     FILE					*flog,
     int						verbose,
     double					&dx,
     double					&dy,
-    const vector<Point>		&ip1,
-    const vector<double>	&iv1,
-    const vector<Point>		&ip2,
-    const vector<double>	&iv2,
+    const DenseImg			&I1,
     EvalType				LegalRgn,
     void*					arglr,
     EvalType				LegalCnt,
@@ -3082,20 +3729,21 @@ double CorrImagesF(
     int						Oy,
     int						Rx,
     int						Ry,
-    vector<CD>				&fft2 )
+    CorrCtxB				&ctxb )
 {
+    CorrWS			&ws		= ThreadWS();
     CCorImg			cc;
-    vector<double>	R;
-    vector<uint8>	A;
-    vector<double>	F;
-    vector<int>		forder;
+    vector<double>	&R		= ws.R;
+    vector<uint8>	&A		= ws.A;
+    vector<double>	&F		= ws.F;
+    vector<int>		&forder	= ws.forder;
     int				rx;
     int				ry;
 
     if( dbgCor )
         verbose = true;
 
-    if( !cc.SetDims( flog, verbose, ip1, ip2 ) ) {
+    if( !cc.SetDims( ws, flog, verbose, I1, ctxb ) ) {
 
         dx	= 0.0;
         dy	= 0.0;
@@ -3103,9 +3751,9 @@ double CorrImagesF(
         return 0.0;
     }
 
-    cc.MakeRandA( R, A, ip1, iv1, ip2, iv2,
+    cc.MakeRandA( R, A, I1,
         LegalRgn, arglr, LegalCnt, arglc,
-        Ox, Oy, Rx, Ry, fft2 );
+        Ox, Oy, Rx, Ry, ctxb );
 
     cc.MakeF( F, A, R );
 
@@ -3121,12 +3769,77 @@ double CorrImagesF(
     return cc.ReturnR( dx, dy, rx, ry, R, R );
 }
 
+
+// Point-list images: painted as by ImageFromValuesAndPoints.
+//
+double CorrImagesF(
+    FILE					*flog,
+    int						verbose,
+    double					&dx,
+    double					&dy,
+    const vector<Point>		&ip1,
+    const vector<double>	&iv1,
+    const vector<Point>		&ip2,
+    const vector<double>	&iv2,
+    EvalType				LegalRgn,
+    void*					arglr,
+    EvalType				LegalCnt,
+    void*					arglc,
+    double					mincor,
+    double					nbmaxht,
+    int						Ox,
+    int						Oy,
+    int						Rx,
+    int						Ry,
+    CorrCtxB				&ctxb )
+{
+    DenseImg	I1;
+
+    I1.FromPoints( ip1, iv1 );
+    ctxb.Bind( ip2, iv2 );
+
+    return _CorrImagesF(
+        flog, verbose, dx, dy, I1,
+        LegalRgn, arglr, LegalCnt, arglc,
+        mincor, nbmaxht, Ox, Oy, Rx, Ry, ctxb );
+}
+
+
+// Dense images.
+//
+double CorrImagesF(
+    FILE					*flog,
+    int						verbose,
+    double					&dx,
+    double					&dy,
+    const DenseImg			&I1,
+    const DenseImg			&I2,
+    EvalType				LegalRgn,
+    void*					arglr,
+    EvalType				LegalCnt,
+    void*					arglc,
+    double					mincor,
+    double					nbmaxht,
+    int						Ox,
+    int						Oy,
+    int						Rx,
+    int						Ry,
+    CorrCtxB				&ctxb )
+{
+    ctxb.Bind( I2 );
+
+    return _CorrImagesF(
+        flog, verbose, dx, dy, I1,
+        LegalRgn, arglr, LegalCnt, arglc,
+        mincor, nbmaxht, Ox, Oy, Rx, Ry, ctxb );
+}
+
 /* --------------------------------------------------------------- */
 /* CorrImagesR --------------------------------------------------- */
 /* --------------------------------------------------------------- */
 
 // Return cross-correlation and additive displacement
-// (dx, dy) that places set ip1 into bounding box of ip2.
+// (dx, dy) that places image1 into bounding box of image2.
 //
 // mincor: If non-zero, used to prescreen R values during the
 // peak-hunting phase.
@@ -3134,22 +3847,21 @@ double CorrImagesF(
 // nbmaxht: Dummy slot for compatibility with F-version.
 //
 // {Ox,Oy,Rx,Ry}: If Rx > 0 and Ry > 0, search narrowed to oval
-// with origin (Ox,Oy) and semimajor axes Rx,Ry.
+// with origin (Ox,Oy) and semimajor axes Rx,Ry. A small oval
+// also narrows the correlation itself to the B window that
+// can reach it (see CCorImg::CropB).
 //
-// fft2: Cache of image2 FFT. On entry, if fft2 has the
-// correct size it is used. Otherwise recomputed here.
+// ctxb: Cache of image2 tables and FFTs, filled as needed.
+// Reuse it across calls that share the same image2.
 //
 // Version using straight max R.
 //
-double CorrImagesR(
+static double _CorrImagesR(
     FILE					*flog,
     int						verbose,
     double					&dx,
     double					&dy,
-    const vector<Point>		&ip1,
-    const vector<double>	&iv1,
-    const vector<Point>		&ip2,
-    const vector<double>	&iv2,
+    const DenseImg			&I1,
     EvalType				LegalRgn,
     void*					arglr,
     EvalType				LegalCnt,
@@ -3160,19 +3872,20 @@ double CorrImagesR(
     int						Oy,
     int						Rx,
     int						Ry,
-    vector<CD>				&fft2 )
+    CorrCtxB				&ctxb )
 {
+    CorrWS			&ws		= ThreadWS();
     CCorImg			cc;
-    vector<double>	R;
-    vector<uint8>	A;
-    vector<int>		order;
+    vector<double>	&R		= ws.R;
+    vector<uint8>	&A		= ws.A;
+    vector<int>		&order	= ws.forder;
     int				rx;
     int				ry;
 
     if( dbgCor )
         verbose = true;
 
-    if( !cc.SetDims( flog, verbose, ip1, ip2 ) ) {
+    if( !cc.SetDims( ws, flog, verbose, I1, ctxb ) ) {
 
         dx	= 0.0;
         dy	= 0.0;
@@ -3180,9 +3893,9 @@ double CorrImagesR(
         return 0.0;
     }
 
-    cc.MakeRandA( R, A, ip1, iv1, ip2, iv2,
+    cc.MakeRandA( R, A, I1,
         LegalRgn, arglr, LegalCnt, arglc,
-        Ox, Oy, Rx, Ry, fft2 );
+        Ox, Oy, Rx, Ry, ctxb );
 
     // actually orders R, here
     if( !cc.OrderF( order, R, A, R, mincor ) ) {
@@ -3198,12 +3911,77 @@ double CorrImagesR(
     return cc.ReturnR( dx, dy, rx, ry, R, R );
 }
 
+
+// Point-list images: painted as by ImageFromValuesAndPoints.
+//
+double CorrImagesR(
+    FILE					*flog,
+    int						verbose,
+    double					&dx,
+    double					&dy,
+    const vector<Point>		&ip1,
+    const vector<double>	&iv1,
+    const vector<Point>		&ip2,
+    const vector<double>	&iv2,
+    EvalType				LegalRgn,
+    void*					arglr,
+    EvalType				LegalCnt,
+    void*					arglc,
+    double					mincor,
+    double					nbmaxht,
+    int						Ox,
+    int						Oy,
+    int						Rx,
+    int						Ry,
+    CorrCtxB				&ctxb )
+{
+    DenseImg	I1;
+
+    I1.FromPoints( ip1, iv1 );
+    ctxb.Bind( ip2, iv2 );
+
+    return _CorrImagesR(
+        flog, verbose, dx, dy, I1,
+        LegalRgn, arglr, LegalCnt, arglc,
+        mincor, nbmaxht, Ox, Oy, Rx, Ry, ctxb );
+}
+
+
+// Dense images.
+//
+double CorrImagesR(
+    FILE					*flog,
+    int						verbose,
+    double					&dx,
+    double					&dy,
+    const DenseImg			&I1,
+    const DenseImg			&I2,
+    EvalType				LegalRgn,
+    void*					arglr,
+    EvalType				LegalCnt,
+    void*					arglc,
+    double					mincor,
+    double					nbmaxht,
+    int						Ox,
+    int						Oy,
+    int						Rx,
+    int						Ry,
+    CorrCtxB				&ctxb )
+{
+    ctxb.Bind( I2 );
+
+    return _CorrImagesR(
+        flog, verbose, dx, dy, I1,
+        LegalRgn, arglr, LegalCnt, arglc,
+        mincor, nbmaxht, Ox, Oy, Rx, Ry, ctxb );
+}
+
 /* --------------------------------------------------------------- */
 /* CorrImagesS --------------------------------------------------- */
 /* --------------------------------------------------------------- */
 
 // Return cross-correlation and additive displacement
-// (dx, dy) that places set ip1 into bounding box of ip2.
+// (dx, dy) that places image1 into bounding box of image2.
 //
 // mincor: If non-zero, used to prescreen S values during the
 // peak-hunting phase.
@@ -3213,21 +3991,18 @@ double CorrImagesR(
 // {Ox,Oy,Rx,Ry}: If Rx > 0 and Ry > 0, search narrowed to oval
 // with origin (Ox,Oy) and semimajor axes Rx,Ry.
 //
-// fft2: Cache of image2 FFT. On entry, if fft2 has the
-// correct size it is used. Otherwise recomputed here.
+// ctxb: Cache of image2 tables and FFTs, filled as needed.
+// Reuse it across calls that share the same image2.
 //
 // Version using FFT power spectrum filtering as prescribed
 // by Art Wetzel, followed by straight max S.
 //
-double CorrImagesS(
+static double _CorrImagesS(
     FILE					*flog,
     int						verbose,
     double					&dx,
     double					&dy,
-    const vector<Point>		&ip1,
-    const vector<double>	&iv1,
-    const vector<Point>		&ip2,
-    const vector<double>	&iv2,
+    const DenseImg			&I1,
     EvalType				LegalRgn,
     void*					arglr,
     EvalType				LegalCnt,
@@ -3238,20 +4013,21 @@ double CorrImagesS(
     int						Oy,
     int						Rx,
     int						Ry,
-    vector<CD>				&fft2 )
+    CorrCtxB				&ctxb )
 {
+    CorrWS			&ws		= ThreadWS();
     CCorImg			cc;
-    vector<double>	R;
-    vector<uint8>	A;
-    vector<double>	S;
-    vector<int>		order;
+    vector<double>	&R		= ws.R;
+    vector<uint8>	&A		= ws.A;
+    vector<double>	&S		= ws.S;
+    vector<int>		&order	= ws.forder;
     int				rx;
     int				ry;
 
     if( dbgCor )
         verbose = true;
 
-    if( !cc.SetDims( flog, verbose, ip1, ip2 ) ) {
+    if( !cc.SetDims( ws, flog, verbose, I1, ctxb ) ) {
 
         dx	= 0.0;
         dy	= 0.0;
@@ -3259,9 +4035,9 @@ double CorrImagesS(
         return 0.0;
     }
 
-    cc.MakeSandRandA( S, R, A, ip1, iv1, ip2, iv2,
+    cc.MakeSandRandA( S, R, A, I1,
         LegalRgn, arglr, LegalCnt, arglc,
-        Ox, Oy, Rx, Ry, fft2 );
+        Ox, Oy, Rx, Ry, ctxb );
 
     // actually orders S, here
     if( !cc.OrderF( order, S, A, R, mincor ) ) {
@@ -3290,3 +4066,68 @@ double CorrImagesS(
 }
 
 
+// Point-list images: painted as by ImageFromValuesAndPoints.
+//
+double CorrImagesS(
+    FILE					*flog,
+    int						verbose,
+    double					&dx,
+    double					&dy,
+    const vector<Point>		&ip1,
+    const vector<double>	&iv1,
+    const vector<Point>		&ip2,
+    const vector<double>	&iv2,
+    EvalType				LegalRgn,
+    void*					arglr,
+    EvalType				LegalCnt,
+    void*					arglc,
+    double					mincor,
+    double					nbmaxht,
+    int						Ox,
+    int						Oy,
+    int						Rx,
+    int						Ry,
+    CorrCtxB				&ctxb )
+{
+    DenseImg	I1;
+
+    I1.FromPoints( ip1, iv1 );
+    ctxb.Bind( ip2, iv2 );
+
+    return _CorrImagesS(
+        flog, verbose, dx, dy, I1,
+        LegalRgn, arglr, LegalCnt, arglc,
+        mincor, nbmaxht, Ox, Oy, Rx, Ry, ctxb );
+}
+
+
+// Dense images.
+//
+double CorrImagesS(
+    FILE					*flog,
+    int						verbose,
+    double					&dx,
+    double					&dy,
+    const DenseImg			&I1,
+    const DenseImg			&I2,
+    EvalType				LegalRgn,
+    void*					arglr,
+    EvalType				LegalCnt,
+    void*					arglc,
+    double					mincor,
+    double					nbmaxht,
+    int						Ox,
+    int						Oy,
+    int						Rx,
+    int						Ry,
+    CorrCtxB				&ctxb )
+{
+    ctxb.Bind( I2 );
+
+    return _CorrImagesS(
+        flog, verbose, dx, dy, I1,
+        LegalRgn, arglr, LegalCnt, arglc,
+        mincor, nbmaxht, Ox, Oy, Rx, Ry, ctxb );
+}
+
+
@@ -5,9 +5,21 @@
 
 #include	"GenDefs.h"
 #include	"CPoint.h"
+#include	"DenseImg.h"
 
 #include	<stdio.h>
 
+#include	<list>
+using namespace std;
+
+
+/* --------------------------------------------------------------- */
+/* Globals ------------------------------------------------------- */
+/* --------------------------------------------------------------- */
+
+// Run CorrImagesX FFTs in single precision. Defaults to true
+// if built with ALN_CORR_FLOAT. Set before any threads start.
+extern bool corrFloat;
 
 /* --------------------------------------------------------------- */
 /* FFT support --------------------------------------------------- */
@@ -27,7 +39,21 @@ int FFT_2D(
 
 void IFT_2D(
     vector<double>			&out,
-    const vector<CD>		&in,
+    vector<CD>				&in,
+    int						Nfast,
+    int						Nslow,
+    FILE					*flog = stderr );
+
+int FFT_2DF(
+    vector<CF>				&out,
+    const vector<float>		&in,
+    int						Nfast,
+    int						Nslow,
+    FILE					*flog = stderr );
+
+void IFT_2DF(
+    vector<float>			&out,
+    vector<CF>				&in,
     int						Nfast,
     int						Nslow,
     FILE					*flog = stderr );
@@ -156,6 +182,73 @@ double ImproveControlPts(
 // &&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&
 // &&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&
 
+class CorrCtxB {
+// Image2 (B) state for a sweep of CorrImagesX calls that vary
+// only image1: raster, bbox, integral tables and up to FT_MAXCACHE
+// padded FFTs keyed on FFT size and B window, in MRU order. May
+// be shared by sweep threads: an FFT entry is filled once, by the
+// thread that missed, and is pinned (nref) while a caller reads
+// it. Call clear() if B changes (no sweep in progress).
+//
+// Optional envelope E1 bounds every image1 placement (bbox) in a
+// coming sweep. FFT size and cropped B window are then derived
+// from E1 rather than each image1, so all calls in the sweep
+// share one FFT. Set it before the sweep threads start.
+public:
+    class FT {
+    public:
+        int			Nx, Ny,
+                    x0, y0,	// B window, B-local coords
+                    wc, hc,
+                    nref;	// pinned by FFT(), until Release()
+        bool		filling;
+        vector<CD>	fft;	// if !corrFloat
+        vector<CF>	fftf;	// if corrFloat
+    public:
+        FT() : nref(0), filling(false) {};
+    };
+private:
+    void Tables();
+public:
+    DenseImg		I2;
+    IBox			B2;
+    int				w2, h2,
+                    n2;		// bind key; 0 = unbound
+    vector<double>	sum, sum2;
+    vector<int>		nz;
+    list<FT>		lft;
+    IBox			E1;		// image1 envelope; L > R = none
+public:
+    CorrCtxB() : n2(0) {E1.L = 0; E1.R = -1;};
+
+    void clear()
+        {
+            n2 = 0; I2.clear();
+            sum.clear(); sum2.clear(); nz.clear(); lft.clear();
+            E1.L = 0; E1.R = -1;
+        };
+
+    void SetEnvelope( const IBox &E )
+        {E1 = E;};
+
+    void Bind(
+        const vector<Point>		&ip2,
+        const vector<double>	&iv2 );
+
+    void Bind( const DenseImg &I );
+
+    const FT& FFT(
+        int						Nx,
+        int						Ny,
+        int						x0,
+        int						y0,
+        int						wc,
+        int						hc,
+        FILE					*flog );
+
+    void Release( const FT &ft );
+};
+
 double CorrImagesF(
     FILE					*flog,
     int						verbose,
@@ -175,7 +268,26 @@ double CorrImagesF(
     int						Oy,
     int						Rx,
     int						Ry,
-    vector<CD>				&fft2 );
+    CorrCtxB				&ctxb );
+
+double CorrImagesF(
+    FILE					*flog,
+    int						verbose,
+    double					&dx,
+    double					&dy,
+    const DenseImg			&I1,
+    const DenseImg			&I2,
+    EvalType				LegalRgn,
+    void*					arglr,
+    EvalType				LegalCnt,
+    void*					arglc,
+    double					mincor,
+    double					nbmaxht,
+    int						Ox,
+    int						Oy,
+    int						Rx,
+    int						Ry,
+    CorrCtxB				&ctxb );
 
 double CorrImagesR(
     FILE					*flog,
@@ -196,7 +308,26 @@ double CorrImagesR(
     int						Oy,
     int						Rx,
     int						Ry,
-    vector<CD>				&fft2 );
+    CorrCtxB				&ctxb );
+
+double CorrImagesR(
+    FILE					*flog,
+    int						verbose,
+    double					&dx,
+    double					&dy,
+    const DenseImg			&I1,
+    const DenseImg			&I2,
+    EvalType				LegalRgn,
+    void*					arglr,
+    EvalType				LegalCnt,
+    void*					arglc,
+    double					mincor,
+    double					nbmaxht,
+    int						Ox,
+    int						Oy,
+    int						Rx,
+    int						Ry,
+    CorrCtxB				&ctxb );
 
 double CorrImagesS(
     FILE					*flog,
@@ -217,6 +348,25 @@ double CorrImagesS(
     int						Oy,
     int						Rx,
     int						Ry,
-    vector<CD>				&fft2 );
+    CorrCtxB				&ctxb );
+
+double CorrImagesS(
+    FILE					*flog,
+    int						verbose,
+    double					&dx,
+    double					&dy,
+    const DenseImg			&I1,
+    const DenseImg			&I2,
+    EvalType				LegalRgn,
+    void*					arglr,
+    EvalType				LegalCnt,
+    void*					arglc,
+    double					mincor,
+    double					nbmaxht,
+    int						Ox,
+    int						Oy,
+    int						Rx,
+    int						Ry,
+    CorrCtxB				&ctxb );
 
 
@@ -1,7 +1,251 @@
 
 
+// Notes
+// -----
+// fftw planning is not thread-safe, but executing an existing plan
+// on new arrays via fftw_execute_dft_xxx() is. We therefore keep a
+// per-thread cache of plans keyed on {Nfast, Nslow, direction,
+// alignment}. Only plan creation takes mutex_plan, and only on a
+// cache miss; plans are made with FFTW_MEASURE on scratch buffers
+// so the accumulated wisdom makes later same-size plans (e.g. on
+// sibling sweep threads) nearly free. Thereafter all transforms
+// run lock-free on caller-owned buffers.
+//
+// Measuring very large one-off transforms (e.g. full-frame
+// filtering) costs more than it saves, so above MEASURE_MAXPTS
+// we fall back to FFTW_ESTIMATE.
+//
+// Single precision (fftwf, for corrFloat) keeps a parallel plan
+// cache; link libfftw3f as well as libfftw3.
+//
+
 #include	"fftw3.h"
 
+#include	<map>
+
+
+/* --------------------------------------------------------------- */
+/* Macros -------------------------------------------------------- */
+/* --------------------------------------------------------------- */
+
+#define	MEASURE_MAXPTS	(2048 * 2048)
+
+/* --------------------------------------------------------------- */
+/* Plan cache ---------------------------------------------------- */
+/* --------------------------------------------------------------- */
+
+class PlanKey {
+public:
+    int	Nfast, Nslow, dir, aligned;
+public:
+    PlanKey( int Nfast, int Nslow, int dir, int aligned )
+    : Nfast(Nfast), Nslow(Nslow), dir(dir), aligned(aligned) {};
+
+    bool operator < ( const PlanKey &rhs ) const
+    {
+        if( Nfast != rhs.Nfast )
+            return Nfast < rhs.Nfast;
+        if( Nslow != rhs.Nslow )
+            return Nslow < rhs.Nslow;
+        if( dir != rhs.dir )
+            return dir < rhs.dir;
+        return aligned < rhs.aligned;
+    };
+};
+
+typedef map<PlanKey,fftw_plan>	PlanMap;
+typedef map<PlanKey,fftwf_plan>	PlanMapF;
+
+// mutex_plan guards {fftw(f) planners, fftw(f) wisdom}
+static pthread_mutex_t	mutex_plan	= PTHREAD_MUTEX_INITIALIZER;
+static pthread_key_t	key_plans, key_plansf;
+static pthread_once_t	once_plans	= PTHREAD_ONCE_INIT;
+
+/* --------------------------------------------------------------- */
+/* FreePlans ----------------------------------------------------- */
+/* --------------------------------------------------------------- */
+
+// Thread exit destructor for that thread's plan cache.
+//
+static void FreePlans( void *v )
+{
+    PlanMap	*pm = (PlanMap*)v;
+
+    pthread_mutex_lock( &mutex_plan );
+
+    for( PlanMap::iterator it = pm->begin(); it != pm->end(); ++it )
+        fftw_destroy_plan( it->second );
+
+    pthread_mutex_unlock( &mutex_plan );
+
+    delete pm;
+}
+
+
+static void FreePlansF( void *v )
+{
+    PlanMapF	*pm = (PlanMapF*)v;
+
+    pthread_mutex_lock( &mutex_plan );
+
+    for( PlanMapF::iterator it = pm->begin(); it != pm->end(); ++it )
+        fftwf_destroy_plan( it->second );
+
+    pthread_mutex_unlock( &mutex_plan );
+
+    delete pm;
+}
+
+/* --------------------------------------------------------------- */
+/* MakePlanKey --------------------------------------------------- */
+/* --------------------------------------------------------------- */
+
+static void MakePlanKey()
+{
+    pthread_key_create( &key_plans, FreePlans );
+    pthread_key_create( &key_plansf, FreePlansF );
+}
+
+/* --------------------------------------------------------------- */
+/* ThreadPlans --------------------------------------------------- */
+/* --------------------------------------------------------------- */
+
+static PlanMap& ThreadPlans()
+{
+    pthread_once( &once_plans, MakePlanKey );
+
+    PlanMap	*pm = (PlanMap*)pthread_getspecific( key_plans );
+
+    if( !pm ) {
+        pm = new PlanMap;
+        pthread_setspecific( key_plans, pm );
+    }
+
+    return *pm;
+}
+
+
+static PlanMapF& ThreadPlansF()
+{
+    pthread_once( &once_plans, MakePlanKey );
+
+    PlanMapF	*pm = (PlanMapF*)pthread_getspecific( key_plansf );
+
+    if( !pm ) {
+        pm = new PlanMapF;
+        pthread_setspecific( key_plansf, pm );
+    }
+
+    return *pm;
+}
+
+/* --------------------------------------------------------------- */
+/* GetPlan ------------------------------------------------------- */
+/* --------------------------------------------------------------- */
+
+// Return calling thread's plan for given size and direction
+// (FFTW_FORWARD = r2c, FFTW_BACKWARD = c2r), creating it if
+// needed. Plans made against SIMD-aligned scratch may only be
+// executed on equally aligned arrays, so unaligned callers get
+// a separate FFTW_UNALIGNED plan.
+//
+static fftw_plan GetPlan(
+    int			Nfast,
+    int			Nslow,
+    int			dir,
+    const void	*in,
+    const void	*out )
+{
+    int		aligned =
+                !fftw_alignment_of( (double*)in ) &&
+                !fftw_alignment_of( (double*)out );
+    PlanKey	key( Nfast, Nslow, dir, aligned );
+    PlanMap	&pm = ThreadPlans();
+
+    PlanMap::iterator	it = pm.find( key );
+
+    if( it != pm.end() )
+        return it->second;
+
+// Create new plan on scratch arrays (MEASURE overwrites them)
+
+    int		N		= Nslow * Nfast,
+            M		= Nslow * (Nfast/2 + 1);
+    unsigned flags	= (N <= MEASURE_MAXPTS ? FFTW_MEASURE : FFTW_ESTIMATE)
+                    | (aligned ? 0 : FFTW_UNALIGNED);
+
+    pthread_mutex_lock( &mutex_plan );
+
+    double			*R = fftw_alloc_real( N );
+    fftw_complex	*C = fftw_alloc_complex( M );
+    fftw_plan		p;
+
+    if( dir == FFTW_FORWARD )
+        p = fftw_plan_dft_r2c_2d( Nslow, Nfast, R, C, flags );
+    else
+        p = fftw_plan_dft_c2r_2d( Nslow, Nfast, C, R, flags );
+
+    fftw_free( C );
+    fftw_free( R );
+
+    pthread_mutex_unlock( &mutex_plan );
+
+    pm[key] = p;
+
+    return p;
+}
+
+/* --------------------------------------------------------------- */
+/* GetPlanF ------------------------------------------------------ */
+/* --------------------------------------------------------------- */
+
+// Single precision version of GetPlan.
+//
+static fftwf_plan GetPlanF(
+    int			Nfast,
+    int			Nslow,
+    int			dir,
+    const void	*in,
+    const void	*out )
+{
+    int		aligned =
+                !fftwf_alignment_of( (float*)in ) &&
+                !fftwf_alignment_of( (float*)out );
+    PlanKey	key( Nfast, Nslow, dir, aligned );
+    PlanMapF	&pm = ThreadPlansF();
+
+    PlanMapF::iterator	it = pm.find( key );
+
+    if( it != pm.end() )
+        return it->second;
+
+// Create new plan on scratch arrays (MEASURE overwrites them)
+
+    int		N		= Nslow * Nfast,
+            M		= Nslow * (Nfast/2 + 1);
+    unsigned flags	= (N <= MEASURE_MAXPTS ? FFTW_MEASURE : FFTW_ESTIMATE)
+                    | (aligned ? 0 : FFTW_UNALIGNED);
+
+    pthread_mutex_lock( &mutex_plan );
+
+    float			*R = fftwf_alloc_real( N );
+    fftwf_complex	*C = fftwf_alloc_complex( M );
+    fftwf_plan		p;
+
+    if( dir == FFTW_FORWARD )
+        p = fftwf_plan_dft_r2c_2d( Nslow, Nfast, R, C, flags );
+    else
+        p = fftwf_plan_dft_c2r_2d( Nslow, Nfast, C, R, flags );
+
+    fftwf_free( C );
+    fftwf_free( R );
+
+    pthread_mutex_unlock( &mutex_plan );
+
+    pm[key] = p;
+
+    return p;
+}
 
 /* --------------------------------------------------------------- */
 /* _FFT_2D ------------------------------------------------------- */
@@ -17,13 +261,10 @@ static void _FFT_2D(
 
     out.resize( M );
 
-    fftw_plan	p;
+    fftw_plan	p = GetPlan( Nfast, Nslow, FFTW_FORWARD, &in[0], &out[0] );
 
-    p = fftw_plan_dft_r2c_2d( Nslow, Nfast, (double*)&in[0],
-            (double (*)[2])&out[0], FFTW_ESTIMATE );
-
-    fftw_execute( p );
-    fftw_destroy_plan( p );
+    // r2c plans preserve input by default
+    fftw_execute_dft_r2c( p, (double*)&in[0], (fftw_complex*)&out[0] );
 }
 
 /* --------------------------------------------------------------- */
@@ -45,12 +286,17 @@ int FFT_2D(
 {
     int	M = Nslow * (Nfast/2 + 1);
 
-    pthread_mutex_lock( &mutex_fft );
+    if( cached ) {
 
-    if( !cached || out.size() != M )
-        _FFT_2D( out, in, Nfast, Nslow );
+        pthread_mutex_lock( &mutex_fft );
 
-    pthread_mutex_unlock( &mutex_fft );
+        if( out.size() != M )
+            _FFT_2D( out, in, Nfast, Nslow );
+
+        pthread_mutex_unlock( &mutex_fft );
+    }
+    else
+        _FFT_2D( out, in, Nfast, Nslow );
 
     return M;
 }
@@ -64,9 +310,12 @@ int FFT_2D(
 // Creates output data in row-major order. That is,
 // ordered like a C-array: out[Nslow][Nfast].
 //
+// Note: Input is used as scratch and is destroyed. fftw has
+// no input-preserving multi-dimensional c2r algorithm.
+//
 void IFT_2D(
     vector<double>			&out,
-    const vector<CD>		&in,
+    vector<CD>				&in,
     int						Nfast,
     int						Nslow,
     FILE					*flog )
@@ -75,20 +324,55 @@ void IFT_2D(
 
     out.resize( N );
 
-    pthread_mutex_lock( &mutex_fft );
+    fftw_plan	p = GetPlan( Nfast, Nslow, FFTW_BACKWARD, &in[0], &out[0] );
+
+    fftw_execute_dft_c2r( p, (fftw_complex*)&in[0], &out[0] );
+}
+
+/* --------------------------------------------------------------- */
+/* FFT_2DF ------------------------------------------------------- */
+/* --------------------------------------------------------------- */
+
+// Single precision FFT_2D (no caching option).
+//
+int FFT_2DF(
+    vector<CF>				&out,
+    const vector<float>		&in,
+    int						Nfast,
+    int						Nslow,
+    FILE					*flog )
+{
+    int	M = Nslow * (Nfast/2 + 1);
 
-    fftw_plan	p;
+    out.resize( M );
 
-    // fftw_plan_dft_c2r_2d() modifies input
-    const vector<CD>	_in = in;
+    fftwf_plan	p = GetPlanF( Nfast, Nslow, FFTW_FORWARD, &in[0], &out[0] );
 
-    p = fftw_plan_dft_c2r_2d( Nslow, Nfast, (double (*)[2])&_in[0],
-            &out[0], FFTW_ESTIMATE );
+    fftwf_execute_dft_r2c( p, (float*)&in[0], (fftwf_complex*)&out[0] );
+
+    return M;
+}
+
+/* --------------------------------------------------------------- */
+/* IFT_2DF ------------------------------------------------------- */
+/* --------------------------------------------------------------- */
+
+// Single precision IFT_2D. Input is destroyed.
+//
+void IFT_2DF(
+    vector<float>			&out,
+    vector<CF>				&in,
+    int						Nfast,
+    int						Nslow,
+    FILE					*flog )
+{
+    int	N = Nslow * Nfast;
+
+    out.resize( N );
 
-    fftw_execute( p );
-    fftw_destroy_plan( p );
+    fftwf_plan	p = GetPlanF( Nfast, Nslow, FFTW_BACKWARD, &in[0], &out[0] );
 
-    pthread_mutex_unlock( &mutex_fft );
+    fftwf_execute_dft_c2r( p, (fftwf_complex*)&in[0], &out[0] );
 }
 
 
@@ -126,9 +126,12 @@ int FFT_2D(
 // Creates output data in row-major order. That is,
 // ordered like a C-array: out[Nslow][Nfast].
 //
+// Note: For parity with the fftw version, callers must treat
+// input as destroyed (MKL happens to preserve it).
+//
 void IFT_2D(
     vector<double>			&out,
-    const vector<CD>		&in,
+    vector<CD>				&in,
     int						Nfast,
     int						Nslow,
     FILE					*flog )
@@ -178,7 +181,135 @@ void IFT_2D(
     MKLCheck( status, flog );
 
     status = DftiComputeBackward( h,
-                (double*)&in[0],
+                &in[0],
+                &out[0] );
+    MKLCheck( status, flog );
+
+    status = DftiFreeDescriptor( &h );
+    MKLCheck( status, flog );
+}
+
+/* --------------------------------------------------------------- */
+/* FFT_2DF ------------------------------------------------------- */
+/* --------------------------------------------------------------- */
+
+// Single precision FFT_2D (no caching option).
+//
+int FFT_2DF(
+    vector<CF>				&out,
+    const vector<float>		&in,
+    int						Nfast,
+    int						Nslow,
+    FILE					*flog )
+{
+    int	Nhlf = (Nfast/2 + 1), M = Nslow * Nhlf;
+
+    out.resize( M );
+
+    DFTI_DESCRIPTOR_HANDLE	h;
+    MKL_LONG				dim[2]  = {Nslow, Nfast},
+                            stro[3] = {0, Nhlf, 1},
+                            status;
+
+    status = DftiCreateDescriptor( &h,
+                DFTI_SINGLE,
+                DFTI_REAL,
+                2, dim );
+    MKLCheck( status, flog );
+
+    status = DftiSetValue( h,
+                DFTI_NUMBER_OF_USER_THREADS,
+                1 );
+    MKLCheck( status, flog );
+
+    status = DftiSetValue( h,
+                DFTI_CONJUGATE_EVEN_STORAGE,
+                DFTI_COMPLEX_COMPLEX );
+    MKLCheck( status, flog );
+
+    status = DftiSetValue( h,
+                DFTI_OUTPUT_STRIDES,
+                stro );
+    MKLCheck( status, flog );
+
+    status = DftiSetValue( h,
+                DFTI_PLACEMENT,
+                DFTI_NOT_INPLACE );
+    MKLCheck( status, flog );
+
+    status = DftiCommitDescriptor( h );
+    MKLCheck( status, flog );
+
+    status = DftiComputeForward( h,
+                (float*)&in[0],
+                &out[0] );
+    MKLCheck( status, flog );
+
+    status = DftiFreeDescriptor( &h );
+    MKLCheck( status, flog );
+
+    return M;
+}
+
+/* --------------------------------------------------------------- */
+/* IFT_2DF ------------------------------------------------------- */
+/* --------------------------------------------------------------- */
+
+// Single precision IFT_2D. Treat input as destroyed.
+//
+void IFT_2DF(
+    vector<float>			&out,
+    vector<CF>				&in,
+    int						Nfast,
+    int						Nslow,
+    FILE					*flog )
+{
+    int	Nhlf = (Nfast/2 + 1);
+
+    out.resize( Nslow * Nfast );
+
+    DFTI_DESCRIPTOR_HANDLE	h;
+    MKL_LONG				dim[2]  = {Nslow, Nfast},
+                            stri[3] = {0, Nhlf,  1},
+                            stro[3] = {0, Nfast, 1},
+                            status;
+
+    status = DftiCreateDescriptor( &h,
+                DFTI_SINGLE,
+                DFTI_REAL,
+                2, dim );
+    MKLCheck( status, flog );
+
+    status = DftiSetValue( h,
+                DFTI_NUMBER_OF_USER_THREADS,
+                1 );
+    MKLCheck( status, flog );
+
+    status = DftiSetValue( h,
+                DFTI_CONJUGATE_EVEN_STORAGE,
+                DFTI_COMPLEX_COMPLEX );
+    MKLCheck( status, flog );
+
+    status = DftiSetValue( h,
+                DFTI_INPUT_STRIDES,
+                stri );
+    MKLCheck( status, flog );
+
+    status = DftiSetValue( h,
+                DFTI_OUTPUT_STRIDES,
+                stro );
+    MKLCheck( status, flog );
+
+    status = DftiSetValue( h,
+                DFTI_PLACEMENT,
+                DFTI_NOT_INPLACE );
+    MKLCheck( status, flog );
+
+    status = DftiCommitDescriptor( h );
+    MKLCheck( status, flog );
+
+    status = DftiComputeBackward( h,
+                &in[0],
                 &out[0] );
     MKLCheck( status, flog );
 
@@ -0,0 +1,322 @@
+
+
+#include	"DenseImg.h"
+#include	"Geometry.h"
+#include	"Maths.h"
+
+#include	<math.h>
+
+
+/* --------------------------------------------------------------- */
+/* Statics ------------------------------------------------------- */
+/* --------------------------------------------------------------- */
+
+// Floor of a/b for b > 0.
+//
+static inline int FloorDiv( int a, int b )
+{
+    return (a >= 0 ? a / b : -((b - 1 - a) / b));
+}
+
+
+
+
+
+
+/* --------------------------------------------------------------- */
+/* NValid -------------------------------------------------------- */
+/* --------------------------------------------------------------- */
+
+int DenseImg::NValid() const
+{
+    int	n = w * h;
+
+    if( !m.size() )
+        return n;
+
+    int	k = 0;
+
+    for( int i = 0; i < n; ++i )
+        k += (m[i] != 0);
+
+    return k;
+}
+
+/* --------------------------------------------------------------- */
+/* FromPoints ---------------------------------------------------- */
+/* --------------------------------------------------------------- */
+
+// Build from point list, painting values as for
+// ImageFromValuesAndPoints (bilinear splat), so integer
+// points land exactly on pixels. Origin and dims come from
+// the point bbox; pixels hit by no point are invalid.
+//
+void DenseImg::FromPoints(
+    const vector<Point>		&p,
+    const vector<double>	&val )
+{
+    int	np = p.size();
+
+    if( !np ) {
+        clear();
+        return;
+    }
+
+    IBox	B;
+
+    BBoxFromPoints( B, p );
+
+    x0	= B.L;
+    y0	= B.B;
+    w	= B.R - B.L + 1;
+    h	= B.T - B.B + 1;
+
+    vector<double>	I;
+
+    ImageFromValuesAndPoints( I, w, h, val, p, x0, y0 );
+
+    v.assign( I.begin(), I.end() );
+    m.assign( w * h, 0 );
+
+    for( int i = 0; i < np; ++i ) {
+
+        int	ix = (int)floor( p[i].x ) - x0,
+            iy = (int)floor( p[i].y ) - y0;
+
+        m[ix + w*iy] = 1;
+    }
+}
+
+/* --------------------------------------------------------------- */
+/* Decimate ------------------------------------------------------ */
+/* --------------------------------------------------------------- */
+
+// Average valid pixels in lbin x lbin bins aligned to coords,
+// so that pixel (x,y) goes to bin (x/lbin, y/lbin), as in
+// DecimateVector. Bins with no valid pixels are invalid.
+//
+void DenseImg::Decimate( int lbin )
+{
+    if( lbin <= 1 || !w || !h )
+        return;
+
+    int	X0 = FloorDiv( x0, lbin ),
+        Y0 = FloorDiv( y0, lbin ),
+        W  = FloorDiv( x0 + w - 1, lbin ) - X0 + 1,
+        H  = FloorDiv( y0 + h - 1, lbin ) - Y0 + 1,
+        N  = W * H;
+
+    vector<double>	vr( N, 0.0 );
+    vector<int>		cr( N, 0 );
+
+    for( int y = 0; y < h; ++y ) {
+
+        int	iy = W * (FloorDiv( y0 + y, lbin ) - Y0);
+
+        for( int x = 0; x < w; ++x ) {
+
+            int	i = x + w*y;
+
+            if( Valid( i ) ) {
+
+                int	ir = iy + FloorDiv( x0 + x, lbin ) - X0;
+
+                vr[ir] += v[i];
+                ++cr[ir];
+            }
+        }
+    }
+
+    x0 = X0;
+    y0 = Y0;
+    w  = W;
+    h  = H;
+
+    v.assign( N, 0.0f );
+    m.assign( N, 0 );
+
+    for( int i = 0; i < N; ++i ) {
+
+        if( cr[i] ) {
+            v[i] = vr[i] / cr[i];
+            m[i] = 1;
+        }
+    }
+}
+
+/* --------------------------------------------------------------- */
+/* Normalize ----------------------------------------------------- */
+/* --------------------------------------------------------------- */
+
+// Set valid pixels to mean 0, stdev 1; invalid stay 0.
+//
+// Return natural sd (0 = failure, image unchanged).
+//
+double DenseImg::Normalize()
+{
+    MeanStd	M;
+    double	avg, std;
+    int		n = w * h;
+
+    for( int i = 0; i < n; ++i ) {
+
+        if( Valid( i ) )
+            M.Element( v[i] );
+    }
+
+    M.Stats( avg, std );
+
+    if( !std )
+        return 0.0;
+
+    for( int i = 0; i < n; ++i ) {
+
+        if( Valid( i ) )
+            v[i] = (v[i] - avg) / std;
+    }
+
+    return std;
+}
+
+/* --------------------------------------------------------------- */
+/* Resample ------------------------------------------------------ */
+/* --------------------------------------------------------------- */
+
+// Set dst = this image mapped by T, over the bbox of the mapped
+// pixel grid. Each dst pixel is inverse mapped and bilinearly
+// interpolated from the valid neighbors, renormalizing by their
+// weight; it is valid if that weight is at least one half.
+//
+void DenseImg::Resample( DenseImg &dst, const TAffine &T ) const
+{
+    if( !w || !h ) {
+        dst.clear();
+        return;
+    }
+
+// Dst bbox
+
+    vector<Point>	cnr( 4 );
+    IBox			B;
+
+    cnr[0] = Point( x0,         y0 );
+    cnr[1] = Point( x0 + w - 1, y0 );
+    cnr[2] = Point( x0,         y0 + h - 1 );
+    cnr[3] = Point( x0 + w - 1, y0 + h - 1 );
+
+    T.Transform( cnr );
+
+    // snap roundoff (e.g. cos(90) != 0) before floor/ceil
+
+    for( int k = 0; k < 4; ++k ) {
+
+        double	rx = floor( cnr[k].x + 0.5 ),
+                ry = floor( cnr[k].y + 0.5 );
+
+        if( fabs( cnr[k].x - rx ) < 1e-6 )
+            cnr[k].x = rx;
+
+        if( fabs( cnr[k].y - ry ) < 1e-6 )
+            cnr[k].y = ry;
+    }
+
+    BBoxFromPoints( B, cnr );
+
+    dst.x0	= B.L;
+    dst.y0	= B.B;
+    dst.w	= B.R - B.L + 1;
+    dst.h	= B.T - B.B + 1;
+
+    int	N = dst.w * dst.h;
+
+    dst.v.assign( N, 0.0f );
+    dst.m.assign( N, 0 );
+
+// Walk dst rows in src-local coords
+
+    TAffine	Ti;
+
+    Ti.InverseOf( T );
+
+    for( int y = 0; y < dst.h; ++y ) {
+
+        Point	q( dst.x0, dst.y0 + y );
+
+        Ti.Transform( q );
+
+        double	sx = q.x - x0,
+                sy = q.y - y0;
+
+        for( int x = 0; x < dst.w;
+            ++x, sx += Ti.t[0], sy += Ti.t[3] ) {
+
+            if( sx <= -1.0 || sx >= w || sy <= -1.0 || sy >= h )
+                continue;
+
+            int		ix = (int)floor( sx ),
+                    iy = (int)floor( sy );
+            double	fx = sx - ix,
+                    fy = sy - iy,
+                    wt = 0.0,
+                    vs = 0.0;
+
+            for( int k = 0; k < 4; ++k ) {
+
+                int	jx = ix + (k & 1),
+                    jy = iy + (k >> 1);
+
+                if( jx < 0 || jx >= w || jy < 0 || jy >= h )
+                    continue;
+
+                int	j = jx + w*jy;
+
+                if( !Valid( j ) )
+                    continue;
+
+                double	c = ((k & 1) ? fx : 1.0 - fx) *
+                            ((k >> 1) ? fy : 1.0 - fy);
+
+                wt += c;
+                vs += c * v[j];
+            }
+
+            if( wt >= 0.5 ) {
+
+                int	i = x + dst.w*y;
+
+                dst.v[i] = vs / wt;
+                dst.m[i] = 1;
+            }
+        }
+    }
+}
+
+/* --------------------------------------------------------------- */
+/* Pad ----------------------------------------------------------- */
+/* --------------------------------------------------------------- */
+
+// Copy local window {xw,yw,ww,hw} into the low corner of
+// zeroed Nx x Ny raster I (for FFT correlation).
+//
+void DenseImg::Pad(
+    vector<double>	&I,
+    int				Nx,
+    int				Ny,
+    int				xw,
+    int				yw,
+    int				ww,
+    int				hw ) const
+{
+    I.assign( Nx * Ny, 0.0 );
+
+    for( int y = 0; y < hw; ++y ) {
+
+        const float	*s = &v[xw + w*(yw + y)];
+        double		*d = &I[Nx*y];
+
+        for( int x = 0; x < ww; ++x )
+            d[x] = s[x];
+    }
+}
+
+
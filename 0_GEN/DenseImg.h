@@ -0,0 +1,67 @@
+
+
+#pragma once
+
+
+#include	"GenDefs.h"
+#include	"CPoint.h"
+#include	"TAffine.h"
+
+#include	<vector>
+using namespace std;
+
+
+/* --------------------------------------------------------------- */
+/* class DenseImg ------------------------------------------------ */
+/* --------------------------------------------------------------- */
+
+// Raster image with integer origin: local pixel (x,y) lies at
+// coords (x0+x, y0+y). Invalid pixels have v = 0 and m = 0.
+//
+// Replaces {vector<Point>, vector<double>} point-list images
+// in the matching pipeline: 5 rather than 24 bytes per pixel,
+// and correlators copy rows instead of scattering points.
+//
+class DenseImg {
+
+public:
+    int				x0, y0,	// origin
+                    w, h;	// dims; row stride = w
+    vector<float>	v;		// values; 0 if invalid
+    vector<uint8>	m;		// validity; empty = all valid
+
+public:
+    DenseImg() : x0(0), y0(0), w(0), h(0) {};
+
+    void clear()
+        {x0 = y0 = w = h = 0; v.clear(); m.clear();};
+
+    inline bool Valid( int i ) const
+        {return !m.size() || m[i];};
+
+    int NValid() const;
+
+    void FromPoints(
+        const vector<Point>		&p,
+        const vector<double>	&val );
+
+    void Decimate( int lbin );
+
+    double Normalize();
+
+    void Resample( DenseImg &dst, const TAffine &T ) const;
+
+    void Pad(
+        vector<double>	&I,
+        int				Nx,
+        int				Ny,
+        int				xw,
+        int				yw,
+        int				ww,
+        int				hw ) const;
+
+    inline void Pad( vector<double> &I, int Nx, int Ny ) const
+        {Pad( I, Nx, Ny, 0, 0, w, h );};
+};
+
+
@@ -96,4 +96,284 @@ bool EZThreads(
     return true;
 }
 
+/* --------------------------------------------------------------- */
+/* EZBandCount --------------------------------------------------- */
+/* --------------------------------------------------------------- */
+
+// Return band (thread) count for a job of npts work units: one
+// band per thrpts units, at least 1, at most maxthr (caller's cap)
+// and at most nmax (e.g. rows available to split).
+//
+int EZBandCount( long npts, long thrpts, int maxthr, int nmax )
+{
+    long	nb = npts / thrpts;
+
+    if( nb > maxthr )
+        nb = maxthr;
+
+    if( nb > nmax )
+        nb = nmax;
+
+    return (nb > 1 ? nb : 1);
+}
+
+/* --------------------------------------------------------------- */
+/* EZRunBands ---------------------------------------------------- */
+/* --------------------------------------------------------------- */
+
+// Run proc once per band on nb threads and await completion. Band
+// i is at (char*)bands + i*bandsize and is passed to proc as its
+// argument. Band 0 runs on the calling thread; a band whose thread
+// can't be created also runs there, so all bands always run.
+//
+// Threads are made per call (rather than EZThreads with statics)
+// so that concurrent callers, e.g. Scape painters, don't collide.
+//
+void EZRunBands(
+    EZThreadproc	proc,
+    void			*bands,
+    int				nb,
+    size_t			bandsize )
+{
+    char				*b = (char*)bands;
+    vector<pthread_t>	vt( nb );
+    vector<char>		vok( nb, false );
+
+    for( int i = 1; i < nb; ++i )
+        vok[i] = !pthread_create( &vt[i], NULL, proc, b + i*bandsize );
+
+    proc( b );
+
+    for( int i = 1; i < nb; ++i ) {
+
+        if( vok[i] )
+            pthread_join( vt[i], NULL );
+        else
+            proc( b + i*bandsize );
+    }
+}
+
+/* --------------------------------------------------------------- */
+/* EZThreadPool -------------------------------------------------- */
+/* --------------------------------------------------------------- */
+
+class PoolArg {
+public:
+    EZThreadPool	*pool;
+    long			ithr;
+};
+
+
+EZThreadPool::EZThreadPool()
+    : vthr(NULL), proc(NULL), nthr(1), nrun(0),
+      npending(0), gen(0), quit(false)
+{
+    pthread_mutex_init( &mutex, NULL );
+    pthread_cond_init( &cgo, NULL );
+    pthread_cond_init( &cdone, NULL );
+}
+
+
+EZThreadPool::~EZThreadPool()
+{
+    Stop();
+
+    pthread_cond_destroy( &cdone );
+    pthread_cond_destroy( &cgo );
+    pthread_mutex_destroy( &mutex );
+}
+
+/* --------------------------------------------------------------- */
+/* EZThreadPool::_Worker ----------------------------------------- */
+/* --------------------------------------------------------------- */
+
+void* EZThreadPool::_Worker( void* arg )
+{
+    EZThreadPool	*P		= ((PoolArg*)arg)->pool;
+    long			ithr	= ((PoolArg*)arg)->ithr;
+    int				mygen	= 0;
+
+    delete (PoolArg*)arg;
+
+    for(;;) {
+
+        // Await next job
+
+        pthread_mutex_lock( &P->mutex );
+
+        while( P->gen == mygen && !P->quit )
+            pthread_cond_wait( &P->cgo, &P->mutex );
+
+        if( P->quit ) {
+            pthread_mutex_unlock( &P->mutex );
+            break;
+        }
+
+        mygen = P->gen;
+
+        EZThreadproc	proc = P->proc;
+        bool			iact = ithr < P->nrun;
+
+        pthread_mutex_unlock( &P->mutex );
+
+        // Do it
+
+        if( !iact )
+            continue;
+
+        proc( reinterpret_cast<void*>(ithr) );
+
+        // Report done
+
+        pthread_mutex_lock( &P->mutex );
+
+        if( !--P->npending )
+            pthread_cond_signal( &P->cdone );
+
+        pthread_mutex_unlock( &P->mutex );
+    }
+
+    return NULL;
+}
+
+/* --------------------------------------------------------------- */
+/* EZThreadPool::Start ------------------------------------------- */
+/* --------------------------------------------------------------- */
+
+// Launch coworkers [1..nthr) that idle until Run() is called.
+// Parameters as for EZThreads().
+//
+// Return true if launches successful.
+//
+bool EZThreadPool::Start(
+    int			nthr,
+    int			stksize_factor,
+    const char	*msgname,
+    FILE		*flog )
+{
+    Stop();
+
+    this->nthr	= 1;
+    quit		= false;
+    gen			= 0;
+
+    if( nthr <= 1 )
+        return true;
+
+    vthr = new pthread_t[nthr];
+
+    pthread_attr_t	attr;
+    pthread_attr_init( &attr );
+
+    pthread_attr_setdetachstate( &attr,
+        PTHREAD_CREATE_JOINABLE );
+
+    if( stksize_factor > 0 ) {
+
+        pthread_attr_setstacksize( &attr,
+            stksize_factor * PTHREAD_STACK_MIN );
+    }
+
+    int	err = 0;
+
+    for( int i = 1; i < nthr; ++i ) {
+
+        PoolArg	*A = new PoolArg;
+
+        A->pool = this;
+        A->ithr = i;
+
+        err = pthread_create( &vthr[i], &attr, _Worker, A );
+
+        if( err ) {
+
+            fprintf( flog,
+            "Error [%d] starting '%s' pool thread, index [%d].\n",
+            err, msgname, i );
+
+            delete A;
+            break;
+        }
+
+        this->nthr = i + 1;
+    }
+
+    pthread_attr_destroy( &attr );
+
+    if( err ) {
+        Stop();
+        return false;
+    }
+
+    return true;
+}
+
+/* --------------------------------------------------------------- */
+/* EZThreadPool::Stop -------------------------------------------- */
+/* --------------------------------------------------------------- */
+
+// Release and join all coworkers.
+//
+void EZThreadPool::Stop()
+{
+    if( !vthr )
+        return;
+
+    pthread_mutex_lock( &mutex );
+    quit = true;
+    pthread_cond_broadcast( &cgo );
+    pthread_mutex_unlock( &mutex );
+
+    for( int i = 1; i < nthr; ++i )
+        pthread_join( vthr[i], NULL );
+
+    delete [] vthr;
+    vthr = NULL;
+    nthr = 1;
+}
+
+/* --------------------------------------------------------------- */
+/* EZThreadPool::Run --------------------------------------------- */
+/* --------------------------------------------------------------- */
+
+// Run proc on pool workers [0..nthr) and await completion.
+// Worker 0 is the calling thread.
+//
+// Return false if nthr exceeds pool size (nothing is run).
+//
+bool EZThreadPool::Run( EZThreadproc proc, int nthr )
+{
+    if( nthr > this->nthr )
+        return false;
+
+    if( nthr > 1 ) {
+
+        pthread_mutex_lock( &mutex );
+        this->proc	= proc;
+        nrun		= nthr;
+        npending	= nthr - 1;
+        ++gen;
+        pthread_cond_broadcast( &cgo );
+        pthread_mutex_unlock( &mutex );
+    }
+
+// Run worker 0 locally
+
+    proc( 0 );
+
+// Wait for coworkers
+
+    if( nthr > 1 ) {
+
+        pthread_mutex_lock( &mutex );
+
+        while( npending )
+            pthread_cond_wait( &cdone, &mutex );
+
+        pthread_mutex_unlock( &mutex );
+    }
+
+    return true;
+}
+
 
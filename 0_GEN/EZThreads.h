@@ -16,6 +16,42 @@
 //
 typedef	void* (*EZThreadproc)( void* ithr );
 
+// Persistent pool of worker threads for repeated short jobs,
+// e.g. solver passes, where thread create/join per call would
+// dominate. Run() hands proc to workers [0..nthr); the caller
+// serves as worker 0.
+//
+class EZThreadPool {
+private:
+    pthread_mutex_t		mutex;
+    pthread_cond_t		cgo,		// wakes workers for job
+                        cdone;		// wakes caller when done
+    pthread_t			*vthr;
+    EZThreadproc		proc;
+    int					nthr,		// pool size
+                        nrun,		// active workers this job
+                        npending,	// active workers not done
+                        gen;		// job generation counter
+    bool				quit;
+private:
+    static void* _Worker( void* arg );
+public:
+    EZThreadPool();
+    virtual ~EZThreadPool();
+
+    bool Start(
+        int			nthr,
+        int			stksize_factor,
+        const char	*msgname,
+        FILE		*flog = stdout );
+
+    void Stop();
+
+    bool Run( EZThreadproc proc, int nthr );
+
+    int Size() const	{return nthr;};
+};
+
 /* --------------------------------------------------------------- */
 /* Functions ----------------------------------------------------- */
 /* --------------------------------------------------------------- */
@@ -27,4 +63,12 @@ bool EZThreads(
     const char		*msgname,
     FILE			*flog = stdout );
 
+int EZBandCount( long npts, long thrpts, int maxthr, int nmax );
+
+void EZRunBands(
+    EZThreadproc	proc,
+    void			*bands,
+    int				nb,
+    size_t			bandsize );
+
 
@@ -1,22 +1,138 @@
-
-
 #include	"Disk.h"
 #include	"FoldMask.h"
 #include	"ImageIO.h"
 
+#include	<stdarg.h>
 #include	<stdlib.h>
 #include	<string.h>
+#include	<unistd.h>
+#include	<sys/stat.h>
+
+#include	<algorithm>
+#include	<list>
 
 
+/* --------------------------------------------------------------- */
+/* Constants ----------------------------------------------------- */
+/* --------------------------------------------------------------- */
+
+// Fold mask cache
+// ---------------
+// GetFoldMask results (post-resin, post-crop) are kept run-length
+// encoded, keyed on tile and every masking parameter, including a
+// hash of the resin mask. Each entry also keeps the ConnRegion
+// lists made from its mask per {scale, minpts}, with the points of
+// each region stored as horizontal runs in their original order.
+// Hits replay the original log text, so logs are unchanged.
+//
+// ConnRgnsFromFoldMask finds an entry by the raster pointer last
+// handed out for it, and uses it only if the raster still matches
+// the runs exactly.
+//
+// In-memory caching is enabled by SetFoldMaskCache (batch runs).
+// Independently, if env FoldMaskCacheDisk is nonzero, masks read
+// from IDB fm files are also saved beside them as fm.xxx.<key
+// hash>.fmc, and reused by later processes. The disk key also
+// has the fm file's mtime and size, so edited masks are remade.
+//
+// Bump kFMCVersion if the .fmc layout changes.
 
+const char	kFMCMagic[8]	= "FMCACHE";
+const int	kFMCVersion		= 1;
 
+/* --------------------------------------------------------------- */
+/* Types --------------------------------------------------------- */
+/* --------------------------------------------------------------- */
 
+class PtRun {
+public:
+    int	x, y, n;
+};
+
+class RgnRuns {
+public:
+    IBox			B;
+    int				id;
+    uint32			npts;
+    vector<PtRun>	run;
+};
+
+class RgnSet {
+public:
+    int				scale;
+    uint32			minpts;
+    string			log;
+    vector<RgnRuns>	rgn;
+};
+
+class FMEntry {
+public:
+    string			key,
+                    log;	// GetFoldMask output
+    vector<uint32>	rn;		// run lengths
+    vector<uint8>	rv;		// run values
+    vector<RgnSet>	vs;
+    const uint8		*ras;	// raster last handed out
+public:
+    FMEntry() : ras(NULL) {};
+};
+
+/* --------------------------------------------------------------- */
+/* Statics ------------------------------------------------------- */
+/* --------------------------------------------------------------- */
+
+static list<FMEntry>	fmcache;			// most recently used first
+static long				fmcachemax	= 0;	// bytes; zero disables caching
+static int				fmdisk		= -1;	// unset if -1
+
+
+
+
+
+
+/* --------------------------------------------------------------- */
+/* HashBytes ----------------------------------------------------- */
+/* --------------------------------------------------------------- */
+
+// FNV-1a, 64 bit.
+//
+static unsigned long long HashBytes( const uint8 *p, int n )
+{
+    unsigned long long	h = 14695981039346656037ULL;
+
+    for( int i = 0; i < n; ++i ) {
+        h ^= p[i];
+        h *= 1099511628211ULL;
+    }
+
+    return h;
+}
+
+/* --------------------------------------------------------------- */
+/* Logf ---------------------------------------------------------- */
+/* --------------------------------------------------------------- */
+
+// Print to flog and append to log.
+//
+static void Logf( string &log, FILE *flog, const char *fmt, ... )
+{
+    char	buf[2048];
+    va_list	ap;
+
+    va_start( ap, fmt );
+    vsnprintf( buf, sizeof(buf), fmt, ap );
+    va_end( ap );
+
+    fputs( buf, flog );
+    log += buf;
+}
 
 /* --------------------------------------------------------------- */
 /* PrintFoldmapHisto --------------------------------------------- */
 /* --------------------------------------------------------------- */
 
 static void PrintFoldmapHisto(
+    string			&log,
     const uint8*	fm,
     int				w,
     int				h,
@@ -31,27 +147,217 @@ static void PrintFoldmapHisto(
     for( i = 0; i < 256; ++i ) {
 
         if( cts[i] ) {
-            fprintf( flog,
+            Logf( log, flog,
             "Foldmask: value=%3d, count=%8d\n", i, cts[i] );
         }
     }
 }
 
 /* --------------------------------------------------------------- */
-/* GetFoldMask --------------------------------------------------- */
+/* RLEEncode ----------------------------------------------------- */
 /* --------------------------------------------------------------- */
 
-// Load or create a foldmask (always full size).
+static void RLEEncode( FMEntry &E, const uint8 *m, int n )
+{
+    E.rn.clear();
+    E.rv.clear();
+
+    for( int i = 0; i < n; ) {
+
+        int	j = i + 1;
+
+        while( j < n && m[j] == m[i] )
+            ++j;
+
+        E.rn.push_back( j - i );
+        E.rv.push_back( m[i] );
+        i = j;
+    }
+}
+
+/* --------------------------------------------------------------- */
+/* RLEDecode ----------------------------------------------------- */
+/* --------------------------------------------------------------- */
+
+static uint8* RLEDecode( const FMEntry &E, int n )
+{
+    uint8	*m = (uint8*)RasterAlloc( n ),
+            *d = m;
+    int		nr = E.rn.size();
+
+    for( int i = 0; i < nr; ++i ) {
+        memset( d, E.rv[i], E.rn[i] );
+        d += E.rn[i];
+    }
+
+    return m;
+}
+
+/* --------------------------------------------------------------- */
+/* RLEMatches ---------------------------------------------------- */
+/* --------------------------------------------------------------- */
+
+static bool RLEMatches( const FMEntry &E, const uint8 *m, int n )
+{
+    int	nr = E.rn.size(), k = 0;
+
+    for( int i = 0; i < nr; ++i ) {
+
+        int		len	= E.rn[i];
+        uint8	v	= E.rv[i],
+                dif	= 0;
+
+        if( k + len > n )
+            return false;
+
+        for( int j = 0; j < len; ++j )
+            dif |= m[k + j] ^ v;
+
+        if( dif )
+            return false;
+
+        k += len;
+    }
+
+    return k == n;
+}
+
+/* --------------------------------------------------------------- */
+/* DiskRead ------------------------------------------------------ */
+/* --------------------------------------------------------------- */
+
+// Layout: magic, version, key len, key, log len, log,
+// nruns, lengths, values.
 //
-uint8* GetFoldMask(
+// Entries whose runs don't cover exactly np pixels are rejected,
+// so a truncated or foreign file can't overrun RLEDecode.
+//
+static bool DiskRead(
+    FMEntry			&E,
+    const char		*name,
+    const string	&key,
+    int				np )
+{
+    FILE	*f = fopen( name, "rb" );
+
+    if( !f )
+        return false;
+
+    char	magic[8];
+    int		ver, len, nr;
+    bool	ok = false;
+
+    if( 1 != fread( magic, 8, 1, f ) ||
+        memcmp( magic, kFMCMagic, 8 ) ||
+        1 != fread( &ver, sizeof(int), 1, f ) ||
+        ver != kFMCVersion ||
+        1 != fread( &len, sizeof(int), 1, f ) ||
+        len != key.size() ) {
+
+        goto exit;
+    }
+
+    E.key.resize( len );
+
+    if( len && 1 != fread( &E.key[0], len, 1, f ) )
+        goto exit;
+
+    if( E.key != key )
+        goto exit;
+
+    if( 1 != fread( &len, sizeof(int), 1, f ) || len < 0 )
+        goto exit;
+
+    E.log.resize( len );
+
+    if( len && 1 != fread( &E.log[0], len, 1, f ) )
+        goto exit;
+
+    if( 1 != fread( &nr, sizeof(int), 1, f ) || nr < 0 )
+        goto exit;
+
+    E.rn.resize( nr );
+    E.rv.resize( nr );
+
+    ok = !nr ||
+        (nr == fread( &E.rn[0], sizeof(uint32), nr, f ) &&
+         nr == fread( &E.rv[0], sizeof(uint8), nr, f ));
+
+    if( ok ) {
+
+        long long	sum = 0;
+
+        for( int i = 0; i < nr; ++i )
+            sum += E.rn[i];
+
+        ok = (sum == np);
+    }
+
+exit:
+    fclose( f );
+
+    return ok;
+}
+
+/* --------------------------------------------------------------- */
+/* DiskWrite ----------------------------------------------------- */
+/* --------------------------------------------------------------- */
+
+// Write under temp name, then publish atomically, in case other
+// processes are caching the same mask. Failure (e.g. read-only
+// IDB) just leaves no cache file.
+//
+static void DiskWrite( const FMEntry &E, const char *name )
+{
+    char	tmp[2048];
+
+    sprintf( tmp, "%s.tmp%d", name, (int)getpid() );
+
+    FILE	*f = fopen( tmp, "wb" );
+
+    if( !f )
+        return;
+
+    int		ver = kFMCVersion,
+            nk	= E.key.size(),
+            nl	= E.log.size(),
+            nr	= E.rn.size();
+    bool	ok;
+
+    ok = 1 == fwrite( kFMCMagic, 8, 1, f )
+        && 1 == fwrite( &ver, sizeof(int), 1, f )
+        && 1 == fwrite( &nk, sizeof(int), 1, f )
+        && (!nk || 1 == fwrite( E.key.c_str(), nk, 1, f ))
+        && 1 == fwrite( &nl, sizeof(int), 1, f )
+        && (!nl || 1 == fwrite( E.log.c_str(), nl, 1, f ))
+        && 1 == fwrite( &nr, sizeof(int), 1, f )
+        && (!nr || (nr == fwrite( &E.rn[0], sizeof(uint32), nr, f )
+                 && nr == fwrite( &E.rv[0], sizeof(uint8), nr, f )));
+
+    ok = !fclose( f ) && ok;
+
+    if( ok )
+        rename( tmp, name );
+    else
+        remove( tmp );
+}
+
+/* --------------------------------------------------------------- */
+/* MakeFoldMask -------------------------------------------------- */
+/* --------------------------------------------------------------- */
+
+// Load or create a foldmask (always full size), logging to flog
+// and to log. Path fmpath is NULL if nofile.
+//
+static uint8* MakeFoldMask(
+    string				&log,
     const string		&idb,
     const PicSpec		&P,
-    const char			*forcepath,
+    const char			*fmpath,
     const vector<uint8>	&resmsk,
     CCropMask			*CM,
     int					wf,
     int					hf,
-    bool				nofile,
     bool				transpose,
     bool				force1rgn,
     FILE				*flog )
@@ -59,22 +365,15 @@ uint8* GetFoldMask(
     uint8*	mask;
     int		np = wf * hf;
 
-    if( nofile ) {
+    if( !fmpath ) {
         mask = (uint8*)RasterAlloc( np );
         memset( mask, 1, np );
     }
     else {
 
-        Til2FM	t2f;
-
-        if( !forcepath ) {
-            IDBTil2FM( t2f, idb, P.z, P.id, flog );
-            forcepath = t2f.path.c_str();
-        }
-
         uint32	_w, _h;
 
-        mask = Raster8FromAny( forcepath, _w, _h, flog, transpose );
+        mask = Raster8FromAny( fmpath, _w, _h, flog, transpose );
 
         if( _w != wf || _h != hf ) {
 
@@ -83,7 +382,7 @@ uint8* GetFoldMask(
             exit( 42 );
         }
 
-        PrintFoldmapHisto( mask, wf, hf, flog );
+        PrintFoldmapHisto( log, mask, wf, hf, flog );
 
         // force one (non-fold) region
 
@@ -115,19 +414,26 @@ uint8* GetFoldMask(
         IBox	B;
         CM->GetBox( B, P.t2i.cam );
 
-        for( int i = 0; i < np; ++i ) {
+        // clip box to image; zero outside rows and row ends
 
-            int	y = i / wf,
-                x = i - wf * y;
+        int	L = max( 0, min( wf, B.L ) ),
+            R = max( L, min( wf, B.R ) ),
+            b = max( 0, min( hf, B.B ) ),
+            T = max( b, min( hf, B.T ) );
 
-            if( y < B.B || y >= B.T ||
-                x < B.L || x >= B.R ) {
+        for( int y = 0; y < hf; ++y ) {
 
-                mask[i] = 0;
+            uint8	*row = mask + wf*y;
+
+            if( y < b || y >= T )
+                memset( row, 0, wf );
+            else {
+                memset( row, 0, L );
+                memset( row + R, 0, wf - R );
             }
         }
 
-        fprintf( flog,
+        Logf( log, flog,
         "Crop z %d id %d cam %d to x[%d %d) y[%d %d)\n",
         P.z, P.id, P.t2i.cam, B.L, B.R, B.B, B.T );
     }
@@ -135,6 +441,248 @@ uint8* GetFoldMask(
     return mask;
 }
 
+/* --------------------------------------------------------------- */
+/* FMBytes ------------------------------------------------------- */
+/* --------------------------------------------------------------- */
+
+// Approximate heap bytes held by cache entry E.
+//
+static long FMBytes( const FMEntry &E )
+{
+    long	sum = E.key.size() + E.log.size()
+                + E.rn.size() * sizeof(uint32)
+                + E.rv.size();
+
+    for( int is = 0, ns = E.vs.size(); is < ns; ++is ) {
+
+        const RgnSet	&S = E.vs[is];
+
+        sum += S.log.size();
+
+        for( int ir = 0, nr = S.rgn.size(); ir < nr; ++ir )
+            sum += S.rgn[ir].run.size() * sizeof(PtRun);
+    }
+
+    return sum;
+}
+
+/* --------------------------------------------------------------- */
+/* TrimFMCache --------------------------------------------------- */
+/* --------------------------------------------------------------- */
+
+// Drop least recently used masks beyond fmcachemax bytes. The most
+// recent mask is always kept.
+//
+static void TrimFMCache()
+{
+    list<FMEntry>::iterator	it = fmcache.begin();
+    long					sum = 0;
+
+    for( ; it != fmcache.end(); ++it ) {
+
+        sum += FMBytes( *it );
+
+        if( sum > fmcachemax && it != fmcache.begin() )
+            break;
+    }
+
+    fmcache.erase( it, fmcache.end() );
+}
+
+/* --------------------------------------------------------------- */
+/* SetFoldMaskCache ---------------------------------------------- */
+/* --------------------------------------------------------------- */
+
+// Set max megabytes of fold masks (and their region lists) retained
+// across successive GetFoldMask calls, so batch drivers build each
+// tile's mask once. Zero (default) disables caching.
+//
+// Masks are kept run-length coded, so are far smaller than the
+// tiles PixPair caches.
+//
+// Note: Not thread-safe; as for PixPair::SetCache.
+//
+void SetFoldMaskCache( int maxMB )
+{
+    fmcachemax = (maxMB > 0 ? (long)maxMB << 20 : 0);
+
+    if( fmcachemax )
+        TrimFMCache();
+    else
+        fmcache.clear();
+}
+
+/* --------------------------------------------------------------- */
+/* GetFoldMask --------------------------------------------------- */
+/* --------------------------------------------------------------- */
+
+// Load or create a foldmask (always full size).
+//
+// Caller releases the result with RasterFree.
+//
+uint8* GetFoldMask(
+    const string		&idb,
+    const PicSpec		&P,
+    const char			*forcepath,
+    const vector<uint8>	&resmsk,
+    CCropMask			*CM,
+    int					wf,
+    int					hf,
+    bool				nofile,
+    bool				transpose,
+    bool				force1rgn,
+    FILE				*flog )
+{
+    int	np = wf * hf;
+
+    if( fmdisk < 0 ) {
+        const char	*s = getenv( "FoldMaskCacheDisk" );
+        fmdisk = (s && atoi( s ) > 0);
+    }
+
+// Uncached
+
+    Til2FM	t2f;
+
+    if( !fmcachemax && !(fmdisk && !nofile) ) {
+
+        string	log;
+
+        if( !nofile && !forcepath ) {
+            IDBTil2FM( t2f, idb, P.z, P.id, flog );
+            forcepath = t2f.path.c_str();
+        }
+
+        return MakeFoldMask( log, idb, P, (nofile ? NULL : forcepath),
+                resmsk, CM, wf, hf, transpose, force1rgn, flog );
+    }
+
+// Key on everything affecting the result
+
+    IBox	B;
+    char	key[4096];
+    bool	crop = CM && CM->IsFile( idb );
+
+    if( crop )
+        CM->GetBox( B, P.t2i.cam );
+
+    sprintf( key, "%s|%s|%d|%s|%d%d%d|%d|%d|%016llx|%d:%d,%d,%d,%d",
+    idb.c_str(), P.t2i.path.c_str(), P.t2i.cam,
+    (forcepath ? forcepath : ""), nofile, transpose, force1rgn,
+    wf, hf,
+    (resmsk.size() == np ? HashBytes( &resmsk[0], np ) : 0ULL),
+    crop, (crop ? B.L : 0), (crop ? B.R : 0),
+    (crop ? B.B : 0), (crop ? B.T : 0) );
+
+// Lookup
+
+    list<FMEntry>::iterator	it;
+
+    for( it = fmcache.begin(); it != fmcache.end(); ++it ) {
+
+        if( it->key == key )
+            break;
+    }
+
+    if( it != fmcache.end() ) {
+
+        fprintf( flog, "GetFoldMask: Cache hit [%s].\n",
+            P.t2i.path.c_str() );
+
+        fmcache.splice( fmcache.begin(), fmcache, it );
+
+        FMEntry	&F = fmcache.front();
+
+        uint8	*mask = RLEDecode( F, np );
+
+        fputs( F.log.c_str(), flog );
+
+        F.ras = mask;
+
+        return mask;
+    }
+
+// Miss: try disk, else make it
+
+    FMEntry	E;
+    uint8	*mask = NULL;
+    char	name[2048];
+    bool	ondisk = false;
+
+    name[0] = 0;
+
+    if( !nofile ) {
+
+        if( !forcepath ) {
+            IDBTil2FM( t2f, idb, P.z, P.id, flog );
+            forcepath = t2f.path.c_str();
+        }
+
+        if( fmdisk ) {
+
+            // disk key adds fm file identity, so an edited or
+            // replaced fm invalidates its cache file
+
+            struct stat	st;
+            char		dkey[4096+64];
+
+            if( stat( forcepath, &st ) ) {
+                st.st_mtime	= 0;
+                st.st_size	= -1;
+            }
+
+            sprintf( dkey, "%s|%ld|%lld",
+            key, (long)st.st_mtime, (long long)st.st_size );
+
+            sprintf( name, "%s.%016llx.fmc", forcepath,
+                HashBytes( (uint8*)dkey, strlen( dkey ) ) );
+
+            if( !(ondisk = DiskRead( E, name, dkey, np )) )
+                E.key = dkey;	// for DiskWrite
+        }
+    }
+
+    if( ondisk ) {
+
+        fprintf( flog, "GetFoldMask: Disk cache hit [%s].\n", name );
+        fputs( E.log.c_str(), flog );
+
+        mask = RLEDecode( E, np );
+    }
+    else {
+
+        mask	= MakeFoldMask( E.log, idb, P,
+                    (nofile ? NULL : forcepath),
+                    resmsk, CM, wf, hf, transpose, force1rgn, flog );
+
+        RLEEncode( E, mask, np );
+
+        if( name[0] )
+            DiskWrite( E, name );
+    }
+
+    E.key = key;
+
+// Retain
+
+    if( fmcachemax ) {
+
+        fmcache.push_front( FMEntry() );
+
+        FMEntry	&F = fmcache.front();
+
+        F.key.swap( E.key );
+        F.log.swap( E.log );
+        F.rn.swap( E.rn );
+        F.rv.swap( E.rv );
+        F.ras = mask;
+
+        TrimFMCache();
+    }
+
+    return mask;
+}
+
 /* --------------------------------------------------------------- */
 /* SetWithinSectionBorders --------------------------------------- */
 /* --------------------------------------------------------------- */
@@ -323,17 +871,14 @@ void SetBoundsAndColors(
 }
 
 /* --------------------------------------------------------------- */
-/* ConnRgnsFromFoldMask ------------------------------------------ */
+/* MakeConnRgns -------------------------------------------------- */
 /* --------------------------------------------------------------- */
 
-// Scan given foldMask having pixels {0=fold, 1=rgn1, ...} and
-// make an entry for each connected region in (cr). For each cr
-// we fill in fields: {pts, B, id}.
-//
-// We will not create entries for the fold or for any region
-// whose point count is below (minpts).
+// Make region list as described for ConnRgnsFromFoldMask,
+// logging to flog and to log.
 //
-void ConnRgnsFromFoldMask(
+static void MakeConnRgns(
+    string				&log,
     vector<ConnRegion>	&cr,
     const uint8*		foldMask,
     int					wf,
@@ -377,19 +922,19 @@ void ConnRgnsFromFoldMask(
         }
     }
 
-    fprintf( flog,
+    Logf( log, flog,
     "ConnRegion: FoldMask w=%d, h=%d, area=%d, scale=%d\n",
     wf, hf, N, scale );
 
-    fprintf( flog,
+    Logf( log, flog,
     "ConnRegion: Included rgns=%3d, area=%8d, %%=%6.2f\n",
     n_inc, t_inc, 100.0*t_inc / N );
 
-    fprintf( flog,
+    Logf( log, flog,
     "ConnRegion: Excluded rgns=%3d, area=%8d, %%=%6.2f\n",
     max_id - n_inc, t_exc, 100.0*t_exc / N );
 
-    fprintf( flog,
+    Logf( log, flog,
     "ConnRegion:    Folds rgns=%3d, area=%8d, %%=%6.2f\n",
     (szrgn[0] != 0), szrgn[0], 100.0*szrgn[0] / N );
 
@@ -463,6 +1008,158 @@ void ConnRgnsFromFoldMask(
     }
 }
 
+/* --------------------------------------------------------------- */
+/* RgnEncode ----------------------------------------------------- */
+/* --------------------------------------------------------------- */
+
+// Store regions with their points as horizontal runs, in order.
+//
+static void RgnEncode( RgnSet &S, const vector<ConnRegion> &cr )
+{
+    int	nr = cr.size();
+
+    S.rgn.resize( nr );
+
+    for( int ir = 0; ir < nr; ++ir ) {
+
+        const ConnRegion&	C = cr[ir];
+        RgnRuns&			R = S.rgn[ir];
+        int					np = C.pts.size();
+
+        R.B		= C.B;
+        R.id	= C.id;
+        R.npts	= np;
+
+        for( int ip = 0; ip < np; ) {
+
+            PtRun	r;
+
+            r.x	= (int)C.pts[ip].x;
+            r.y	= (int)C.pts[ip].y;
+            r.n	= 1;
+
+            while( ++ip < np &&
+                    C.pts[ip].y == r.y &&
+                    C.pts[ip].x == r.x + r.n ) {
+
+                ++r.n;
+            }
+
+            R.run.push_back( r );
+        }
+    }
+}
+
+/* --------------------------------------------------------------- */
+/* RgnDecode ----------------------------------------------------- */
+/* --------------------------------------------------------------- */
+
+static void RgnDecode( vector<ConnRegion> &cr, const RgnSet &S )
+{
+    int	nr = S.rgn.size();
+
+    cr.clear();
+    cr.resize( nr );
+
+    for( int ir = 0; ir < nr; ++ir ) {
+
+        ConnRegion&		C = cr[ir];
+        const RgnRuns&	R = S.rgn[ir];
+        int				nu = R.run.size(),
+                        k  = 0;
+
+        C.B		= R.B;
+        C.id	= R.id;
+        C.pts.resize( R.npts );
+
+        for( int iu = 0; iu < nu; ++iu ) {
+
+            const PtRun	&r = R.run[iu];
+
+            for( int i = 0; i < r.n; ++i )
+                C.pts[k++] = Point( r.x + i, r.y );
+        }
+    }
+}
+
+/* --------------------------------------------------------------- */
+/* ConnRgnsFromFoldMask ------------------------------------------ */
+/* --------------------------------------------------------------- */
+
+// Scan given foldMask having pixels {0=fold, 1=rgn1, ...} and
+// make an entry for each connected region in (cr). For each cr
+// we fill in fields: {pts, B, id}.
+//
+// We will not create entries for the fold or for any region
+// whose point count is below (minpts).
+//
+// If foldMask came from the fold mask cache and is unmodified,
+// lists are made just once per {scale, minpts}.
+//
+void ConnRgnsFromFoldMask(
+    vector<ConnRegion>	&cr,
+    const uint8*		foldMask,
+    int					wf,
+    int					hf,
+    int					scale,
+    uint32				minpts,
+    FILE				*flog )
+{
+    FMEntry	*E = NULL;
+    int		N = wf * hf;
+
+    if( fmcachemax ) {
+
+        list<FMEntry>::iterator	it;
+
+        for( it = fmcache.begin(); it != fmcache.end(); ++it ) {
+
+            if( it->ras == foldMask && RLEMatches( *it, foldMask, N ) ) {
+                E = &*it;
+                break;
+            }
+        }
+    }
+
+// Uncached
+
+    if( !E ) {
+
+        string	log;
+
+        MakeConnRgns( log, cr, foldMask, wf, hf, scale, minpts, flog );
+        return;
+    }
+
+// Lookup
+
+    int	ns = E->vs.size();
+
+    for( int is = 0; is < ns; ++is ) {
+
+        const RgnSet	&S = E->vs[is];
+
+        if( S.scale == scale && S.minpts == minpts ) {
+
+            fputs( S.log.c_str(), flog );
+            RgnDecode( cr, S );
+            return;
+        }
+    }
+
+// Make and retain
+
+    E->vs.push_back( RgnSet() );
+
+    RgnSet	&S = E->vs.back();
+
+    S.scale		= scale;
+    S.minpts	= minpts;
+
+    MakeConnRgns( S.log, cr, foldMask, wf, hf, scale, minpts, flog );
+    RgnEncode( S, cr );
+}
+
 /* --------------------------------------------------------------- */
 /* ConnRgnForce1 ------------------------------------------------- */
 /* --------------------------------------------------------------- */
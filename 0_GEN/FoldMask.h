@@ -29,6 +29,8 @@ public:
 /* Functions ----------------------------------------------------- */
 /* --------------------------------------------------------------- */
 
+void SetFoldMaskCache( int maxMB );
+
 uint8* GetFoldMask(
     const string		&idb,
     const PicSpec		&P,
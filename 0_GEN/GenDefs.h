@@ -20,6 +20,7 @@ const double	PI		= 3.14159265358;
 /* --------------------------------------------------------------- */
 
 typedef complex<double> CD;
+typedef complex<float>  CF;
 
 typedef struct {
     int		L,
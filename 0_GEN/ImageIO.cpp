@@ -924,6 +924,79 @@ void VectorDblToTif8(
     Raster8ToTif8( name, &buf[0], w, h, flog );
 }
 
+/* --------------------------------------------------------------- */
+/* Tif8TileWriter ------------------------------------------------ */
+/* --------------------------------------------------------------- */
+
+// Images too big for classic TIFF's 4GB offsets are written as
+// BigTIFF ("w8"), which libtiff 4 readers handle transparently.
+//
+void Tif8TileWriter::Open(
+    const char*	name,
+    int			w,
+    int			h,
+    int			tile,
+    FILE*		flog )
+{
+    Close();
+
+    double	bytes	= (double)w * h;
+    TIFF	*image	= TIFFOpen( name, bytes > 0xF0000000 ? "w8" : "w" );
+
+    if( !image ) {
+        fprintf( flog,
+        "Tif(8) Could not open [%s] for writing.\n", name );
+        exit( 42 );
+    }
+
+    TIFFSetField( image, TIFFTAG_IMAGEWIDTH, w );
+    TIFFSetField( image, TIFFTAG_IMAGELENGTH, h );
+    TIFFSetField( image, TIFFTAG_BITSPERSAMPLE, 8 );
+    TIFFSetField( image, TIFFTAG_SAMPLESPERPIXEL, 1 );
+    TIFFSetField( image, TIFFTAG_TILEWIDTH, tile );
+    TIFFSetField( image, TIFFTAG_TILELENGTH, tile );
+
+#if USE_TIF_DEFLATE
+    TIFFSetField( image, TIFFTAG_COMPRESSION, COMPRESSION_DEFLATE );
+#else
+    TIFFSetField( image, TIFFTAG_COMPRESSION, COMPRESSION_NONE );
+#endif
+
+    TIFFSetField( image, TIFFTAG_PHOTOMETRIC, PHOTOMETRIC_MINISBLACK );
+    TIFFSetField( image, TIFFTAG_ORIENTATION, ORIENTATION_TOPLEFT );
+
+    tif			= image;
+    this->tile	= tile;
+}
+
+
+// Return false if libtiff fails to write the tile (disk full...).
+//
+bool Tif8TileWriter::Write( int tx, int ty, const uint8* raster )
+{
+    TIFF	*image = (TIFF*)tif;
+
+    return -1 != TIFFWriteEncodedTile( image,
+        TIFFComputeTile( image, tx * tile, ty * tile, 0, 0 ),
+        (void*)raster, tile * tile * sizeof(uint8) );
+}
+
+
+// Return false if the final directory flush fails.
+//
+bool Tif8TileWriter::Close()
+{
+    bool	ok = true;
+
+    if( tif ) {
+        ok = (1 == TIFFFlush( (TIFF*)tif ));
+        TIFFClose( (TIFF*)tif );
+        tif = NULL;
+    }
+
+    return ok;
+}
+
 /* --------------------------------------------------------------- */
 /* Raster8FromPng ------------------------------------------------ */
 /* --------------------------------------------------------------- */
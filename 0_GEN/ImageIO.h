@@ -106,6 +106,33 @@ void VectorDblToTif8(
     int						h,
     FILE*					flog = stdout );
 
+// Writes a tiled 8-bit TIFF one tile at a time, so the whole
+// image never needs to be in memory. Tiles are tile x tile, in
+// pixel units tile*tx, tile*ty; edge tiles are padded.
+//
+class Tif8TileWriter {
+
+private:
+    void	*tif;	// TIFF*
+    int		tile;
+
+public:
+    Tif8TileWriter() : tif(NULL), tile(0) {};
+
+    virtual ~Tif8TileWriter()	{Close();};
+
+    void Open(
+        const char*	name,
+        int			w,
+        int			h,
+        int			tile,
+        FILE*		flog = stdout );
+
+    bool Write( int tx, int ty, const uint8* raster );
+
+    bool Close();
+};
+
 /* --------------------------------------------------------------- */
 /* Png ----------------------------------------------------------- */
 /* --------------------------------------------------------------- */
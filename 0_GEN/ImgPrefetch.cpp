@@ -0,0 +1,277 @@
+
+
+#include	"ImgPrefetch.h"
+#include	"ImageIO.h"
+
+#include	<stdlib.h>
+
+
+/* --------------------------------------------------------------- */
+/* Statics ------------------------------------------------------- */
+/* --------------------------------------------------------------- */
+
+// Return env var name as positive int, else dflt.
+//
+static int EnvInt( const char *name, int dflt )
+{
+    const char	*p = getenv( name );
+    int			v;
+
+    if( p && (v = atoi( p )) > 0 )
+        return v;
+
+    return dflt;
+}
+
+
+
+
+
+
+/* --------------------------------------------------------------- */
+/* ImgPrefetch --------------------------------------------------- */
+/* --------------------------------------------------------------- */
+
+ImgPrefetch::ImgPrefetch()
+    : vthr(NULL), flog(stdout), bytes(0), maxbytes(0),
+      type(pfRas8), nthr(0), depth(0), inext(0), iget(0),
+      quit(false)
+{
+    pthread_mutex_init( &mutex, NULL );
+    pthread_cond_init( &cready, NULL );
+    pthread_cond_init( &croom, NULL );
+}
+
+
+ImgPrefetch::~ImgPrefetch()
+{
+    Stop();
+
+    pthread_cond_destroy( &croom );
+    pthread_cond_destroy( &cready );
+    pthread_mutex_destroy( &mutex );
+}
+
+/* --------------------------------------------------------------- */
+/* ImgPrefetch::CanClaim ----------------------------------------- */
+/* --------------------------------------------------------------- */
+
+// Caller holds mutex. The image the consumer is waiting for is
+// always claimable, so an oversize image can't stall the queue.
+//
+bool ImgPrefetch::CanClaim() const
+{
+    if( inext >= vpath.size() )
+        return false;
+
+    if( inext == iget )
+        return true;
+
+    return inext - iget < depth && bytes < maxbytes;
+}
+
+/* --------------------------------------------------------------- */
+/* ImgPrefetch::_Loader ------------------------------------------ */
+/* --------------------------------------------------------------- */
+
+void* ImgPrefetch::_Loader( void* arg )
+{
+    ImgPrefetch	*P = (ImgPrefetch*)arg;
+
+    pthread_mutex_lock( &P->mutex );
+
+    for(;;) {
+
+        while( !P->quit && !P->CanClaim() ) {
+
+            if( P->inext >= P->vpath.size() )
+                break;
+
+            pthread_cond_wait( &P->croom, &P->mutex );
+        }
+
+        if( P->quit || P->inext >= P->vpath.size() )
+            break;
+
+        int	i = P->inext++;
+
+        pthread_mutex_unlock( &P->mutex );
+
+        // Load outside lock
+
+        uint32	w = 0, h = 0;
+        void	*ras;
+        long	nb;
+
+        if( P->type == pfRas16 ) {
+            ras	= Raster16FromTif16( P->vpath[i].c_str(), w, h, P->flog );
+            nb	= 2L * w * h;
+        }
+        else {
+            ras	= Raster8FromAny( P->vpath[i].c_str(), w, h, P->flog );
+            nb	= (long)w * h;
+        }
+
+        pthread_mutex_lock( &P->mutex );
+
+        CSlot	&S = P->vslot[i];
+
+        S.ras	= ras;
+        S.w		= w;
+        S.h		= h;
+        S.ready	= true;
+
+        if( ras )
+            P->bytes += nb;
+
+        pthread_cond_broadcast( &P->cready );
+    }
+
+    pthread_mutex_unlock( &P->mutex );
+
+    return NULL;
+}
+
+/* --------------------------------------------------------------- */
+/* ImgPrefetch::Start -------------------------------------------- */
+/* --------------------------------------------------------------- */
+
+// Begin loading paths (PFType loader) on nthr threads, keeping at
+// most depth images and about maxMB megabytes loaded ahead of the
+// consumer. Arguments <= 0 take defaults (see header).
+//
+// Return true if launches successful.
+//
+bool ImgPrefetch::Start(
+    const vector<string>	&paths,
+    int						type,
+    int						nthr,
+    int						depth,
+    int						maxMB,
+    FILE					*flog )
+{
+    Stop();
+
+    if( nthr <= 0 )
+        nthr = EnvInt( "PrefetchThreads", 2 );
+
+    if( depth <= 0 )
+        depth = EnvInt( "PrefetchDepth", 2 * nthr );
+
+    if( maxMB <= 0 )
+        maxMB = EnvInt( "PrefetchMB", 512 );
+
+    vpath			= paths;
+    this->type		= type;
+    this->depth		= depth;
+    this->flog		= flog;
+    maxbytes		= (long)maxMB << 20;
+    bytes			= 0;
+    inext			= 0;
+    iget			= 0;
+    quit			= false;
+
+    vslot.assign( paths.size(), CSlot() );
+
+    vthr = new pthread_t[nthr];
+
+    int	err = 0;
+
+    for( this->nthr = 0; this->nthr < nthr; ++this->nthr ) {
+
+        err = pthread_create( &vthr[this->nthr], NULL, _Loader, this );
+
+        if( err ) {
+
+            fprintf( flog,
+            "Error [%d] starting prefetch thread, index [%d].\n",
+            err, this->nthr );
+
+            break;
+        }
+    }
+
+    if( err ) {
+        Stop();
+        return false;
+    }
+
+    return true;
+}
+
+/* --------------------------------------------------------------- */
+/* ImgPrefetch::Next --------------------------------------------- */
+/* --------------------------------------------------------------- */
+
+// Wait for and return the next raster in list order, with dims.
+// Caller owns it and frees with RasterFree(). Returns NULL past
+// end of list (or if the loader returned NULL).
+//
+void* ImgPrefetch::Next( uint32 &w, uint32 &h )
+{
+    w = h = 0;
+
+    if( iget >= vslot.size() )
+        return NULL;
+
+    pthread_mutex_lock( &mutex );
+
+    CSlot	&S = vslot[iget];
+
+    while( !S.ready )
+        pthread_cond_wait( &cready, &mutex );
+
+    void	*ras = S.ras;
+
+    w = S.w;
+    h = S.h;
+
+    if( ras )
+        bytes -= (type == pfRas16 ? 2L : 1L) * w * h;
+
+    S.ras = NULL;
+    ++iget;
+
+    pthread_cond_broadcast( &croom );
+    pthread_mutex_unlock( &mutex );
+
+    return ras;
+}
+
+/* --------------------------------------------------------------- */
+/* ImgPrefetch::Stop --------------------------------------------- */
+/* --------------------------------------------------------------- */
+
+// Stop loaders and free any rasters not taken.
+//
+void ImgPrefetch::Stop()
+{
+    if( vthr ) {
+
+        pthread_mutex_lock( &mutex );
+        quit = true;
+        pthread_cond_broadcast( &croom );
+        pthread_mutex_unlock( &mutex );
+
+        for( int i = 0; i < nthr; ++i )
+            pthread_join( vthr[i], NULL );
+
+        delete [] vthr;
+        vthr = NULL;
+    }
+
+    int	ns = vslot.size();
+
+    for( int i = 0; i < ns; ++i ) {
+
+        if( vslot[i].ras )
+            RasterFree( vslot[i].ras );
+    }
+
+    vslot.clear();
+    vpath.clear();
+    nthr	= 0;
+    bytes	= 0;
+}
+
+
@@ -0,0 +1,87 @@
+
+
+#pragma once
+
+
+#include	"GenDefs.h"
+
+#include	<pthread.h>
+#include	<stdio.h>
+
+#include	<string>
+#include	<vector>
+using namespace std;
+
+
+/* --------------------------------------------------------------- */
+/* Constants ----------------------------------------------------- */
+/* --------------------------------------------------------------- */
+
+enum PFType {
+// Raster loader to use
+    pfRas8		= 0,	// Raster8FromAny
+    pfRas16		= 1		// Raster16FromTif16
+};
+
+/* --------------------------------------------------------------- */
+/* Types --------------------------------------------------------- */
+/* --------------------------------------------------------------- */
+
+// Loads an ordered list of images on background threads, ahead
+// of a consumer that takes them in list order with Next(), so
+// file reads overlap the consumer's compute.
+//
+// Read-ahead is bounded both by depth (images loaded but not yet
+// taken) and by a byte budget. Loader thread count is separate
+// from depth: depth hides latency, threads add bandwidth.
+//
+// Start() arguments <= 0 take defaults from the environment:
+// PrefetchThreads (2), PrefetchDepth (2*threads), PrefetchMB (512).
+//
+class ImgPrefetch {
+private:
+    class CSlot {
+    public:
+        void	*ras;
+        uint32	w, h;
+        bool	ready;
+    public:
+        CSlot() : ras(NULL), w(0), h(0), ready(false) {};
+    };
+private:
+    pthread_mutex_t		mutex;
+    pthread_cond_t		cready,		// wakes consumer: slot loaded
+                        croom;		// wakes loaders: may read ahead
+    pthread_t			*vthr;
+    FILE				*flog;
+    vector<string>		vpath;
+    vector<CSlot>		vslot;
+    long				bytes,		// loaded, not yet taken
+                        maxbytes;
+    int					type,
+                        nthr,
+                        depth,
+                        inext,		// next path to claim
+                        iget;		// next slot to hand out
+    bool				quit;
+private:
+    static void* _Loader( void* arg );
+    bool CanClaim() const;
+public:
+    ImgPrefetch();
+    virtual ~ImgPrefetch();
+
+    bool Start(
+        const vector<string>	&paths,
+        int						type,
+        int						nthr		= 0,
+        int						depth		= 0,
+        int						maxMB		= 0,
+        FILE					*flog		= stdout );
+
+    void* Next( uint32 &w, uint32 &h );
+
+    void Stop();
+};
+
+
@@ -1,12 +1,15 @@
 
 
 #include	"Disk.h"
+#include	"EZThreads.h"
 #include	"File.h"
 #include	"LinEqu.h"
 
 #include	"Maths.h"
 #include	"Memory.h"
+#include	"Timer.h"
 
+#include	<math.h>
 #include	<string.h>
 #include	<unistd.h>
 
@@ -24,6 +27,39 @@
 
 #define	kMaxDirectN	256
 
+// Conjugate gradient: converged when |r|/|b| <= kCGTol
+#define	kCGTol		1e-9
+#define	kCGMinIter	1000
+
+/* --------------------------------------------------------------- */
+/* Types --------------------------------------------------------- */
+/* --------------------------------------------------------------- */
+
+// Compressed sparse column form of LHS. Normal matrices are
+// stored with both triangles, so columns double as rows and
+// products can be formed row-wise (one output per column).
+
+class CSCMat {
+public:
+    vector<double>	val;
+    vector<int>		row,
+                    colptr;	// col j in [colptr[j], colptr[j+1])
+    int				n;
+public:
+    void FromLHS( const vector<LHSCol> &LHS );
+};
+
+/* --------------------------------------------------------------- */
+/* Statics ------------------------------------------------------- */
+/* --------------------------------------------------------------- */
+
+// Shared with _SpMV threads
+
+static const CSCMat	*gA;
+static const double	*gx;
+static double		*gy;
+static int			nthr;
+
 
 
 
@@ -650,6 +686,195 @@ bool Solve_Quick(
     return false;
 }
 
+/* --------------------------------------------------------------- */
+/* CSCMat::FromLHS ----------------------------------------------- */
+/* --------------------------------------------------------------- */
+
+void CSCMat::FromLHS( const vector<LHSCol> &LHS )
+{
+    n = LHS.size();
+
+    colptr.resize( n + 1 );
+    colptr[0] = 0;
+
+    for( int col = 0; col < n; ++col )
+        colptr[col+1] = colptr[col] + LHS[col].size();
+
+    val.resize( colptr[n] );
+    row.resize( colptr[n] );
+
+    for( int col = 0; col < n; ++col ) {
+
+        const LHSCol&	C  = LHS[col];
+        int				ne = C.size(),
+                        k0 = colptr[col];
+
+        for( int i = 0; i < ne; ++i ) {
+            val[k0+i] = C[i].val;
+            row[k0+i] = C[i].row;
+        }
+    }
+}
+
+/* --------------------------------------------------------------- */
+/* _SpMV --------------------------------------------------------- */
+/* --------------------------------------------------------------- */
+
+// y = A.x for symmetric A, threads striding over output
+// elements in contiguous chunks.
+//
+static void* _SpMV( void* ithr )
+{
+    const CSCMat&	A	= *gA;
+    int				n	= A.n,
+                    per	= (n + nthr - 1) / nthr,
+                    jlo	= (long)ithr * per,
+                    jhi	= min( jlo + per, n );
+
+    for( int j = jlo; j < jhi; ++j ) {
+
+        double	sum = 0.0;
+        int		kend = A.colptr[j+1];
+
+        for( int k = A.colptr[j]; k < kend; ++k )
+            sum += A.val[k] * gx[A.row[k]];
+
+        gy[j] = sum;
+    }
+
+    return NULL;
+}
+
+/* --------------------------------------------------------------- */
+/* SolvePCG ------------------------------------------------------ */
+/* --------------------------------------------------------------- */
+
+// In-process solve of symmetric positive definite system A.X = B
+// by Jacobi-preconditioned conjugate gradient. Matrix products
+// run on nproc threads from a pool that lives for this solve.
+//
+// Return true if converged.
+//
+static bool SolvePCG(
+    vector<double>			&X,
+    const vector<LHSCol>	&LHS,
+    const vector<double>	&RHS,
+    int						nproc )
+{
+    clock_t	t0 = StartTiming();
+
+    CSCMat	A;
+    int		n = RHS.size();
+
+    A.FromLHS( LHS );
+
+// Preconditioner = inverse diagonal
+
+    vector<double>	Minv( n, 1.0 );
+
+    for( int j = 0; j < n; ++j ) {
+
+        for( int k = A.colptr[j]; k < A.colptr[j+1]; ++k ) {
+
+            if( A.row[k] == j ) {
+
+                if( A.val[k] > 0.0 )
+                    Minv[j] = 1.0 / A.val[k];
+
+                break;
+            }
+        }
+    }
+
+// Threads
+
+    EZThreadPool	pool;
+
+    nthr = max( 1, min( nproc, n / 1000 + 1 ) );
+
+    if( !pool.Start( nthr, 0, "SpMV" ) )
+        nthr = 1;
+
+    gA = &A;
+
+// Iterate from X = 0
+
+    vector<double>	r( RHS ), z( n ), p( n ), Ap( n );
+    double			bnrm = 0.0, rnrm = 0.0, rz = 0.0;
+    int				maxit = max( kCGMinIter, 2 * n ),
+                    it;
+
+    X.assign( n, 0.0 );
+
+    for( int i = 0; i < n; ++i ) {
+        z[i]	= Minv[i] * r[i];
+        p[i]	= z[i];
+        rz		+= r[i] * z[i];
+        bnrm	+= r[i] * r[i];
+    }
+
+    bnrm = sqrt( bnrm );
+
+    if( bnrm == 0.0 ) {
+        StopTiming( stdout, "PCG", t0 );
+        return true;
+    }
+
+    for( it = 0; it < maxit; ++it ) {
+
+        gx = &p[0];
+        gy = &Ap[0];
+        pool.Run( _SpMV, nthr );
+
+        double	pAp = 0.0;
+
+        for( int i = 0; i < n; ++i )
+            pAp += p[i] * Ap[i];
+
+        if( pAp <= 0.0 )
+            break;
+
+        double	alpha = rz / pAp;
+
+        rnrm = 0.0;
+
+        for( int i = 0; i < n; ++i ) {
+            X[i] += alpha * p[i];
+            r[i] -= alpha * Ap[i];
+            rnrm += r[i] * r[i];
+        }
+
+        if( sqrt( rnrm ) <= kCGTol * bnrm ) {
+
+            printf( "PCG: converged in %d iters, |r|/|b| = %g.\n",
+            it + 1, sqrt( rnrm ) / bnrm );
+
+            StopTiming( stdout, "PCG", t0 );
+            return true;
+        }
+
+        double	rznew = 0.0;
+
+        for( int i = 0; i < n; ++i ) {
+            z[i]	= Minv[i] * r[i];
+            rznew	+= r[i] * z[i];
+        }
+
+        double	beta = rznew / rz;
+
+        rz = rznew;
+
+        for( int i = 0; i < n; ++i )
+            p[i] = z[i] + beta * p[i];
+    }
+
+    printf( "PCG: no convergence after %d iters, |r|/|b| = %g.\n",
+    it, sqrt( rnrm ) / bnrm );
+    StopTiming( stdout, "PCG", t0 );
+
+    return false;
+}
+
 /* --------------------------------------------------------------- */
 /* WriteSolveRead ------------------------------------------------ */
 /* --------------------------------------------------------------- */
@@ -670,13 +895,21 @@ bool Solve_Quick(
 // SuperLUSymSolveMPI and wait for it to create semaphore file
 // 'slu_signal'.
 //
+// method selects the large-system path:
+// 'S': (default) External SuperLU via disk files, as above.
+// 'C': In-process preconditioned conjugate gradient using nproc
+//      threads; falls back to 'S' if no convergence, always with
+//      nproc = 1 (local SuperLUSymSolve), since a thread count is
+//      not an MPI rank count and must not become a cluster job.
+//
 void WriteSolveRead(
     vector<double>			&X,
     const vector<LHSCol>	&LHS,
     const vector<double>	&RHS,
     const char				*jobtag,
     int						nproc,
-    bool					uniqueNames )
+    bool					uniqueNames,
+    int						method )
 {
     int	nvars = RHS.size();
 
@@ -689,6 +922,24 @@ void WriteSolveRead(
         return;
     }
 
+/* ---------- */
+/* In-process */
+/* ---------- */
+
+    if( method == 'C' ) {
+
+        printf( "\n[[ In-process PCG: %s ]]\n", jobtag );
+
+        if( SolvePCG( X, LHS, RHS, nproc ) ) {
+            printf( "[[ Exit solver ]]\n\n" );
+            fflush( stdout );
+            return;
+        }
+
+        printf( "PCG: Falling back to SuperLU.\n" );
+        nproc = 1;
+    }
+
 /* ----------------------------------- */
 /* Print equations into 'triples' file */
 /* ----------------------------------- */
@@ -72,6 +72,7 @@ void WriteSolveRead(
     const vector<double>	&RHS,
     const char				*jobtag,
     int						nproc,
-    bool					uniqueNames );
+    bool					uniqueNames,
+    int						method = 'S' );
 
 
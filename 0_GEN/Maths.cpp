@@ -1,6 +1,7 @@
 
 
 #include	"Maths.h"
+#include	"EZThreads.h"
 
 #include	<math.h>
 #include	<string.h>
@@ -19,6 +20,15 @@ using namespace std;
 
 #define	BINVAL( i )	(datamin + (i) * bwid)
 
+// LegPolyFlatten threading: pixels per band, max bands.
+#define	LEGFLAT_THRPTS	(2048 * 2048)
+#define	LEGFLAT_MAXTHR	8
+
+// DoGFilter threading: pixels per band, max bands, strip width.
+#define	DOG_THRPTS		(1024 * 1024)
+#define	DOG_MAXTHR		8
+#define	DOG_STRIP		64
+
 
 
 
@@ -104,6 +114,35 @@ int CeilPow2( int n )
     return p;
 }
 
+
+// Given n >= 0; return smallest p >= n such that
+// p = (2^a)(3^b)(5^c)(7^d). FFT libraries have fast
+// codelets for these radices.
+//
+int CeilSmooth( int n )
+{
+    int	best = CeilPow2( n );
+
+    for( int p7 = 1; p7 < best; p7 *= 7 ) {
+
+        for( int p5 = p7; p5 < best; p5 *= 5 ) {
+
+            for( int p3 = p5; p3 < best; p3 *= 3 ) {
+
+                int	p = p3;
+
+                while( p < n )
+                    p *= 2;
+
+                if( p < best )
+                    best = p;
+            }
+        }
+    }
+
+    return best;
+}
+
 /* --------------------------------------------------------------- */
 /* MeanStd::Stats ------------------------------------------------ */
 /* --------------------------------------------------------------- */
@@ -1000,84 +1039,353 @@ void LegPolyCreate(
 /* LegPolyFlatten ------------------------------------------------ */
 /* --------------------------------------------------------------- */
 
-// Project all src pixels onto low order Legendre polynomials
-// and remove those components. Place results in vals.
+// Separable implementation
+// ------------------------
+// Basis functions are F_k(x,y) = X_a(x).Y_b(y), k = (a,b), taken
+// a-major, skipping (0,0). Each component is removed in turn from
+// the residual. The F_k are not exactly orthogonal on the pixel
+// grid (nor under a fitting mask), so the result depends on that
+// order. We replay it exactly in coefficient space:
 //
-void LegPolyFlatten(
-    vector<double>		&vals,
-    const uint8*		src,
-    int					w,
-    int					h,
-    int					maxOrder )
+//   p_j = <F_j, v>, G_jk = <F_j, F_k>	(over fitted pixels)
+//   for each k: c_k = p_k / G_kk, then p_j -= c_k G_kj for all j
+//
+// and then subtract sum_k c_k F_k from every pixel in one pass.
+//
+// p and G come from column accumulators built in one image pass,
+//
+//   U_b(x)  = sum_y Y_b(y) m(x,y) v(x,y)
+//   W_bd(x) = sum_y Y_b(y) Y_d(y) m(x,y)	(mask m only)
+//
+// and without a mask G factors as Gx_ac * Gy_bd. Both image passes
+// are O(order N) elementwise row loops that the compiler vectorizes,
+// versus O(order^2 N) with a divide per pixel before. Rasters above
+// LEGFLAT_THRPTS are split into row bands over up to LEGFLAT_MAXTHR
+// threads.
+
+class CLegFlat {
+
+public:
+    class Band {
+    public:
+        CLegFlat		*F;
+        int				y0, ylim;
+        vector<double>	U, W;
+    };
+
+public:
+    double			*V;		// raster w x h, flattened in place
+    const uint32	*M;		// fit weights, NULL = all 1
+    int				w, h,
+                    no,		// maxOrder + 1
+                    np;		// num (b <= d) pairs
+    vector<double>	X, Y,	// X[a*w + x], Y[b*h + y]
+                    C;		// coefs C[a*no + b]
+    vector<Band>	vb;
+
+private:
+    inline int Pair( int b, int d ) const
+        {
+            if( b > d )
+                swap( b, d );
+
+            return b*no - b*(b-1)/2 + d - b;
+        };
+
+    void Run( void* (*proc)( void* ) )
+        {EZRunBands( proc, &vb[0], vb.size(), sizeof(Band) );};
+    void Solve();
+
+public:
+    void Flatten(
+        double			*V,
+        const uint32	*M,
+        int				w,
+        int				h,
+        int				maxOrder );
+};
+
+
+static inline void Axpy( double *y, double a, const double *x, int n )
 {
-// Copy indicated points to vals
+    for( int i = 0; i < n; ++i )
+        y[i] += a * x[i];
+}
 
-    int		npts = w * h;
 
-    vals.resize( npts );
+static inline double Dot( const double *a, const double *b, int n )
+{
+    double	s = 0.0;
 
-    for( int i = 0; i < npts; ++i )
-        vals[i] = src[i];
+    for( int i = 0; i < n; ++i )
+        s += a[i] * b[i];
 
-// Correct vals
+    return s;
+}
 
-    if( maxOrder > 0 ) {
 
-        // Create Legendre basis polynomials
+// Accumulate band's column sums U (and W).
+//
+static void* _LegAccum( void* arg )
+{
+    CLegFlat::Band	&B = *(CLegFlat::Band*)arg;
+    const CLegFlat	&F = *B.F;
+    int				w = F.w, h = F.h, no = F.no;
+    vector<double>	mr, mv;
 
-        vector<vector<double> > xpolys;
-        vector<vector<double> > ypolys;
+    B.U.assign( no * w, 0.0 );
 
-        LegPolyCreate( xpolys, maxOrder, w );
-        LegPolyCreate( ypolys, maxOrder, h );
+    if( F.M ) {
+        B.W.assign( F.np * w, 0.0 );
+        mr.resize( w );
+        mv.resize( w );
+    }
 
-        // Remove projections onto polys up to maxOrder
+    for( int y = B.y0; y < B.ylim; ++y ) {
 
-        for( int xo = 0; xo <= maxOrder; ++xo ) {
+        const double	*v = F.V + w*y;
 
-            const double*	XP = &xpolys[xo][0];
+        if( !F.M ) {
 
-            for( int yo = 0; yo <= maxOrder; ++yo ) {
+            for( int b = 0; b < no; ++b )
+                Axpy( &B.U[b*w], F.Y[b*h + y], v, w );
 
-                // the (0,0) term is just normalization
-                // which we do later anyway
+            continue;
+        }
 
-                if( xo + yo == 0 )
-                    continue;
+        const uint32	*m = F.M + w*y;
 
-                const double*	YP = &ypolys[yo][0];
+        for( int x = 0; x < w; ++x ) {
+            mr[x] = m[x];
+            mv[x] = m[x] * v[x];
+        }
 
-                // get projection coefficient
+        for( int b = 0, k = 0; b < no; ++b ) {
 
-                double	coef = 0.0, norm = 0.0;
+            double	yb = F.Y[b*h + y];
 
-                for( int i = 0; i < npts; ++i ) {
+            Axpy( &B.U[b*w], yb, &mv[0], w );
 
-                    int		y = i / w,
-                            x = i - w * y;
-                    double	F = XP[x] * YP[y];
+            for( int d = b; d < no; ++d, ++k )
+                Axpy( &B.W[k*w], yb * F.Y[d*h + y], &mr[0], w );
+        }
+    }
 
-                    coef	+= F * vals[i];
-                    norm	+= F * F;
-                }
+    return NULL;
+}
+
+
+// Subtract fitted surface from band's rows.
+//
+static void* _LegSub( void* arg )
+{
+    CLegFlat::Band	&B = *(CLegFlat::Band*)arg;
+    const CLegFlat	&F = *B.F;
+    int				w = F.w, h = F.h, no = F.no;
+    vector<double>	c( no );
+
+    for( int y = B.y0; y < B.ylim; ++y ) {
+
+        double	*v = F.V + w*y;
+
+        for( int a = 0; a < no; ++a ) {
 
-                coef /= norm;
+            c[a] = 0.0;
 
-                //printf( "LegFlatten: xo=%d yo=%d cof=%f\n",
-                //	xo, yo, coef );
+            for( int b = 0; b < no; ++b )
+                c[a] += F.C[a*no + b] * F.Y[b*h + y];
+        }
+
+        for( int a = 0; a < no; ++a )
+            Axpy( v, -c[a], &F.X[a*w], w );
+    }
+
+    return NULL;
+}
+
+
+// Reduce band sums, form p and G, and replay the sequential
+// removal to get coefs C.
+//
+void CLegFlat::Solve()
+{
+    int	nb = vb.size(), K = no * no;
+
+    vector<double>	&U = vb[0].U,
+                    &W = vb[0].W;
+
+    for( int i = 1; i < nb; ++i ) {
+
+        Axpy( &U[0], 1.0, &vb[i].U[0], U.size() );
+
+        if( M )
+            Axpy( &W[0], 1.0, &vb[i].W[0], W.size() );
+    }
+
+// Projections p_(a,b) = <X_a, U_b>
+
+    vector<double>	p( K );
+
+    for( int a = 0; a < no; ++a ) {
+
+        for( int b = 0; b < no; ++b )
+            p[a*no + b] = Dot( &X[a*w], &U[b*w], w );
+    }
 
-                // now remove that component
+// Gram G_(a,b),(c,d) = Z[pair(a,c)][pair(b,d)]
 
-                for( int i = 0; i < npts; ++i ) {
+    vector<double>	Z( np * np ), xx( w );
 
-                    int		y = i / w,
-                            x = i - w * y;
+    if( M ) {
 
-                    vals[i] -= coef * XP[x] * YP[y];
+        for( int a = 0; a < no; ++a ) {
+
+            for( int c = a; c < no; ++c ) {
+
+                const double	*Xa = &X[a*w], *Xc = &X[c*w];
+                int				ac = Pair( a, c );
+
+                for( int x = 0; x < w; ++x )
+                    xx[x] = Xa[x] * Xc[x];
+
+                for( int bd = 0; bd < np; ++bd )
+                    Z[ac*np + bd] = Dot( &xx[0], &W[bd*w], w );
+            }
+        }
+    }
+    else {
+
+        vector<double>	gx( np ), gy( np );
+
+        for( int a = 0; a < no; ++a ) {
+
+            for( int c = a; c < no; ++c ) {
+                gx[Pair( a, c )] = Dot( &X[a*w], &X[c*w], w );
+                gy[Pair( a, c )] = Dot( &Y[a*h], &Y[c*h], h );
+            }
+        }
+
+        for( int i = 0; i < np; ++i ) {
+
+            for( int j = 0; j < np; ++j )
+                Z[i*np + j] = gx[i] * gy[j];
+        }
+    }
+
+// Sequential removal; (0,0) term is just normalization
+// which is done later anyway.
+
+    C.assign( K, 0.0 );
+
+    for( int a = 0; a < no; ++a ) {
+
+        for( int b = 0; b < no; ++b ) {
+
+            if( a + b == 0 )
+                continue;
+
+            int		k		= a*no + b;
+            double	norm	= Z[Pair( a, a )*np + Pair( b, b )];
+
+            if( norm <= 0.0 )
+                continue;
+
+            double	coef = p[k] / norm;
+
+            C[k] = coef;
+
+            for( int c = 0; c < no; ++c ) {
+
+                for( int d = 0; d < no; ++d ) {
+
+                    p[c*no + d] -= coef *
+                        Z[Pair( a, c )*np + Pair( b, d )];
                 }
             }
         }
     }
+}
+
+
+void CLegFlat::Flatten(
+    double			*V,
+    const uint32	*M,
+    int				w,
+    int				h,
+    int				maxOrder )
+{
+    this->V	= V;
+    this->M	= M;
+    this->w	= w;
+    this->h	= h;
+    no		= maxOrder + 1;
+    np		= no * (no + 1) / 2;
+
+// Basis tables
+
+    vector<vector<double> >	L;
+
+    LegPolyCreate( L, maxOrder, w );
+    X.resize( no * w );
+    for( int a = 0; a < no; ++a )
+        memcpy( &X[a*w], &L[a][0], w * sizeof(double) );
+
+    LegPolyCreate( L, maxOrder, h );
+    Y.resize( no * h );
+    for( int b = 0; b < no; ++b )
+        memcpy( &Y[b*h], &L[b][0], h * sizeof(double) );
+
+// Row bands
+
+    int	nb = EZBandCount( (long)w * h, LEGFLAT_THRPTS,
+                LEGFLAT_MAXTHR, h );
+
+    vb.resize( nb );
+
+    for( int i = 0; i < nb; ++i ) {
+        vb[i].F		= this;
+        vb[i].y0	= (long)h * i / nb;
+        vb[i].ylim	= (long)h * (i + 1) / nb;
+    }
+
+// Fit and subtract
+
+    Run( _LegAccum );
+    Solve();
+    Run( _LegSub );
+}
+
+/* --------------------------------------------------------------- */
+/* LegPolyFlatten ------------------------------------------------ */
+/* --------------------------------------------------------------- */
+
+// Project all src pixels onto low order Legendre polynomials
+// and remove those components. Place results in vals.
+//
+void LegPolyFlatten(
+    vector<double>		&vals,
+    const uint8*		src,
+    int					w,
+    int					h,
+    int					maxOrder )
+{
+// Copy indicated points to vals
+
+    int		npts = w * h;
+
+    vals.resize( npts );
+
+    for( int i = 0; i < npts; ++i )
+        vals[i] = src[i];
+
+// Correct vals
+
+    if( maxOrder > 0 ) {
+
+        CLegFlat	F;
+
+        F.Flatten( &vals[0], NULL, w, h, maxOrder );
+    }
 
 // Final normalization
 
@@ -1091,6 +1399,8 @@ void LegPolyFlatten(
 // Project all src pixels onto low order Legendre polynomials
 // and remove those components. Place results in vals.
 //
+// Only pixels <= (mode + offset) are used for the fit.
+//
 void LegPolyFlatten(
     vector<double>		&vals,
     const uint16*		src,
@@ -1130,63 +1440,13 @@ void LegPolyFlatten(
 
     if( maxOrder > 0 ) {
 
-        // Create Legendre basis polynomials
-
-        vector<vector<double> > xpolys;
-        vector<vector<double> > ypolys;
-
-        LegPolyCreate( xpolys, maxOrder, w );
-        LegPolyCreate( ypolys, maxOrder, h );
-
-        // Remove projections onto polys up to maxOrder
-
-        for( int xo = 0; xo <= maxOrder; ++xo ) {
-
-            const double*	XP = &xpolys[xo][0];
-
-            for( int yo = 0; yo <= maxOrder; ++yo ) {
-
-                // the (0,0) term is just normalization
-                // which we do later anyway
-
-                if( xo + yo == 0 )
-                    continue;
-
-                const double*	YP = &ypolys[yo][0];
-
-                // get projection coefficient
-
-                double	coef = 0.0, norm = 0.0;
-
-                for( int i = 0; i < npts; ++i ) {
-
-                    if( src[i] <= thresh ) {
-
-                        int		y = i / w,
-                                x = i - w * y;
-                        double	F = XP[x] * YP[y];
-
-                        coef	+= F * vals[i];
-                        norm	+= F * F;
-                    }
-                }
-
-                coef /= norm;
-
-                //printf( "LegFlatten: xo=%d yo=%d cof=%f\n",
-                //	xo, yo, coef );
+        vector<uint32>	fit( npts );
+        CLegFlat		F;
 
-                // now remove that component
+        for( int i = 0; i < npts; ++i )
+            fit[i] = (src[i] <= thresh);
 
-                for( int i = 0; i < npts; ++i ) {
-
-                    int		y = i / w,
-                            x = i - w * y;
-
-                    vals[i] -= coef * XP[x] * YP[y];
-                }
-            }
-        }
+        F.Flatten( &vals[0], &fit[0], w, h, maxOrder );
     }
 
 // Final normalization
@@ -1223,61 +1483,27 @@ void LegPolyFlatten(
         vals[i] = src[x + w * y];
     }
 
-// Correct vals
+// Correct vals: fit over listed pixels (weighted by
+// multiplicity) of a raster, then pick them back up.
 
     if( maxOrder > 0 ) {
 
-        // Create Legendre basis polynomials
-
-        vector<vector<double> > xpolys;
-        vector<vector<double> > ypolys;
-
-        LegPolyCreate( xpolys, maxOrder, w );
-        LegPolyCreate( ypolys, maxOrder, h );
-
-        // Remove projections onto polys up to maxOrder
-
-        for( int xo = 0; xo <= maxOrder; ++xo ) {
-
-            const double*	XP = &xpolys[xo][0];
-
-            for( int yo = 0; yo <= maxOrder; ++yo ) {
-
-                // the (0,0) term is just normalization
-                // which we do later anyway
-
-                if( xo + yo == 0 )
-                    continue;
-
-                const double*	YP = &ypolys[yo][0];
-
-                // get projection coefficient
-
-                double	coef = 0.0, norm = 0.0;
-
-                for( int i = 0; i < npts; ++i ) {
-
-                    double F =
-                    XP[(int)pts[i].x] * YP[(int)pts[i].y];
+        vector<double>	V( w * h, 0.0 );
+        vector<uint32>	fit( w * h, 0 );
+        CLegFlat		F;
 
-                    coef	+= F * vals[i];
-                    norm	+= F * F;
-                }
-
-                coef /= norm;
+        for( int i = 0; i < npts; ++i ) {
 
-                //printf( "LegFlatten: xo=%d yo=%d cof=%f\n",
-                //	xo, yo, coef );
+            int	j = (int)pts[i].x + w * (int)pts[i].y;
 
-                // now remove that component
+            V[j] = vals[i];
+            ++fit[j];
+        }
 
-                for( int i = 0; i < npts; ++i ) {
+        F.Flatten( &V[0], &fit[0], w, h, maxOrder );
 
-                    vals[i] -= coef *
-                    XP[(int)pts[i].x] * YP[(int)pts[i].y];
-                }
-            }
-        }
+        for( int i = 0; i < npts; ++i )
+            vals[i] = V[(int)pts[i].x + w * (int)pts[i].y];
     }
 
 // Final normalization
@@ -1363,6 +1589,265 @@ void DecimateVector(
     v.resize( k );
 }
 
+/* --------------------------------------------------------------- */
+/* DoGFilter ----------------------------------------------------- */
+/* --------------------------------------------------------------- */
+
+// The DoG kernel exp(-r^2/2s1^2)/S1 - exp(-r^2/2s2^2)/S2, cut off
+// at |x|,|y| <= d = 3 x r2, factors exactly into 1D Gaussians g
+// over [-d, d], with S = (sum g)^2. So we blur twice separably
+// (rows, then column strips), each pass taking O(d) per pixel and
+// padding with zeros as the old FFT path did, and subtract. Work
+// is all in place on floats: one extra raster of memory in total,
+// plus per-thread line scratch. Threads are made per call by
+// EZRunBands, as for CLegFlat, so concurrent callers don't collide.
+
+class CDoG {
+
+public:
+    class Band {
+    public:
+        CDoG	*F;
+        int		i0, ilim;	// rows or strips
+    };
+
+public:
+    float			*I,		// raster w x h; g1 then DoG
+                    *B;		// raster w x h; g2
+    int				w, h,
+                    d,		// kernel half-width
+                    ns;		// num column strips
+    vector<float>	k1, k2;	// half kernels [0..d]
+    vector<Band>	vb;
+
+private:
+    void Run( void* (*proc)( void* ), int n );
+
+public:
+    void Filter( float *I, int w, int h, int r1, int r2 );
+};
+
+
+// Normalized half kernel k[0..d] of 1D Gaussian sd r.
+//
+static void DoGHalfKernel( vector<float> &k, int r, int d )
+{
+    vector<double>	g( d + 1, 0.0 );
+    double			sum;
+
+    if( r > 0 ) {
+
+        for( int x = 0; x <= d; ++x )
+            g[x] = exp( -(double)(x*x) / (2*r*r) );
+    }
+    else
+        g[0] = 1.0;
+
+    sum = g[0];
+
+    for( int x = 1; x <= d; ++x )
+        sum += 2 * g[x];
+
+    k.resize( d + 1 );
+
+    for( int x = 0; x <= d; ++x )
+        k[x] = g[x] / sum;
+}
+
+
+// Blur band's rows of I into I (g1) and B (g2).
+//
+static void* _DoGRows( void* arg )
+{
+    CDoG::Band		&R = *(CDoG::Band*)arg;
+    const CDoG		&F = *R.F;
+    int				w = F.w, d = F.d;
+    vector<float>	pad( w + 2*d, 0.0f );
+    const float		*k1 = &F.k1[0],
+                    *k2 = &F.k2[0];
+    float			*p  = &pad[d];
+
+    for( int y = R.i0; y < R.ilim; ++y ) {
+
+        float	*i1 = F.I + w*y,
+                *i2 = F.B + w*y;
+
+        memcpy( p, i1, w * sizeof(float) );
+
+        for( int x = 0; x < w; ++x ) {
+
+            float	s1 = k1[0] * p[x],
+                    s2 = k2[0] * p[x];
+
+            for( int j = 1; j <= d; ++j ) {
+
+                float	q = p[x-j] + p[x+j];
+
+                s1 += k1[j] * q;
+                s2 += k2[j] * q;
+            }
+
+            i1[x] = s1;
+            i2[x] = s2;
+        }
+    }
+
+    return NULL;
+}
+
+
+// Blur band's column strips of I and B and set I = I - B.
+//
+static void* _DoGCols( void* arg )
+{
+    CDoG::Band		&R = *(CDoG::Band*)arg;
+    const CDoG		&F = *R.F;
+    int				w = F.w, h = F.h, d = F.d;
+    vector<float>	pad1( (h + 2*d) * DOG_STRIP, 0.0f ),
+                    pad2( (h + 2*d) * DOG_STRIP, 0.0f ),
+                    s1( DOG_STRIP ), s2( DOG_STRIP );
+    const float		*k1 = &F.k1[0],
+                    *k2 = &F.k2[0];
+
+    for( int is = R.i0; is < R.ilim; ++is ) {
+
+        int	x0 = is * DOG_STRIP,
+            sw = min( DOG_STRIP, w - x0 );
+
+        // gather strip; pad rows stay zero
+
+        for( int y = 0; y < h; ++y ) {
+
+            memcpy( &pad1[(y + d)*DOG_STRIP], F.I + x0 + w*y,
+                sw * sizeof(float) );
+
+            memcpy( &pad2[(y + d)*DOG_STRIP], F.B + x0 + w*y,
+                sw * sizeof(float) );
+        }
+
+        // filter down the strip
+
+        for( int y = 0; y < h; ++y ) {
+
+            const float	*c1 = &pad1[(y + d)*DOG_STRIP],
+                        *c2 = &pad2[(y + d)*DOG_STRIP];
+
+            for( int x = 0; x < sw; ++x ) {
+                s1[x] = k1[0] * c1[x];
+                s2[x] = k2[0] * c2[x];
+            }
+
+            for( int j = 1; j <= d; ++j ) {
+
+                const float	*a1 = c1 - j*DOG_STRIP,
+                            *b1 = c1 + j*DOG_STRIP,
+                            *a2 = c2 - j*DOG_STRIP,
+                            *b2 = c2 + j*DOG_STRIP;
+                float		q1 = k1[j],
+                            q2 = k2[j];
+
+                for( int x = 0; x < sw; ++x ) {
+                    s1[x] += q1 * (a1[x] + b1[x]);
+                    s2[x] += q2 * (a2[x] + b2[x]);
+                }
+            }
+
+            float	*o = F.I + x0 + w*y;
+
+            for( int x = 0; x < sw; ++x )
+                o[x] = s1[x] - s2[x];
+        }
+    }
+
+    return NULL;
+}
+
+
+// Run proc on the n rows or strips split into bands; band 0
+// on calling thread.
+//
+void CDoG::Run( void* (*proc)( void* ), int n )
+{
+    int	nb = EZBandCount( (long)w * h, DOG_THRPTS, DOG_MAXTHR, n );
+
+    vb.resize( nb );
+
+    for( int i = 0; i < nb; ++i ) {
+        vb[i].F		= this;
+        vb[i].i0	= (long)n * i / nb;
+        vb[i].ilim	= (long)n * (i + 1) / nb;
+    }
+
+    EZRunBands( proc, &vb[0], nb, sizeof(Band) );
+}
+
+
+void CDoG::Filter( float *I, int w, int h, int r1, int r2 )
+{
+    vector<float>	vB( w * h );
+
+    this->I	= I;
+    this->B	= &vB[0];
+    this->w	= w;
+    this->h	= h;
+    d		= 3 * r2;
+    ns		= (w + DOG_STRIP - 1) / DOG_STRIP;
+
+    DoGHalfKernel( k1, r1, d );
+    DoGHalfKernel( k2, r2, d );
+
+    Run( _DoGRows, h );
+    Run( _DoGCols, ns );
+}
+
+/* --------------------------------------------------------------- */
+/* DoGFilter ----------------------------------------------------- */
+/* --------------------------------------------------------------- */
+
+// Replace float raster I by its Difference-of-Gaussians with
+// radii (standard devs) r1 < r2. This is an edge enhancement
+// (band pass) filter; choose {r1, r2} around {3, 6}.
+//
+// The result is not normalized. Nothing is done if r2 <= 0.
+//
+void DoGFilter( float *I, int w, int h, int r1, int r2 )
+{
+    if( r2 <= 0 || w <= 0 || h <= 0 )
+        return;
+
+    CDoG	F;
+
+    F.Filter( I, w, h, r1, r2 );
+}
+
+/* --------------------------------------------------------------- */
+/* DoGFilter ----------------------------------------------------- */
+/* --------------------------------------------------------------- */
+
+// Set dst = DoG of src (as above). dst can be same as src.
+//
+void DoGFilter(
+    vector<double>			&dst,
+    const vector<double>	&src,
+    int						w,
+    int						h,
+    int						r1,
+    int						r2 )
+{
+    int				n = w * h;
+    vector<float>	I( n );
+
+    for( int i = 0; i < n; ++i )
+        I[i] = src[i];
+
+    DoGFilter( &I[0], w, h, r1, r2 );
+
+    dst.resize( n );
+
+    for( int i = 0; i < n; ++i )
+        dst[i] = I[i];
+}
+
 /* --------------------------------------------------------------- */
 /* InterpolatePixel ---------------------------------------------- */
 /* --------------------------------------------------------------- */
@@ -32,6 +32,7 @@ uint32 SuperFastHash( const char * data, int len );
 /* --------------------------------------------------------------- */
 
 int CeilPow2( int n );
+int CeilSmooth( int n );
 
 /* --------------------------------------------------------------- */
 /* Statistics ---------------------------------------------------- */
@@ -185,6 +186,16 @@ void CopyRaster(
     int				wCopy,
     int				hCopy );
 
+void DoGFilter( float *I, int w, int h, int r1, int r2 );
+
+void DoGFilter(
+    vector<double>			&dst,
+    const vector<double>	&src,
+    int						w,
+    int						h,
+    int						r1,
+    int						r2 );
+
 void DecimateVector(
     vector<Point>	&p,
     vector<double>	&v,
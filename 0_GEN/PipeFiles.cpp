@@ -5,6 +5,7 @@
 #include	"PipeFiles.h"
 
 #include	<string.h>
+#include	<unistd.h>
 
 #include	<algorithm>
 using namespace std;
@@ -58,6 +59,31 @@ char *NamePtsFile( char *buf, int alr, int blr )
     return buf;
 }
 
+/* --------------------------------------------------------------- */
+/* NamePtsShard -------------------------------------------------- */
+/* --------------------------------------------------------------- */
+
+// Binary shard of PtsRec written by this ptest process (-shards),
+// in place of locked appends to the shared pts file. Unique per
+// host and pid, so concurrent writers on any node never collide.
+//
+// Pattern: pts.{up,same,down}.host.pid.bin
+//
+char *NamePtsShard( char *buf, int alr, int blr )
+{
+    char	host[256];
+
+    if( gethostname( host, sizeof(host) ) )
+        strcpy( host, "host" );
+
+    host[sizeof(host) - 1] = 0;
+
+    NamePtsFile( buf, alr, blr );
+    sprintf( buf + strlen( buf ), ".%s.%d.bin", host, (int)getpid() );
+
+    return buf;
+}
+
 /* --------------------------------------------------------------- */
 /* NameLogFile --------------------------------------------------- */
 /* --------------------------------------------------------------- */
@@ -158,12 +184,14 @@ bool ReadScriptParams(
         GETPRM_SCR( &S.stripwidth, "stripwidth=%d" );
         GETPRM_SCR( &S.stripsweepspan, "stripsweepspan=%lf" );
         GETPRM_SCR( &S.stripsweepstep, "stripsweepstep=%lf" );
+        GETPRM_SCR( &S.stripsweepfm, "stripsweepfm=%d" );
         GETPRM_SCR( &S.stripmincorr, "stripmincorr=%lf" );
         GETPRM_SCR( &S.stripslots, "stripslots=%d" );
 
         GETPRM_SCR( &S.crossblocksize, "crossblocksize=%d" );
         GETPRM_SCR( &S.blocksweepspan, "blocksweepspan=%lf" );
         GETPRM_SCR( &S.blocksweepstep, "blocksweepstep=%lf" );
+        GETPRM_SCR( &S.blocksweepfm, "blocksweepfm=%d" );
         GETPRM_SCR( &S.blockxyconf, "blockxyconf=%lf" );
         GETPRM_SCR( &S.blockmincorr, "blockmincorr=%lf" );
         GETPRM_SCR( &S.blocknomcorr, "blocknomcorr=%lf" );
@@ -43,8 +43,10 @@ typedef struct {
             rendersdevcnts,
             maskoutresin,
             stripwidth,
+            stripsweepfm,
             stripslots,
             crossblocksize,
+            blocksweepfm,
             blockreqdz,
             blockmaxdz,
             blockslots,
@@ -142,6 +144,14 @@ typedef struct {
                 id;
 } PicSpec;
 
+typedef struct {
+// record: ptest binary pts shard; as CPOINT2 line
+    int		z1, id1, r1,
+            z2, id2, r2;
+    double	x1, y1,
+            x2, y2;
+} PtsRec;
+
 typedef struct {
 // entry: ThmPair.txt
     TAffine	T;
@@ -215,6 +225,7 @@ public:
 void OpenPairLog( int alr, int atl, int blr, int btl );
 
 char *NamePtsFile( char *buf, int alr, int blr );
+char *NamePtsShard( char *buf, int alr, int blr );
 char *NameLogFile( char *buf, int alr, int atl, int blr, int btl );
 
 bool ReadScriptParams(
@@ -0,0 +1,585 @@
+
+
+#include	"ScapePaint.h"
+#include	"EZThreads.h"
+#include	"ImageIO.h"
+#include	"Maths.h"
+
+#include	<stdlib.h>
+#include	<string.h>
+
+
+/* --------------------------------------------------------------- */
+/* ScanLims ------------------------------------------------------ */
+/* --------------------------------------------------------------- */
+
+// Fill in the range of coords [x0,xL); [y0,yL) in the scape
+// that the given tile will occupy. This tells the painter
+// which region to fill in.
+//
+// We expand the tile by one pixel to be conservative, and
+// transform the tile bounds to scape coords. In no case are
+// the scape coords to exceed [0,ws); [0,hs).
+//
+static void ScanLims(
+    int				&x0,
+    int				&xL,
+    int				&y0,
+    int				&yL,
+    int				ws,
+    int				hs,
+    const TAffine	&T,
+    int				wi,
+    int				hi )
+{
+    double	xmin, xmax, ymin, ymax;
+
+    xmin =  BIGD;
+    xmax = -BIGD;
+    ymin =  BIGD;
+    ymax = -BIGD;
+
+    vector<Point>	cnr( 4 );
+
+// generous box (outset 1 pixel) for scanning
+
+    cnr[0] = Point( -1.0, -1.0 );
+    cnr[1] = Point(   wi, -1.0 );
+    cnr[2] = Point(   wi,   hi );
+    cnr[3] = Point( -1.0,   hi );
+
+    T.Transform( cnr );
+
+    for( int k = 0; k < 4; ++k ) {
+        xmin = fmin( xmin, cnr[k].x );
+        xmax = fmax( xmax, cnr[k].x );
+        ymin = fmin( ymin, cnr[k].y );
+        ymax = fmax( ymax, cnr[k].y );
+    }
+
+    x0 = max( 0, (int)floor( xmin ) );
+    y0 = max( 0, (int)floor( ymin ) );
+    xL = min( ws, (int)ceil( xmax ) );
+    yL = min( hs, (int)ceil( ymax ) );
+}
+
+/* --------------------------------------------------------------- */
+/* Downsample ---------------------------------------------------- */
+/* --------------------------------------------------------------- */
+
+static void Downsample( uint8 *ras, int &w, int &h, int iscl )
+{
+    int	n  = iscl * iscl,
+        ws = (int)ceil( (double)w / iscl ),
+        hs = (int)ceil( (double)h / iscl ),
+        w0 = w,
+        xo, yo, xr, yr;
+
+// Averaging is always over iscl x iscl blocks.
+// (xo,yo) allows the block to line up with the
+// right-bottom edge of the image.
+
+    yr = iscl - h % iscl;
+    xr = iscl - w % iscl;
+
+    for( int iy = 0; iy < hs; ++iy ) {
+
+        yo = 0;
+
+        if( iy == hs - 1 )
+            yo = yr;
+
+        for( int ix = 0; ix < ws; ++ix ) {
+
+            double	sum = 0.0;
+
+            xo = 0;
+
+            if( ix == ws - 1 )
+                xo = xr;
+
+            for( int dy = 0; dy < iscl; ++dy ) {
+
+                for( int dx = 0; dx < iscl; ++dx )
+                    sum += ras[ix*iscl-xo+dx + w0*(iy*iscl-yo+dy)];
+            }
+
+            ras[ix+ws*iy] = int(sum / n);
+        }
+    }
+
+    w = ws;
+    h = hs;
+}
+
+/* --------------------------------------------------------------- */
+/* NormRas ------------------------------------------------------- */
+/* --------------------------------------------------------------- */
+
+// Force image mean to 127 and sd to sdnorm.
+//
+static void NormRas( uint8 *r, int w, int h, int lgord, int sdnorm )
+{
+// flatfield & convert to doubles
+
+    int				n = w * h;
+    vector<double>	v;
+
+    LegPolyFlatten( v, r, w, h, lgord );
+
+// rescale to mean=127, sd=sdnorm
+
+    for( int i = 0; i < n; ++i ) {
+
+        int	pix = 127 + int(v[i] * sdnorm);
+
+        if( pix < 0 )
+            pix = 0;
+        else if( pix > 255 )
+            pix = 255;
+
+        r[i] = pix;
+    }
+}
+
+/* --------------------------------------------------------------- */
+/* Painting ------------------------------------------------------ */
+/* --------------------------------------------------------------- */
+
+// Painting fills a destination window gD of the scape, in two
+// threaded phases:
+//
+// - _Prep: threads load and condition the tiles in vload.
+// - _Paint: threads own disjoint row bands of gD. Each band
+//	paints the tiles that reach it (vband index) in list order,
+//	so overlaps resolve as "last tile wins", exactly as a serial
+//	painter would, regardless of scheduling.
+//
+// In memory, gD is the whole scape and tiles go in batches that
+// bound the number of conditioned tiles held at once. Tiled, gD
+// is one output tile and conditioned tiles live in an LRU cache.
+//
+// Tiles per thread per batch, and min rows per band.
+#define	BATCH_PER_THR	4
+#define	BAND_MINROWS	16
+
+class CPrepTile {
+// Conditioned tile ready to paint
+public:
+    uint8	*src;
+    TAffine	inv;			// scape -> src pixels
+    long	nb,				// allocated bytes
+            used;			// LRU stamp
+    int		wi, hi,
+            x0, xL, y0, yL;	// scape scan limits
+public:
+    CPrepTile() : src(NULL), nb(0), used(0) {};
+};
+
+class CDstWin {
+// Destination window: raster holds scape [x0,x0+w) x [y0,y0+h)
+public:
+    uint8	*ras;
+    int		x0, y0, w, h;
+public:
+    CDstWin() : ras(NULL), x0(0), y0(0), w(0), h(0) {};
+
+    CDstWin( uint8 *ras, int x0, int y0, int w, int h )
+    : ras(ras), x0(x0), y0(y0), w(w), h(h) {};
+};
+
+static const CScapePaint	*GP;
+static CDstWin				gD;
+static vector<CPrepTile>	vprep;	// per tile
+static vector<int>			vload;	// tile indices to prep
+static vector<vector<int> >	vband;	// band -> tile indices
+static int					gnthr,
+                            gbandh;
+
+
+static void* _Prep( void *ithr )
+{
+    int	nl = vload.size();
+
+    for( int k = (long)ithr; k < nl; k += gnthr ) {
+
+        int				i = vload[k];
+        CPrepTile		&P = vprep[i];
+        vector<uint8>	msk;
+        uint32			w,  h;
+
+        P.src = Raster8FromAny(
+                GP->vname[i].c_str(),
+                w, h, GP->flog );
+
+        if( !P.src )
+            continue;
+
+        P.nb = w * h;
+
+        if( GP->resmask )
+            ResinMask8( msk, P.src, w, h, false );
+
+        if( GP->sdnorm > 0 )
+            NormRas( P.src, w, h, GP->lgord, GP->sdnorm );
+
+        if( GP->resmask ) {
+
+            int	n = w * h;
+
+            for( int j = 0; j < n; ++j ) {
+                if( !msk[j] )
+                    P.src[j] = GP->bkval;
+            }
+        }
+
+        ScanLims( P.x0, P.xL, P.y0, P.yL,
+            GP->ws, GP->hs, GP->vT[i], w, h );
+        P.wi = w;
+        P.hi = h;
+
+        P.inv.InverseOf( GP->vT[i] );
+
+        if( GP->iscl > 1 ) {	// Scaling down
+
+            // actually downsample src image
+            Downsample( P.src, P.wi, P.hi, GP->iscl );
+
+            // and point at the new pixels
+            TAffine	A;
+            A.NUSetScl( 1.0/GP->iscl );
+            P.inv = A * P.inv;
+        }
+    }
+
+    return NULL;
+}
+
+
+// Paint rows [ya,yb) of tile P into gD. The row terms of the
+// affine are hoisted out of the scanline, but each pixel still
+// sums them in TAffine::Transform order, so coords match the
+// per-point path bit for bit (stepping by t[0] would drift).
+// Bilinear sampling needs no bounds tests because (x,y) is in
+// [0,wi-1) x [0,hi-1), and follows SafeInterp's arithmetic order.
+//
+static void PaintRows( const CPrepTile &P, int ya, int yb )
+{
+    const double	*t	= P.inv.t;
+    const uint8		*s	= P.src;
+    int				bk	= GP->bkval,
+                    wi	= P.wi,
+                    wL	= P.wi - 1,
+                    hL	= P.hi - 1,
+                    dx	= gD.x0,
+                    xa	= max( P.x0, gD.x0 ),
+                    xb	= min( P.xL, gD.x0 + gD.w );
+
+    for( int iy = ya; iy < yb; ++iy ) {
+
+        uint8	*d	= gD.ras + gD.w*(iy - gD.y0);
+        double	rx	= iy*t[1],
+                ry	= iy*t[4];
+
+        for( int ix = xa; ix < xb; ++ix ) {
+
+            double	x = ix*t[0] + rx + t[2],
+                    y = ix*t[3] + ry + t[5];
+
+            if( x >= 0 && x < wL && y >= 0 && y < hL ) {
+
+                int				jx	= (int)x,
+                                jy	= (int)y;
+                double			a	= x - jx,
+                                b	= y - jy,
+                                v	= 0.0;
+                const uint8		*p	= s + jx + wi*jy;
+
+                v += (1.0-a)*(1.0-b)*p[0];
+                v += (1.0-a)*b*p[wi];
+                v += a*(1.0-b)*p[1];
+                v += a*b*p[wi+1];
+
+                int	pix = (int)v;
+
+                if( pix != bk )
+                    d[ix - dx] = pix;
+            }
+        }
+    }
+}
+
+
+static void* _Paint( void *ithr )
+{
+    int	nb = vband.size();
+
+    for( int j = (long)ithr; j < nb; j += gnthr ) {
+
+        const vector<int>	&vk = vband[j];
+        int					by0 = gD.y0 + j * gbandh,
+                            byL = min( gD.y0 + gD.h, by0 + gbandh ),
+                            nk  = vk.size();
+
+        for( int ik = 0; ik < nk; ++ik ) {
+
+            const CPrepTile	&P = vprep[vk[ik]];
+
+            PaintRows( P, max( by0, P.y0 ), min( byL, P.yL ) );
+        }
+    }
+
+    return NULL;
+}
+
+
+// Paint listed (ascending) tile indices into gD.
+//
+static void PaintWin( const vector<int> &vi, FILE* flog )
+{
+    int	nband, ni = vi.size();
+
+    gbandh	= max( BAND_MINROWS, (gD.h + 4*gnthr - 1) / (4*gnthr) );
+    nband	= (gD.h + gbandh - 1) / gbandh;
+
+    vband.assign( nband, vector<int>() );
+
+    for( int k = 0; k < ni; ++k ) {
+
+        const CPrepTile	&P = vprep[vi[k]];
+        int				ya = max( P.y0, gD.y0 ),
+                        yb = min( P.yL, gD.y0 + gD.h );
+
+        if( !P.src || ya >= yb ||
+            P.x0 >= gD.x0 + gD.w || P.xL <= gD.x0 ) {
+
+            continue;
+        }
+
+        int	jL = (yb - 1 - gD.y0) / gbandh;
+
+        for( int j = (ya - gD.y0) / gbandh; j <= jL; ++j )
+            vband[j].push_back( vi[k] );
+    }
+
+    if( !EZThreads( _Paint, min( gnthr, nband ), 2,
+            "_ScapePaint", flog ) ) {
+
+        exit( 42 );
+    }
+}
+
+
+static void PrepTiles( FILE* flog )
+{
+    int	nl = vload.size();
+
+    if( !nl )
+        return;
+
+    if( !EZThreads( _Prep, min( gnthr, nl ), 2,
+            "_ScapePrep", flog ) ) {
+
+        exit( 42 );
+    }
+}
+
+
+static void FreePrep( int i )
+{
+    CPrepTile	&P = vprep[i];
+
+    if( P.src )
+        RasterFree( P.src );
+
+    P.nb = 0;
+}
+
+
+/* --------------------------------------------------------------- */
+/* CScapePaint::Paint -------------------------------------------- */
+/* --------------------------------------------------------------- */
+
+// Paint whole scape scp in memory, conditioning tiles in batches.
+//
+void CScapePaint::Paint( int nthr ) const
+{
+    int	nt = vT.size(),	// tiles total
+        nb;				// tiles per batch
+
+    GP		= this;
+    gnthr	= max( 1, nthr );
+    nb		= gnthr * BATCH_PER_THR;
+    gD		= CDstWin( scp, 0, 0, ws, hs );
+
+    vprep.assign( nt, CPrepTile() );
+
+    for( int i0 = 0; i0 < nt; i0 += nb ) {
+
+        int	nk = min( nb, nt - i0 );
+
+        vload.resize( nk );
+
+        for( int k = 0; k < nk; ++k )
+            vload[k] = i0 + k;
+
+        PrepTiles( flog );
+        PaintWin( vload, flog );
+
+        for( int k = 0; k < nk; ++k )
+            FreePrep( vload[k] );
+    }
+
+    vprep.clear();
+    vload.clear();
+    vband.clear();
+}
+
+/* --------------------------------------------------------------- */
+/* CScapePaint::PaintTiled --------------------------------------- */
+/* --------------------------------------------------------------- */
+
+// Render scape as tile x tile output tiles, in row-major order,
+// writing each to W as it completes.
+//
+// Each output tile needs only the source tiles whose scan limits
+// reach it. Conditioned source tiles are cached, and the least
+// recently used are freed once cache bytes would exceed cachebytes.
+// Tiles needed by the current output tile are never evicted, so
+// the budget is exceeded only if one output tile needs more.
+//
+// Return false if a tile write fails.
+//
+bool CScapePaint::PaintTiled(
+    Tif8TileWriter	&W,
+    int				tile,
+    long			cachebytes,
+    int				nthr ) const
+{
+    int		nt		= vT.size(),
+            ntx		= (ws + tile - 1) / tile,
+            nty		= (hs + tile - 1) / tile,
+            nover	= 0;
+    bool	ok		= true;
+    long	cached	= 0,
+            stamp	= 0,
+            nbest	= (long)wi * hi;	// bytes per loaded tile
+    uint8	*buf	= (uint8*)RasterAlloc( tile * tile );
+
+    if( !buf ) {
+        fprintf( flog, "Scape: Alloc failed (%d x %d).\n", tile, tile );
+        exit( 42 );
+    }
+
+    GP		= this;
+    gnthr	= max( 1, nthr );
+
+// Nominal scan limits for indexing, before any loading
+
+    vprep.assign( nt, CPrepTile() );
+
+    for( int i = 0; i < nt; ++i ) {
+
+        CPrepTile	&P = vprep[i];
+
+        ScanLims( P.x0, P.xL, P.y0, P.yL,
+            ws, hs, vT[i], wi, hi );
+    }
+
+// Render output tiles
+
+    for( int ty = 0; ok && ty < nty; ++ty ) {
+
+        for( int tx = 0; ok && tx < ntx; ++tx ) {
+
+            vector<int>	vi;
+
+            gD = CDstWin( buf, tx * tile, ty * tile, tile, tile );
+
+            memset( buf, bkval, tile * tile );
+
+            // needed tiles; which must be loaded
+
+            vload.clear();
+
+            for( int i = 0; i < nt; ++i ) {
+
+                CPrepTile	&P = vprep[i];
+
+                if( P.y0 < gD.y0 + gD.h && P.yL > gD.y0 &&
+                    P.x0 < gD.x0 + gD.w && P.xL > gD.x0 ) {
+
+                    vi.push_back( i );
+                    P.used = ++stamp;
+
+                    if( !P.src )
+                        vload.push_back( i );
+                }
+            }
+
+            // evict LRU tiles not needed here
+
+            long	need = cached + vload.size() * nbest;
+
+            while( need > cachebytes ) {
+
+                int		iold = -1;
+                long	told = stamp - vi.size() + 1;
+
+                for( int i = 0; i < nt; ++i ) {
+
+                    const CPrepTile	&P = vprep[i];
+
+                    if( P.src && P.used < told ) {
+                        iold = i;
+                        told = P.used;
+                    }
+                }
+
+                if( iold < 0 ) {
+
+                    if( !nover++ ) {
+                        fprintf( flog, "Scape: Cache budget %ld MB"
+                        " too small for one output tile.\n",
+                        cachebytes >> 20 );
+                    }
+
+                    break;
+                }
+
+                need	-= vprep[iold].nb;
+                cached	-= vprep[iold].nb;
+                FreePrep( iold );
+            }
+
+            // load, paint, write
+
+            PrepTiles( flog );
+
+            for( int k = 0, nl = vload.size(); k < nl; ++k )
+                cached += vprep[vload[k]].nb;
+
+            if( vi.size() )
+                PaintWin( vi, flog );
+
+            if( !(ok = W.Write( tx, ty, buf )) ) {
+                fprintf( flog, "Scape: Tile write failed (%d, %d).\n",
+                tx, ty );
+            }
+        }
+    }
+
+    for( int i = 0; i < nt; ++i )
+        FreePrep( i );
+
+    vprep.clear();
+    vload.clear();
+    vband.clear();
+
+    RasterFree( buf );
+
+    return ok;
+}
+
+
+
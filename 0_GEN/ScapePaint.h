@@ -0,0 +1,80 @@
+
+
+#pragma once
+
+
+#include	"GenDefs.h"
+#include	"TAffine.h"
+
+#include	<stdio.h>
+
+#include	<string>
+#include	<vector>
+using namespace std;
+
+
+/* --------------------------------------------------------------- */
+/* Types --------------------------------------------------------- */
+/* --------------------------------------------------------------- */
+
+class Tif8TileWriter;
+
+// Band-partitioned scape painter shared by Scape() and the
+// CTileSet scape calls. Tile i is image vname[i], placed in the
+// scape by vT[i] (tile -> scape pixels). Tiles are painted in
+// list order, so where they overlap the last tile wins.
+//
+// Paint() fills scp, the whole ws x hs scape, in memory.
+// PaintTiled() needs no scp; it renders tile x tile output
+// tiles to W, caching conditioned source tiles up to cachebytes.
+//
+// Note: One painter at a time per process (shared statics).
+//
+class CScapePaint {
+
+public:
+    uint8					*scp;
+    uint32					ws,
+                            hs;
+    const vector<string>	&vname;
+    const vector<TAffine>	&vT;
+    int						wi,		// nominal tile dims
+                            hi,
+                            iscl,
+                            bkval,
+                            lgord,
+                            sdnorm;
+    bool					resmask;
+    FILE					*flog;
+
+public:
+    CScapePaint(
+        uint8					*scp,
+        uint32					ws,
+        uint32					hs,
+        const vector<string>	&vname,
+        const vector<TAffine>	&vT,
+        int						wi,
+        int						hi,
+        int						iscl,
+        int						bkval,
+        int						lgord,
+        int						sdnorm,
+        bool					resmask,
+        FILE					*flog )
+    : scp(scp), ws(ws), hs(hs),
+    vname(vname), vT(vT), wi(wi), hi(hi),
+    iscl(iscl), bkval(bkval),
+    lgord(lgord), sdnorm(sdnorm), resmask(resmask), flog(flog)
+    {};
+
+    void Paint( int nthr ) const;
+
+    bool PaintTiled(
+        Tif8TileWriter	&W,
+        int				tile,
+        long			cachebytes,
+        int				nthr ) const;
+};
+
+
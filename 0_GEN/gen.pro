@@ -20,6 +20,7 @@ HEADERS += \
     $$PWD/CThmScan.h \
     $$PWD/CTileSet.h \
     $$PWD/Debug.h \
+    $$PWD/DenseImg.h \
     $$PWD/Disk.h \
     $$PWD/Draw.h \
     $$PWD/EZThreads.h \
@@ -28,6 +29,7 @@ HEADERS += \
     $$PWD/GenDefs.h \
     $$PWD/Geometry.h \
     $$PWD/ImageIO.h \
+    $$PWD/ImgPrefetch.h \
     $$PWD/Inspect.h \
     $$PWD/LinEqu.h \
     $$PWD/Maths.h \
@@ -59,6 +61,7 @@ SOURCES += \
     $$PWD/CTileSet.cpp \
     $$PWD/CTileSet_Scape.cpp \
     $$PWD/Debug.cpp \
+    $$PWD/DenseImg.cpp \
     $$PWD/Disk.cpp \
     $$PWD/Draw.cpp \
     $$PWD/EZThreads.cpp \
@@ -66,6 +69,7 @@ SOURCES += \
     $$PWD/FoldMask.cpp \
     $$PWD/Geometry.cpp \
     $$PWD/ImageIO.cpp \
+    $$PWD/ImgPrefetch.cpp \
     $$PWD/Inspect.cpp \
     $$PWD/LinEqu.cpp \
     $$PWD/Maths.cpp \
@@ -68,7 +68,7 @@ class CSuperscape {
 public:
     vector<int>	vID;
     DBox	bb;			// oriented bounding box
-    Point	Opts;		// origin of aligned point list
+    Point	Opts;		// origin of aligned dense image
     double	x0, y0;		// scape corner in oriented system
     uint8	*ras;		// scape pixels
     uint32	ws, hs;		// scape dims
@@ -102,7 +102,7 @@ public:
     void DrawRas();
     bool Load( FILE* flog );
 
-    bool MakePoints( vector<double> &v, vector<Point> &p );
+    bool MakeDense( DenseImg &I );
     void WriteMeta();
 };
 
@@ -413,51 +413,74 @@ bool CSuperscape::Load( FILE* flog )
 }
 
 /* --------------------------------------------------------------- */
-/* MakePoints ---------------------------------------------------- */
+/* MakeDense ----------------------------------------------------- */
 /* --------------------------------------------------------------- */
 
-bool CSuperscape::MakePoints( vector<double> &v, vector<Point> &p )
+// Crop scape to bbox of its non-zero pixels, which become the
+// valid pixels of I. I has origin (0,0) and Opts is the crop
+// corner in scape coords.
+//
+bool CSuperscape::MakeDense( DenseImg &I )
 {
-// collect point and value lists
+// get bbox of non-zero pixels
+
+    int	xlo = ws, xhi = -1, ylo = hs, yhi = -1, ok = true;
+
+    I.clear();
+
+    for( int iy = 0; iy < hs; ++iy ) {
+
+        const uint8	*row = &ras[ws*iy];
 
-    int	np = ws * hs, ok = true;
+        for( int ix = 0; ix < ws; ++ix ) {
 
-    v.clear();
-    p.clear();
+            if( row[ix] ) {
 
-    for( int i = 0; i < np; ++i ) {
+                if( ix < xlo )
+                    xlo = ix;
 
-        if( ras[i] ) {
+                if( ix > xhi )
+                    xhi = ix;
 
-            int	iy = i / ws,
-                ix = i - ws * iy;
+                if( iy < ylo )
+                    ylo = iy;
 
-            v.push_back( ras[i] );
-            p.push_back( Point( ix, iy ) );
+                yhi = iy;
+            }
         }
     }
 
-    if( !(np = p.size()) ) {
+    if( xhi < 0 ) {
         ok = false;
         goto exit;
     }
 
-// get points origin and translate to zero
+    Opts = Point( xlo, ylo );
+
+// copy cropped pixels and mask
+
+    I.w	= xhi - xlo + 1;
+    I.h	= yhi - ylo + 1;
+
+    I.v.resize( I.w * I.h );
+    I.m.resize( I.w * I.h );
 
-    DBox	ptsbb;
+    for( int iy = 0; iy < I.h; ++iy ) {
 
-    BBoxFromPoints( ptsbb, p );
-    Opts = Point( ptsbb.L, ptsbb.B );
+        const uint8	*row = &ras[xlo + ws*(ylo + iy)];
 
-    for( int i = 0; i < np; ++i ) {
+        for( int ix = 0; ix < I.w; ++ix ) {
 
-        p[i].x -= Opts.x;
-        p[i].y -= Opts.y;
+            int	i = ix + I.w*iy;
+
+            I.v[i] = row[ix];
+            I.m[i] = (row[ix] != 0);
+        }
     }
 
 // normalize values
 
-    if( !Normalize( v ) )
+    if( !I.Normalize() )
         ok = false;
 
 exit:
@@ -490,17 +513,29 @@ static void FindPairs(
     const CSuperscape		&A,
     const CSuperscape		&B )
 {
-    int		iz = vZ.size() - 1;
-    TAffine	Tm = vZ[iz].T;
+    int				iz = vZ.size() - 1;
+    TAffine			Tm = vZ[iz].T;
+    vector<Point>	cnr;
+    vector<int>		vb;
+
+    TS.IndexLayer( B.is0, B.isN );
+    Set4Corners( cnr, gW, gH );
 
     for( int ia = 0; ia < gDat.ntil; ++ia ) {
 
         int				aid = A.vID[ia];
         vector<Pair>	&p  = P[ia];
         TAffine			Ta  = Tm * TS.vtil[aid].T;
+        vector<Point>	c   = cnr;
+
+        Ta.Transform( c );
+        TS.TilesOverlapping( vb, c, tsOlapPad );
 
-        for( int bid = B.is0; bid < B.isN; ++bid ) {
+        int	nb = vb.size();
+
+        for( int ib = 0; ib < nb; ++ib ) {
 
+            int		bid = vb[ib];
             TAffine	Tab;
             Tab.FromAToB( Ta, TS.vtil[bid].T );
 
@@ -550,7 +585,7 @@ static bool ThisBZ(
 
     B.DrawRas();
 
-    if( !B.MakePoints( thm.bv, thm.bp ) ) {
+    if( !B.MakeDense( thm.b ) ) {
         fprintf( flog, "No B points for z=%d.\n", TS.vtil[B.is0].z );
         return false;
     }
@@ -575,6 +610,7 @@ static bool ThisBZ(
     S.SetSweepPretweak( true );
     S.SetSweepNThreads( scr.blockslots );
     S.SetUseCorrR( true );
+    S.SetSweepFMCand( scr.blocksweepfm );
     S.SetDisc( Ox, Oy, Rx, Ry );
 
     if( gArgs.abdbg ) {
@@ -1014,7 +1050,7 @@ static void LayerLoop()
     A.CalcBBox();
     A.MakeRasA();
     A.DrawRas();
-    A.MakePoints( thm.av, thm.ap );
+    A.MakeDense( thm.a );
     A.WriteMeta();
     t0 = StopTiming( flog, "MakeRasA", t0 );
 
@@ -6,6 +6,7 @@
 #include	"janelia.h"
 #include	"File.h"
 #include	"CAffineLens.h"
+#include	"Correlation.h"
 #include	"Debug.h"
 
 
@@ -79,11 +80,13 @@ static void PrintUsage()
     "      -Tmsh=<six comma-separated values>\n"
     "      -XYexp=<two comma-separated values>\n"
     "      -json\n"
+    "      -shards\n"
     "      -v\n"
     "      -comp_png=<path to comp.png>\n"
     "      -registered_png=<path to registered.png>\n"
     "      -heatmap\n"
     "      -dbgcor\n"
+    "      -corrf\n"
     "\n"
     );
 }
@@ -113,6 +116,7 @@ CGBL_dmesh::CGBL_dmesh()
     arg.WithinSection	= false;
     arg.SingleFold		= false;
     arg.JSON			= false;
+    arg.Shards			= false;
     arg.Verbose			= false;
     arg.Heatmap			= false;
 
@@ -216,12 +220,16 @@ bool CGBL_dmesh::SetCmdLine( int argc, char* argv[] )
             arg.SingleFold = true;
         else if( IsArg( "-json", argv[i] ) )
             arg.JSON = true;
+        else if( IsArg( "-shards", argv[i] ) )
+            arg.Shards = true;
         else if( IsArg( "-v", argv[i] ) )
             arg.Verbose = true;
         else if( IsArg( "-heatmap", argv[i] ) )
             arg.Heatmap = true;
         else if( IsArg( "-dbgcor", argv[i] ) )
             dbgCor = true;
+        else if( IsArg( "-corrf", argv[i] ) )
+            corrFloat = true;
         else if( GetArgList( vD, "-Tmsh=", argv[i] ) ) {
 
             if( 6 == vD.size() )
@@ -44,6 +44,7 @@ public:
                     WithinSection,		// overlap within a section
                     SingleFold,			// assign id=1 to all non-fold rgns
                     JSON,				// output JSON format
+                    Shards,				// write binary pts shard
                     Verbose,			// run inspect diagnostics
                     Heatmap;			// run CorrView
     } DriverArgs;
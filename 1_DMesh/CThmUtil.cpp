@@ -472,10 +472,8 @@ bool CThmUtil::MakeThumbs(
     const OlapRec	&olp,
     int				decfactor )
 {
-    thm.av		= olp.a.v;
-    thm.bv		= olp.b.v;
-    thm.ap		= olp.a.p;
-    thm.bp		= olp.b.p;
+    thm.a.FromPoints( olp.a.p, olp.a.v );
+    thm.b.FromPoints( olp.b.p, olp.b.v );
     thm.ftc.clear();
     thm.reqArea	= OLAP2D;
     thm.olap1D	= OLAP1D;
@@ -483,27 +481,29 @@ bool CThmUtil::MakeThumbs(
 
     if( decfactor > 1 ) {
 
-        DecimateVector( thm.ap, thm.av, olp.a.w, olp.a.h, decfactor );
-        DecimateVector( thm.bp, thm.bv, olp.b.w, olp.b.h, decfactor );
+        thm.a.Decimate( decfactor );
+        thm.b.Decimate( decfactor );
 
         thm.reqArea	/= decfactor * decfactor;
         thm.olap1D  /= decfactor;
 
         fprintf( flog,
-        "Thumbs: After decimation %ld pts, reqArea %ld, thmscl %d\n",
-        thm.ap.size(), thm.reqArea, thm.scl );
+        "Thumbs: After decimation %d pts, reqArea %ld, thmscl %d\n",
+        thm.a.NValid(), thm.reqArea, thm.scl );
     }
 
-    if( thm.ap.size() < thm.reqArea ) {
+    int	na = thm.a.NValid();
+
+    if( na < thm.reqArea ) {
 
         fprintf( flog,
-        "FAIL: Thumbs: Small intersection %ld (required %ld).\n",
-         thm.ap.size(), thm.reqArea );
+        "FAIL: Thumbs: Small intersection %d (required %ld).\n",
+         na, thm.reqArea );
 
         return false;
     }
 
-    if( !Normalize( thm.av ) ) {
+    if( !thm.a.Normalize() ) {
 
         fprintf( flog,
         "FAIL: Thumbs: Image A intersection region: stdev = 0.\n" );
@@ -511,7 +511,7 @@ bool CThmUtil::MakeThumbs(
         return false;
     }
 
-    if( !Normalize( thm.bv ) ) {
+    if( !thm.b.Normalize() ) {
 
         fprintf( flog,
         "FAIL: Thumbs: Image B intersection region: stdev = 0.\n" );
@@ -9,8 +9,10 @@
 #include	"Inspect.h"
 #include	"LinEqu.h"
 
+#include	<fcntl.h>
 #include	<stdlib.h>
 #include	<string.h>
+#include	<unistd.h>
 
 
 /* --------------------------------------------------------------- */
@@ -67,6 +69,7 @@ public:
         int						hf,
         FILE					*flog );
     void WriteAs_CPOINT2();
+    void WriteAs_Shard();
     void WriteAs_JSON();
     static void WriteEmpty_JSON();
 private:
@@ -89,6 +92,16 @@ private:
         FILE			*flog );
 };
 
+/* --------------------------------------------------------------- */
+/* Statics ------------------------------------------------------- */
+/* --------------------------------------------------------------- */
+
+// NoCR result shared by all region pairs of one image pair.
+// States are {0=never called, 1=failed, 2=success}.
+
+static vector<TAffine>	nocrT;
+static int				nocrState = 0;
+
 /* --------------------------------------------------------------- */
 /* Class Matches ------------------------------------------------- */
 /* --------------------------------------------------------------- */
@@ -270,6 +283,11 @@ void Matches::WriteAs_CPOINT2()
     if( !np )
         return;
 
+    if( GBL.arg.Shards ) {
+        WriteAs_Shard();
+        return;
+    }
+
     const char	*sud;
     CMutex		M;
 
@@ -294,6 +312,49 @@ void Matches::WriteAs_CPOINT2()
 }
 
 
+// Append this pair's matches as PtsRec to our own binary shard
+// (see NamePtsShard), rather than taking a host-local named
+// semaphore to append text to the block's shared pts file.
+// The shard is ours alone, so no lock is needed.
+//
+void Matches::WriteAs_Shard()
+{
+    int				np = vM.size();
+    vector<PtsRec>	vr( np );
+
+    for( int i = 0; i < np; ++i ) {
+
+        const Match	&m = vM[i];
+        PtsRec		&R = vr[i];
+
+        R.z1	= GBL.A.z;
+        R.id1	= GBL.A.id;
+        R.r1	= m.ra;
+        R.x1	= m.pa.x;
+        R.y1	= m.pa.y;
+
+        R.z2	= GBL.B.z;
+        R.id2	= GBL.B.id;
+        R.r2	= m.rb;
+        R.x2	= m.pb.x;
+        R.y2	= m.pb.y;
+    }
+
+    char	name[2048];
+    int		fd = open( NamePtsShard( name, GBL.A.z, GBL.B.z ),
+                O_WRONLY | O_CREAT | O_APPEND, 0666 );
+    long	bytes = np * sizeof(PtsRec);
+
+    if( fd < 0 || bytes != write( fd, &vr[0], bytes ) ) {
+        fprintf( stderr,
+        "WriteAs_Shard: Can't write [%s].\n", name );
+        exit( 42 );
+    }
+
+    close( fd );
+}
+
+
 // Pattern:
 //
 // {
@@ -707,27 +768,23 @@ static bool RoughMatch(
         && !GBL.mch.PXRESMSK
         && !CM.IsFile( GBL.idb ) ) {
 
-        // Call NoCR at most once. Possible states
-        // are {0=never called, 1=failed, 2=success}.
-
-        static vector<TAffine>	T;
-        static int				state = 0;
+        // Call NoCR at most once per image pair.
 
         int	calledthistime = false;
 
-        if( !state ) {
-            state = 1 + ApproximateMatch_NoCR( T, px, flog );
+        if( !nocrState ) {
+            nocrState = 1 + ApproximateMatch_NoCR( nocrT, px, flog );
             calledthistime = true;
         }
 
-        if( state == 2 ) {
+        if( nocrState == 2 ) {
 
             if( !calledthistime ) {
                 fprintf( flog, "\n---- Thumbnail matching ----\n" );
-                T[0].TPrint( flog, "Reuse Approx: Best transform " );
+                nocrT[0].TPrint( flog, "Reuse Approx: Best transform " );
             }
 
-            guesses.push_back( T[0] );
+            guesses.push_back( nocrT[0] );
             return true;
         }
 
@@ -794,6 +851,9 @@ void PipelineDeformableMap(
     Ntrans		= 0;
     tr_array	= NULL;
 
+    nocrT.clear();
+    nocrState	= 0;
+
     memset( map_mask, 0, wf * hf * sizeof(uint16) );
 
 /* --------------------------------- */
@@ -5,14 +5,27 @@
 #include	"dmesh.h"
 #include	"InSectionOverlap.h"
 
+#include	"Cmdline.h"
+#include	"File.h"
 #include	"ImageIO.h"
 #include	"Inspect.h"
 #include	"Timer.h"
 #include	"Memory.h"
+#include	"Debug.h"
 
+#include	<fcntl.h>
 #include	<stdlib.h>
+#include	<string.h>
+#include	<unistd.h>
+#include	<sys/stat.h>
 
 
+/* --------------------------------------------------------------- */
+/* Macros -------------------------------------------------------- */
+/* --------------------------------------------------------------- */
+
+#define	BATCH_CACHEMB	1024
+
 /* --------------------------------------------------------------- */
 /* Types --------------------------------------------------------- */
 /* --------------------------------------------------------------- */
@@ -224,10 +237,13 @@ static void ReportAveTAffine( int Ntrans, const TAffine* tfs )
 }
 
 /* --------------------------------------------------------------- */
-/* main ---------------------------------------------------------- */
+/* MatchPair ----------------------------------------------------- */
 /* --------------------------------------------------------------- */
 
-int main( int argc, char* argv[] )
+// Align one image pair za.ia^zb.ib as described by command
+// line (argv). Returns process exit code.
+//
+static int MatchPair( int argc, char* argv[] )
 {
     clock_t	t0 = StartTiming();
 
@@ -338,4 +354,260 @@ exit:
     return 0;
 }
 
+/* --------------------------------------------------------------- */
+/* Redirect ------------------------------------------------------ */
+/* --------------------------------------------------------------- */
+
+// Point descriptor fd at file (name), or back at (fd0) if name
+// is NULL. Stdio buffers are flushed first.
+//
+static void Redirect( int fd, const char *name, int flags, int fd0 )
+{
+    fflush( stdout );
+    fflush( stderr );
+
+    if( name ) {
+
+        int	f = open( name, O_WRONLY | O_CREAT | flags, 0666 );
+
+        if( f >= 0 ) {
+            dup2( f, fd );
+            close( f );
+            return;
+        }
+    }
+
+    dup2( fd0, fd );
+}
+
+/* --------------------------------------------------------------- */
+/* AppendTmp ----------------------------------------------------- */
+/* --------------------------------------------------------------- */
+
+// Append whole content of file (tmp) to file (name) in one write,
+// so a completed pair's points land in the shared pts file intact.
+//
+static bool AppendTmp( const char *name, const char *tmp )
+{
+    struct stat	st;
+    bool		ok = true;
+
+    if( stat( tmp, &st ) || !st.st_size )
+        return true;
+
+    vector<char>	buf( st.st_size );
+    int				fi = open( tmp, O_RDONLY );
+
+    if( fi < 0 || read( fi, &buf[0], st.st_size ) != st.st_size )
+        ok = false;
+
+    if( fi >= 0 )
+        close( fi );
+
+    if( ok ) {
+
+        int	fo = open( name, O_WRONLY | O_CREAT | O_APPEND, 0666 );
+
+        if( fo < 0 || write( fo, &buf[0], st.st_size ) != st.st_size )
+            ok = false;
+
+        if( fo >= 0 )
+            close( fo );
+    }
+
+    if( !ok )
+        fprintf( stderr, "Batch: Can't append [%s] to [%s].\n", tmp, name );
+
+    return ok;
+}
+
+/* --------------------------------------------------------------- */
+/* MatchBatch ---------------------------------------------------- */
+/* --------------------------------------------------------------- */
+
+// Run every ptest rule of a job block make file (make.same or
+// make.down) in this one process, so that each tile is loaded,
+// flattened and filtered, and its fold mask built, once, rather
+// than once per neighbor.
+//
+// Rule lines look like:
+//
+//	\tptest >>pts.same 2>pair_0.1^0.2.log 0.1^0.2 [options] ${EXTRA}
+//
+// Each pair's stdout and stderr are redirected as make would, so
+// the pts and log files match those of make runs. Our own options
+// (extra) are substituted for ${EXTRA}.
+//
+// Like make, a rule is skipped if its target (the preceding
+// 'a/z.b.map.tif:' line) already exists, so reruns of a partly
+// done block only do the remaining pairs. A pair's points go to
+// a temp file first and are appended to the shared pts file in
+// one write only if the pair succeeds, so failed or interrupted
+// pairs leave no partial point lists to be duplicated on rerun.
+//
+// Tile and fold mask caches share a budget of cacheMB megabytes.
+//
+// Pairs run sequentially: the pipeline works through process
+// global GBL. Run blocks in parallel (make -j, qsub) as before.
+//
+static int MatchBatch(
+    const char	*path,
+    int			cacheMB,
+    int			nextra,
+    char*		extra[] )
+{
+    FILE	*fmk = FileOpenOrDie( path, "r", stderr );
+
+    fprintf( stderr, "\n---- dmesh batch [%s] ----\n", path );
+
+    clock_t		t0		= StartTiming();
+    CLineScan	LS;
+    int			out0	= dup( STDOUT_FILENO ),
+                err0	= dup( STDERR_FILENO ),
+                npair	= 0,
+                nskip	= 0,
+                nfail	= 0;
+    string		target;
+
+    PixPair::SetCache( cacheMB - cacheMB / 8 );
+    SetFoldMaskCache( cacheMB / 8 );
+
+    while( LS.Get( fmk ) > 0 ) {
+
+        // Note rule target
+
+        if( LS.line[0] != '\t' ) {
+
+            char	*c = strchr( LS.line, ':' );
+
+            if( c && strncmp( LS.line, "all:", 4 ) )
+                target.assign( LS.line, c - LS.line );
+            else
+                target.clear();
+
+            continue;
+        }
+
+        if( !target.empty() && !access( target.c_str(), F_OK ) ) {
+            target.clear();
+            ++nskip;
+            continue;
+        }
+
+        target.clear();
+
+        // Tokenize rule
+
+        vector<char*>	av;
+        const char		*fout = NULL,
+                        *ferr = NULL;
+        char			*s = strtok( LS.line, " \t\n" );
+
+        av.push_back( s );	// exe name
+
+        while( (s = strtok( NULL, " \t\n" )) ) {
+
+            if( !strncmp( s, ">>", 2 ) )
+                fout = s + 2;
+            else if( !strncmp( s, "2>", 2 ) )
+                ferr = s + 2;
+            else if( !strcmp( s, "${EXTRA}" ) ) {
+
+                for( int i = 0; i < nextra; ++i )
+                    av.push_back( extra[i] );
+            }
+            else
+                av.push_back( s );
+        }
+
+        if( av.size() < 2 )
+            continue;
+
+        // Reset per-pair state and run
+
+        char	tmp[2048];
+
+        if( fout )
+            sprintf( tmp, "%s.%d.tmp", fout, getpid() );
+
+        GBL		= CGBL_dmesh();
+        dbgCor	= false;
+
+        Redirect( STDOUT_FILENO, (fout ? tmp : NULL), O_TRUNC, out0 );
+        Redirect( STDERR_FILENO, ferr, O_TRUNC, err0 );
+
+        int	ret = MatchPair( av.size(), &av[0] );
+
+        Redirect( STDOUT_FILENO, NULL, 0, out0 );
+        Redirect( STDERR_FILENO, NULL, 0, err0 );
+
+        if( fout ) {
+
+            if( !ret && !AppendTmp( fout, tmp ) )
+                ret = 42;
+
+            remove( tmp );
+        }
+
+        ++npair;
+
+        if( ret ) {
+            fprintf( stderr, "Batch: Pair failed [%s].\n", av[1] );
+            ++nfail;
+        }
+    }
+
+    PixPair::SetCache( 0 );
+    SetFoldMaskCache( 0 );
+
+    close( out0 );
+    close( err0 );
+    fclose( fmk );
+
+    fprintf( stderr, "Batch: Ran %d pairs, %d failed, %d done before.\n",
+        npair, nfail, nskip );
+    StopTiming( stderr, "Batch", t0 );
+
+    return (nfail ? 42 : 0);
+}
+
+/* --------------------------------------------------------------- */
+/* main ---------------------------------------------------------- */
+/* --------------------------------------------------------------- */
+
+// Usage:
+//
+//	ptest za.ia^zb.ib [options]
+//
+// or, to run a whole job block in one process:
+//
+//	ptest -batch=make.same [-cacheMB=i] [options for all pairs]
+//
+// Batch cache budget defaults to env BatchCacheMB, else 1024.
+//
+int main( int argc, char* argv[] )
+{
+    const char	*batch	= NULL;
+    int			cacheMB	= 0;
+
+    if( argc > 1 && GetArgStr( batch, "-batch=", argv[1] ) ) {
+
+        int	iextra = 2;
+
+        if( argc > 2 && GetArg( &cacheMB, "-cacheMB=%d", argv[2] ) )
+            iextra = 3;
 
+        if( cacheMB <= 0 ) {
+
+            const char	*s = getenv( "BatchCacheMB" );
+
+            if( !s || (cacheMB = atoi( s )) <= 0 )
+                cacheMB = BATCH_CACHEMB;
+        }
+
+        return MatchBatch( batch, cacheMB,
+                argc - iextra, argv + iextra );
+    }
+
+    return MatchPair( argc, argv );
+}
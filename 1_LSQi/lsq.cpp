@@ -18,6 +18,7 @@
 #include	"Maths.h"
 #include	"Memory.h"
 
+#include	<dirent.h>
 #include	<string.h>
 
 
@@ -29,7 +30,8 @@ class CArgs {
 
 public:
     double		Wr,				// Aff -> (1-Wr)*Aff + Wr*Rgd
-                Etol;			// point error tolerance
+                Etol,			// point error tolerance
+                Dtol;			// converged if tforms move less
     char		tempdir[2048],	// master workspace
                 cachedir[2048];	// {catalog, pnts} files
     const char	*prior,			// start from these solutions
@@ -45,6 +47,7 @@ public:
                 maxthreads;		// maximum threads per node
     bool		catclr,			// remake point catalog
                 untwist,		// iff prior are affines
+                gs,				// Gauss-Seidel (colored) updates
                 local;			// run locally (no qsub) if 1 worker
 
 public:
@@ -52,6 +55,7 @@ public:
     {
         Wr			= 0.001;
         Etol		= 30;
+        Dtol		= 0;
         tempdir[0]	= 0;
         cachedir[0]	= 0;
         prior		= NULL;
@@ -67,6 +71,7 @@ public:
         maxthreads	= 1;
         catclr		= false;
         untwist		= false;
+        gs			= false;
         local		= false;
     };
 
@@ -159,6 +164,8 @@ void CArgs::SetCmdLine( int argc, char* argv[] )
         }
         else if( GetArg( &Etol, "-Etol=%lf", argv[i] ) )
             printf( "Error  tol: %g\n", Etol );
+        else if( GetArg( &Dtol, "-dtol=%lf", argv[i] ) )
+            printf( "Delta  tol: %g\n", Dtol );
         else if( GetArg( &iters, "-iters=%d", argv[i] ) )
             printf( "Iterations: %d\n", iters );
         else if( GetArg( &splitmin, "-splitmin=%d", argv[i] ) )
@@ -171,6 +178,8 @@ void CArgs::SetCmdLine( int argc, char* argv[] )
             catclr = true;
         else if( IsArg( "-untwist", argv[i] ) )
             untwist = true;
+        else if( IsArg( "-gs", argv[i] ) )
+            gs = true;
         else if( IsArg( "-local", argv[i] ) )
             local = true;
         else {
@@ -284,6 +293,162 @@ static void ZoFromZi(
     zohi = zihi;
 }
 
+/* --------------------------------------------------------------- */
+/* LayerCost ----------------------------------------------------- */
+/* --------------------------------------------------------------- */
+
+// Return byte count of job block dir's points: text pts.{sd}
+// plus any binary shards pts.{sd}.*.bin (ptest -shards).
+//
+// A binary record is somewhat smaller than its text line, but
+// the two are close enough to share one cost scale.
+//
+static double BlockBytes( const char *dir, const char *sd )
+{
+    char	buf[2048];
+    double	bytes;
+
+    sprintf( buf, "%s/pts.%s", dir, sd );
+    bytes = DskBytes( buf );
+
+    DIR	*D = opendir( dir );
+
+    if( !D )
+        return bytes;
+
+    char	pfx[32];
+    int		npfx = sprintf( pfx, "pts.%s.", sd );
+
+    for( struct dirent *e; (e = readdir( D )); ) {
+
+        int	len = strlen( e->d_name );
+
+        if( len > npfx + 4 &&
+            !strncmp( e->d_name, pfx, npfx ) &&
+            !strcmp( e->d_name + len - 4, ".bin" ) ) {
+
+            sprintf( buf, "%s/%s", dir, e->d_name );
+            bytes += DskBytes( buf );
+        }
+    }
+
+    closedir( D );
+
+    return bytes;
+}
+
+// Estimate solve work for layer as the byte count of its points
+// files, which scales with both its point pairs and regions.
+//
+static double LayerCost( const Layer &L, const char *tempdir )
+{
+    char	dir[2048];
+    double	bytes = 0;
+
+    for( int y = 0; y <= L.sy; ++y ) {
+
+        for( int x = 0; x <= L.sx; ++x ) {
+
+            sprintf( dir, "%s/%d/S%d_%d", tempdir, L.z, x, y );
+            bytes += BlockBytes( dir, "same" );
+        }
+    }
+
+    for( int y = 0; y <= L.dy; ++y ) {
+
+        for( int x = 0; x <= L.dx; ++x ) {
+
+            sprintf( dir, "%s/%d/D%d_%d", tempdir, L.z, x, y );
+            bytes += BlockBytes( dir, "down" );
+        }
+    }
+
+    return bytes;
+}
+
+/* --------------------------------------------------------------- */
+/* Imbalance ----------------------------------------------------- */
+/* --------------------------------------------------------------- */
+
+// Print per-worker cost for slabs ending at ihi[iw], and
+// return ratio of max worker cost to mean worker cost.
+//
+static double Imbalance(
+    const vector<double>	&cost,
+    const vector<int>		&ihi,
+    bool					print )
+{
+    int		nwks = ihi.size(), i = 0;
+    double	tot = 0, big = 0;
+
+    for( int iw = 0; iw < nwks; ++iw ) {
+
+        double	C = 0;
+        int		i0 = i;
+
+        for( ; i <= ihi[iw]; ++i )
+            C += cost[i];
+
+        if( print ) {
+            printf( "Worker %3d: layers %5d, cost %10.3f MB\n",
+            iw, ihi[iw] - i0 + 1, C / (1024*1024) );
+        }
+
+        tot += C;
+        big  = max( big, C );
+    }
+
+    return (tot > 0 ? big * nwks / tot : 1.0);
+}
+
+/* --------------------------------------------------------------- */
+/* BalanceSlabs -------------------------------------------------- */
+/* --------------------------------------------------------------- */
+
+// Cut catalog into nwks contiguous slabs of near equal cost,
+// returning the last catalog index of each slab in ihi.
+// Each slab gets at least one and at most zmax layers
+// (requires nwks * zmax >= catalog size).
+//
+static void BalanceSlabs(
+    vector<int>				&ihi,
+    const vector<double>	&cost,
+    int						nwks,
+    int						zmax )
+{
+    int		nL = cost.size(), i0 = 0;
+    double	tot = 0, cum = 0;
+
+    for( int i = 0; i < nL; ++i )
+        tot += cost[i];
+
+    ihi.clear();
+
+    for( int iw = 0; iw < nwks - 1; ++iw ) {
+
+        double	target	= tot * (iw + 1) / nwks;
+        int		imax	= min( nL - (nwks - iw),	// leave 1 per later slab
+                            i0 + zmax - 1 ),	// own cap
+                imin	= nL - 1 - (nwks - 1 - iw) * zmax,	// later caps
+                i		= i0;
+
+        cum += cost[i];
+
+        while( i < imax && (i < imin || cum + cost[i+1] <= target) )
+            cum += cost[++i];
+
+        // take one more if that's closer to target
+
+        if( i < imax && cum + cost[i+1] - target < target - cum )
+            cum += cost[++i];
+
+        ihi.push_back( i );
+        i0 = i + 1;
+    }
+
+    ihi.push_back( nL - 1 );
+}
+
 /* --------------------------------------------------------------- */
 /* LaunchWorkers ------------------------------------------------- */
 /* --------------------------------------------------------------- */
@@ -295,6 +460,7 @@ void CArgs::LaunchWorkers( const vector<Layer> &vL )
 // How many workers?
 
     int	nL		= vL.size(),
+        zcap	= zpernode,	// user's per-node limit
         nwks	= nL / zpernode;
 
     if( nL - nwks * zpernode > 0 )
@@ -330,16 +496,17 @@ void CArgs::LaunchWorkers( const vector<Layer> &vL )
             sprintf( buf,
             "lsqw -nwks=%d -temp=%s"
             " -cache=%s -prior=%s"
-            " -mode=%s -Wr=%c,%g -Etol=%g -iters=%d"
+            " -mode=%s -Wr=%c,%g -Etol=%g -dtol=%g -iters=%d"
             " -splitmin=%d -maxthreads=%d"
             " -zi=%d,%d -zo=%d,%d"
-            "%s",
+            "%s%s",
             nwks, tempdir,
             cachedir, (prior ? prior : ""),
-            mode, regtype, Wr, Etol, iters,
+            mode, regtype, Wr, Etol, Dtol, iters,
             splitmin, maxthreads,
             zilo, zihi, zolo, zohi,
-            (untwist ? " -untwist" : "") );
+            (untwist ? " -untwist" : ""),
+            (gs ? " -gs" : "") );
         }
         else {	// qsub for desired slots
 
@@ -347,37 +514,61 @@ void CArgs::LaunchWorkers( const vector<Layer> &vL )
             "QSUB_1NODE.sht 8 \"lsqw\" \"\" 1 %d"
             " \"lsqw -nwks=%d -temp=%s"
             " -cache=%s -prior=%s"
-            " -mode=%s -Wr=%c,%g -Etol=%g -iters=%d"
+            " -mode=%s -Wr=%c,%g -Etol=%g -dtol=%g -iters=%d"
             " -splitmin=%d -maxthreads=%d"
             " -zi=%d,%d -zo=%d,%d"
-            "%s\"",
+            "%s%s\"",
             maxthreads,
             nwks, tempdir,
             cachedir, (prior ? prior : ""),
-            mode, regtype, Wr, Etol, iters,
+            mode, regtype, Wr, Etol, Dtol, iters,
             splitmin, maxthreads,
             zilo, zihi, zolo, zohi,
-            (untwist ? " -untwist" : "") );
+            (untwist ? " -untwist" : ""),
+            (gs ? " -gs" : "") );
         }
     }
     else {
 
+        // Choose slab boundaries balancing estimated cost
+        // (points data volume) rather than layer count.
+        // Each layer also gets a small fixed cost so empty
+        // layers are not free. No slab exceeds the user's
+        // -zpernode limit.
+
+        vector<double>	cost( nL );
+        vector<int>		ihi, ieq;
+        double			fixed = 4096;
+
+        for( int icat = 0; icat < nL; ++icat )
+            cost[icat] = fixed + LayerCost( vL[icat], tempdir );
+
+        for( int iw = 0; iw < nwks; ++iw )
+            ieq.push_back( min( (iw + 1) * zpernode, nL ) - 1 );
+
+        BalanceSlabs( ihi, cost, nwks, zcap );
+
+        printf( "Predicted imbalance (max/mean): equal-z %.3f,"
+        " balanced %.3f\n",
+        Imbalance( cost, ieq, false ), Imbalance( cost, ihi, true ) );
+
         // Write 'ranges.txt' telling each worker which
         // layers it's responsible for and which it needs.
 
         FILE	*f = FileOpenOrDie( "ranges.txt", "w" );
         int		zilo_icat = 0,
-                zihi_icat = min( zpernode, nL ) - 1;
+                zihi_icat;
 
         for( int iw = 0; iw < nwks; ++iw ) {
 
+            zihi_icat = ihi[iw];
+
             ZoFromZi( zolo, zohi, zilo_icat, zihi_icat, vL );
 
             fprintf( f, "%d zi=%d,%d zo=%d,%d\n",
             iw,  vL[zilo_icat].z,  vL[zihi_icat].z, zolo, zohi );
 
             zilo_icat = zihi_icat + 1;
-            zihi_icat = min( zilo_icat + zpernode, nL ) - 1;
         }
 
         fclose( f );
@@ -395,15 +586,16 @@ void CArgs::LaunchWorkers( const vector<Layer> &vL )
         fprintf( f, "mpirun -perhost 1 -n %d -machinefile hosts.txt"
         " lsqw -nwks=%d -temp=%s"
         " -cache=%s -prior=%s"
-        " -mode=%s -Wr=%c,%g -Etol=%g -iters=%d"
+        " -mode=%s -Wr=%c,%g -Etol=%g -dtol=%g -iters=%d"
         " -splitmin=%d -maxthreads=%d"
-        "%s\n",
+        "%s%s\n",
         nwks,
         nwks, tempdir,
         cachedir, (prior ? prior : ""),
-        mode, regtype, Wr, Etol, iters,
+        mode, regtype, Wr, Etol, Dtol, iters,
         splitmin, maxthreads,
-        (untwist ? " -untwist" : "") );
+        (untwist ? " -untwist" : ""),
+        (gs ? " -gs" : "") );
         fprintf( f, "\n" );
 
         fclose( f );
@@ -106,7 +106,7 @@ static void CalcLayerwiseBoxes( const XArray &X )
     if( nthr > nb )
         nthr = nb;
 
-    if( !EZThreads( _Bounds, nthr, 1, "_Bounds" ) )
+    if( nb > 0 && !thrpool.Run( _Bounds, nthr ) )
         exit( 42 );
 }
 
@@ -206,7 +206,7 @@ static void Apply()
     if( nthr > nb )
         nthr = nb;
 
-    if( !EZThreads( _Apply, nthr, 1, "_Apply" ) )
+    if( nb > 0 && !thrpool.Run( _Apply, nthr ) )
         exit( 42 );
 }
 
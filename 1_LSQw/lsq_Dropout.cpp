@@ -106,7 +106,7 @@ static void ScanEachLayer()
     if( nthr > nd )
         nthr = nd;
 
-    if( !EZThreads( _Scan, nthr, 1, "_ScanEachLayer" ) )
+    if( nd > 0 && !thrpool.Run( _Scan, nthr ) )
         exit( 42 );
 }
 
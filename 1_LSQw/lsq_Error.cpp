@@ -787,18 +787,13 @@ static void CalcLayerwiseError( const XArray &X )
 // Select affine or hmgphy
 
     EZThreadproc	proc;
-    const char		*sproc;
 
-    if( X.NE == 6 ) {
-        proc	= _ErrorA;
-        sproc	= "_ErrorA";
-    }
-    else {
-        proc	= _ErrorH;
-        sproc	= "_ErrorH";
-    }
+    if( X.NE == 6 )
+        proc = _ErrorA;
+    else
+        proc = _ErrorH;
 
-    if( !EZThreads( proc, nthr, 1, sproc ) )
+    if( ns > 0 && !thrpool.Run( proc, nthr ) )
         exit( 42 );
 }
 
@@ -27,7 +27,8 @@ int				zLlo, zLhi,	// LHS neib needs these
 vector<Layer>	vL;
 map<int,int>	mZ;
 vector<Rgns>	vR;
-vector<CorrPnt>	vC;
+CorrPntArr		vC;
+EZThreadPool	thrpool;
 
 /* --------------------------------------------------------------- */
 /* Statics ------------------------------------------------------- */
@@ -7,6 +7,7 @@
 
 #include	"GenDefs.h"
 #include	"CPoint.h"
+#include	"EZThreads.h"
 
 #include	<stdio.h>
 
@@ -88,6 +89,26 @@ public:
     };
 };
 
+class CorrPntArr {
+// Contiguous CorrPnt records, mapped copy-on-write
+// from the binary point stores (see LoadPoints).
+public:
+    CorrPnt	*v;
+    long	n,
+            bytes;
+public:
+    CorrPntArr() : v(NULL), n(0), bytes(0) {};
+
+    inline long size() const
+        {return n;};
+
+    inline CorrPnt& operator[]( long i )
+        {return v[i];};
+
+    inline const CorrPnt& operator[]( long i ) const
+        {return v[i];};
+};
+
 /* --------------------------------------------------------------- */
 /* Globals ------------------------------------------------------- */
 /* --------------------------------------------------------------- */
@@ -102,7 +123,8 @@ extern int				zLlo, zLhi,	// LHS neib needs these
 extern vector<Layer>	vL;
 extern map<int,int>		mZ;
 extern vector<Rgns>		vR;
-extern vector<CorrPnt>	vC;
+extern CorrPntArr		vC;
+extern EZThreadPool		thrpool;	// maxthreads workers
 
 /* --------------------------------------------------------------- */
 /* Functions ----------------------------------------------------- */
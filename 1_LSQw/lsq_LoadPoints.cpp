@@ -6,24 +6,63 @@
 
 #include	"Disk.h"
 #include	"File.h"
+#include	"PipeFiles.h"
 #include	"EZThreads.h"
 #include	"Timer.h"
 
+#include	<dirent.h>
+#include	<fcntl.h>
+#include	<string.h>
+#include	<sys/mman.h>
+#include	<unistd.h>
+
+#include	<algorithm>
+
 
 /* --------------------------------------------------------------- */
 /* Constants ----------------------------------------------------- */
 /* --------------------------------------------------------------- */
 
+// Binary point store
+// ------------------
+// One file 'pnts_z.bin' per layer holds all of that layer's same
+// and down points (those with z1 = z), so it serves any worker
+// whose range includes z, however the layers are partitioned.
+// This is also where the ptest shards of the layer's job blocks
+// are merged, along with any text pts files.
+//
+// Layout: header block, same section, down section. Each section
+// is padded to a multiple of kBlock bytes with dummy records that
+// never map into vR (z = kPadZ). Hence, the sections required by a
+// worker map end to end into one contiguous vC array.
+//
+// Bump kVersion if CorrPnt or this layout changes; stale stores
+// are then rebuilt automatically.
+
+const int	kVersion	= 1;
+const int	kPadZ		= -999;
+const long	kBlock		= 4096;
+
 /* --------------------------------------------------------------- */
 /* Types --------------------------------------------------------- */
 /* --------------------------------------------------------------- */
 
+class PntStoreHdr {
+public:
+    char	magic[8];		// "LSQPNTS"
+    int		version,
+            recsize,		// sizeof(CorrPnt)
+            z,
+            _reserved;
+    long	nsame, ndown,	// padded record counts
+            rsame, rdown;	// real record counts
+};
+
 /* --------------------------------------------------------------- */
 /* Statics ------------------------------------------------------- */
 /* --------------------------------------------------------------- */
 
 static CLoadPoints		*ME;
-static pthread_mutex_t	mutex_fpnts = PTHREAD_MUTEX_INITIALIZER;
 
 
 
@@ -31,155 +70,355 @@ static pthread_mutex_t	mutex_fpnts = PTHREAD_MUTEX_INITIALIZER;
 
 
 /* --------------------------------------------------------------- */
-/* NameBinary ---------------------------------------------------- */
+/* NameStore ----------------------------------------------------- */
 /* --------------------------------------------------------------- */
 
-char* CLoadPoints::NameBinary( char *buf )
+char* CLoadPoints::NameStore( char *buf, int z )
 {
-    sprintf( buf, "%s/pnts_%d_%d_%d.bin",
-        cachedir, wkid, vR[zolo].z, vR[zohi].z );
+    sprintf( buf, "%s/pnts_%d.bin", cachedir, z );
     return buf;
 }
 
 /* --------------------------------------------------------------- */
-/* IsBinary ------------------------------------------------------ */
+/* ReadHdr ------------------------------------------------------- */
 /* --------------------------------------------------------------- */
 
-bool CLoadPoints::IsBinary()
+// Return true if store for layer z exists and is current.
+//
+bool CLoadPoints::ReadHdr( void *hdr, int z )
 {
-    char	buf[2048];
-    return DskExists( NameBinary( buf ) );
+    PntStoreHdr	&H = *(PntStoreHdr*)hdr;
+    char		buf[2048];
+    FILE		*f = fopen( NameStore( buf, z ), "rb" );
+    bool		ok = false;
+
+    if( f ) {
+
+        ok = 1 == fread( &H, sizeof(PntStoreHdr), 1, f )
+            && !strcmp( H.magic, "LSQPNTS" )
+            && H.version == kVersion
+            && H.recsize == sizeof(CorrPnt)
+            && H.z == z
+            && DskBytes( buf ) ==
+                kBlock + (H.nsame + H.ndown) * sizeof(CorrPnt);
+
+        fclose( f );
+    }
+
+    return ok;
 }
 
 /* --------------------------------------------------------------- */
-/* AppendJobs ---------------------------------------------------- */
+/* ReadShards ---------------------------------------------------- */
 /* --------------------------------------------------------------- */
 
-void CLoadPoints::AppendJobs(
-    int			z,
-    int			SorD,
-    int			xhi,
-    int			yhi )
+// Append points from binary shards pts.{same,down}.*.bin in job
+// block dir to vc, taking shards in name order.
+//
+static void ReadShards(
+    vector<CorrPnt>	&vc,
+    const char		*dir,
+    const char		*sd )
 {
-    for( int y = 0; y <= yhi; ++y ) {
-        for( int x = 0; x <= xhi; ++x )
-            vJ.push_back( CJob( z, SorD, x, y ) );
+    DIR	*D = opendir( dir );
+
+    if( !D )
+        return;
+
+    vector<string>	vs;
+    char			pfx[32];
+    int				npfx = sprintf( pfx, "pts.%s.", sd );
+
+    for( struct dirent *e; (e = readdir( D )); ) {
+
+        int	len = strlen( e->d_name );
+
+        if( len > npfx + 4 &&
+            !strncmp( e->d_name, pfx, npfx ) &&
+            !strcmp( e->d_name + len - 4, ".bin" ) ) {
+
+            vs.push_back( e->d_name );
+        }
+    }
+
+    closedir( D );
+
+    sort( vs.begin(), vs.end() );
+
+    int				ns = vs.size();
+    vector<PtsRec>	R( 1024 );	// heap: _Gather runs on small stacks
+
+    for( int is = 0; is < ns; ++is ) {
+
+        char	buf[2048];
+        sprintf( buf, "%s/%s", dir, vs[is].c_str() );
+
+        FILE	*f = fopen( buf, "rb" );
+
+        if( !f )
+            continue;
+
+        CorrPnt	C;
+        int		nr;
+
+        while( (nr = fread( &R[0], sizeof(PtsRec), 1024, f )) > 0 ) {
+
+            for( int i = 0; i < nr; ++i ) {
+
+                C.z1	= R[i].z1;
+                C.i1	= R[i].id1;
+                C.r1	= R[i].r1;
+                C.p1	= Point( R[i].x1, R[i].y1 );
+
+                C.z2	= R[i].z2;
+                C.i2	= R[i].id2;
+                C.r2	= R[i].r2;
+                C.p2	= Point( R[i].x2, R[i].y2 );
+
+                vc.push_back( C );
+            }
+        }
+
+        fclose( f );
     }
 }
 
 /* --------------------------------------------------------------- */
-/* _Gather ------------------------------------------------------- */
+/* ReadBlocks ---------------------------------------------------- */
 /* --------------------------------------------------------------- */
 
-void* _Gather( void* ithr )
+// Append points from all S or D job blocks of layer z to vc:
+// text pts file first, then any binary shards (ptest -shards).
+//
+static void ReadBlocks(
+    vector<CorrPnt>	&vc,
+    const char		*tempdir,
+    int				z,
+    int				SorD,
+    int				xhi,
+    int				yhi )
 {
-    const int		ngrow = 1000;
-    int				nmax = ngrow;
-    vector<CorrPnt>	vc( nmax );
+    const char	*sd = (SorD == 'S' ? "same" : "down");
+    CorrPnt		C;
 
-    for( int j = (long)ithr; j < ME->njob; j += ME->nthr ) {
+    for( int y = 0; y <= yhi; ++y ) {
 
-        CLoadPoints::CJob	&J = ME->vJ[j];
+        for( int x = 0; x <= xhi; ++x ) {
 
-        char	buf[2048];
-        sprintf( buf, "%s/%d/%c%d_%d/pts.%s",
-        ME->tempdir, J.z, J.SorD, J.x, J.y,
-        (J.SorD == 'S' ? "same" : "down") );
+            char	dir[2048], buf[2048];
+            sprintf( dir, "%s/%d/%c%d_%d", tempdir, z, SorD, x, y );
+            sprintf( buf, "%s/pts.%s", dir, sd );
 
-        FILE	*f = fopen( buf, "r" );
+            FILE	*f = fopen( buf, "r" );
 
-        if( f ) {
+            if( f ) {
 
-            int	n = 0;
+                while( C.FromFile( f ) )
+                    vc.push_back( C );
 
-            for(;;) {
+                fclose( f );
+            }
 
-                if( n >= nmax )
-                    vc.resize( nmax += ngrow );
+            ReadShards( vc, dir, sd );
+        }
+    }
+}
 
-                if( vc[n].FromFile( f ) )
-                    ++n;
-                else
-                    break;
-            }
+/* --------------------------------------------------------------- */
+/* PadSection ---------------------------------------------------- */
+/* --------------------------------------------------------------- */
 
-            fclose( f );
+// Pad section starting at vc[n0] to a multiple of kBlock bytes.
+// Return padded record count.
+//
+static long PadSection( vector<CorrPnt> &vc, long n0 )
+{
+    long	a = kBlock, b = sizeof(CorrPnt), unit;
 
-            pthread_mutex_lock( &mutex_fpnts );
-            fwrite( &vc[0], sizeof(CorrPnt), n, ME->fpnts );
-            pthread_mutex_unlock( &mutex_fpnts );
-        }
+    while( b ) {
+        long	t = a % b;
+        a = b;
+        b = t;
     }
 
-    return NULL;
+    unit = kBlock / a;	// records per whole number of blocks
+
+    CorrPnt	C = CorrPnt();	// zeroed, padding too
+
+    C.z1 = kPadZ;
+    C.z2 = kPadZ;
+
+    long	n = vc.size() - n0;
+
+    vc.resize( n0 + (n + unit - 1) / unit * unit, C );
+
+    return vc.size() - n0;
 }
 
 /* --------------------------------------------------------------- */
-/* MakeBinary ---------------------------------------------------- */
+/* _Gather ------------------------------------------------------- */
 /* --------------------------------------------------------------- */
 
-void CLoadPoints::MakeBinary()
+// Convert text points of each listed layer into its store.
+//
+void* _Gather( void* ithr )
 {
-    clock_t	t0 = StartTiming();
+    int	nz = ME->vZ.size();
 
-// Output binary points file
+    for( int j = (long)ithr; j < nz; j += ME->nthr ) {
 
-    char	buf[2048];
-    fpnts = FileOpenOrDie( NameBinary( buf ), "wb" );
+        const Layer&	L = vL[ME->vZ[j]];
+        vector<CorrPnt>	vc;
+        PntStoreHdr		H;
 
-// Create list of input file specs.
-// Load sames only for the inner layers.
-// Load downs for all layers but the lowest.
+        memset( &H, 0, sizeof(PntStoreHdr) );
+        strcpy( H.magic, "LSQPNTS" );
+        H.version	= kVersion;
+        H.recsize	= sizeof(CorrPnt);
+        H.z			= L.z;
+
+        ReadBlocks( vc, ME->tempdir, L.z, 'S', L.sx, L.sy );
+        H.rsame = vc.size();
+        H.nsame = PadSection( vc, 0 );
+
+        ReadBlocks( vc, ME->tempdir, L.z, 'D', L.dx, L.dy );
+        H.rdown = vc.size() - H.nsame;
+        H.ndown = PadSection( vc, H.nsame );
 
-    int	nL = vL.size();
+        // Write under temp name, then publish atomically,
+        // in case other workers are building same layer.
 
-    for( int iL = 0; iL < nL; ++iL ) {
+        char	name[2048], tmp[2048];
 
-        const Layer&	L	= vL[iL];
-        int				iz	= mZ.find( L.z )->second;
+        ME->NameStore( name, L.z );
+        sprintf( tmp, "%s.tmp%d", name, wkid );
 
-        if( iz >= zilo && iz <= zihi )
-            AppendJobs( L.z, 'S', L.sx, L.sy );
+        FILE	*f = FileOpenOrDie( tmp, "wb" );
+        char	blk[kBlock];
 
-        if( iz )
-            AppendJobs( L.z, 'D', L.dx, L.dy );
+        memset( blk, 0, kBlock );
+        memcpy( blk, &H, sizeof(PntStoreHdr) );
+
+        fwrite( blk, kBlock, 1, f );
+
+        if( vc.size() )
+            fwrite( &vc[0], sizeof(CorrPnt), vc.size(), f );
+
+        fclose( f );
+        rename( tmp, name );
     }
 
-    njob = vJ.size();
+    return NULL;
+}
+
+/* --------------------------------------------------------------- */
+/* MakeStores ---------------------------------------------------- */
+/* --------------------------------------------------------------- */
+
+// One-time conversion of text points for layers in vZ.
+//
+void CLoadPoints::MakeStores()
+{
+    clock_t	t0 = StartTiming();
+
+    int	nz = vZ.size();
+
+    printf( "Building %d layer point stores.\n", nz );
 
 // Create reader threads to scan points
 
     nthr = maxthreads;
 
-    if( nthr > njob )
-        nthr = njob;
+    if( nthr > nz )
+        nthr = nz;
 
-    if( !EZThreads( _Gather, nthr, 1, "_Gather" ) )
+    if( !EZThreads( _Gather, nthr, 4, "_Gather" ) )
         exit( 42 );
 
-    fclose( fpnts );
-    pthread_mutex_destroy( &mutex_fpnts );
-    vJ.clear();
+    vZ.clear();
 
     StopTiming( stdout, "WrBin", t0 );
 }
 
 /* --------------------------------------------------------------- */
-/* LoadBinary ---------------------------------------------------- */
+/* MapStores ----------------------------------------------------- */
 /* --------------------------------------------------------------- */
 
-void CLoadPoints::LoadBinary()
+// Map the required store sections end to end into vC.
+//
+// Mapping is private (copy-on-write): RemapIndices() and the
+// solver may modify vC, but never the stores. If the system
+// page size does not divide kBlock, sections are read instead.
+//
+void CLoadPoints::MapStores()
 {
     clock_t	t0 = StartTiming();
 
-    char	buf[2048];
-    long	n = (long)DskBytes( NameBinary( buf ) ) / sizeof(CorrPnt);
+// Sum section sizes
+
+    int		ns = vS.size();
+    long	n = 0;
+
+    for( int i = 0; i < ns; ++i )
+        n += vS[i].n;
 
-    vC.resize( n );
+    vC.n		= n;
+    vC.bytes	= n * sizeof(CorrPnt);
+
+    if( !n ) {
+        StopTiming( stdout, "RdBin", t0 );
+        return;
+    }
+
+// Reserve contiguous address range
+
+    void	*base = mmap( NULL, vC.bytes, PROT_READ | PROT_WRITE,
+                MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0 );
+
+    if( base == MAP_FAILED ) {
+        printf( "MapStores: Can't reserve %ld bytes.\n", vC.bytes );
+        exit( 42 );
+    }
+
+    vC.v = (CorrPnt*)base;
+
+// Map (or read) each section into place
+
+    bool	canmap = !(kBlock % sysconf( _SC_PAGESIZE ));
+    char	*dst = (char*)base;
+
+    for( int i = 0; i < ns; ++i ) {
+
+        const CSect	&S = vS[i];
+        char		buf[2048];
+        long		len = S.n * sizeof(CorrPnt);
+        int			fd = open( NameStore( buf, S.z ), O_RDONLY );
+
+        if( fd < 0 ) {
+            printf( "MapStores: Can't open [%s].\n", buf );
+            exit( 42 );
+        }
 
-    FILE	*f = FileOpenOrDie( buf, "rb" );
-    fread( &vC[0], sizeof(CorrPnt), n, f );
-    fclose( f );
+        if( canmap ) {
+
+            if( MAP_FAILED == mmap( dst, len, PROT_READ | PROT_WRITE,
+                                MAP_PRIVATE | MAP_FIXED, fd, S.off ) ) {
+
+                printf( "MapStores: Can't map [%s].\n", buf );
+                exit( 42 );
+            }
+        }
+        else if( len != pread( fd, dst, len, S.off ) ) {
+
+            printf( "MapStores: Can't read [%s].\n", buf );
+            exit( 42 );
+        }
+
+        close( fd );
+        dst += len;
+    }
+
+    vS.clear();
 
     StopTiming( stdout, "RdBin", t0 );
 }
@@ -198,16 +437,62 @@ void CLoadPoints::Load( const char *tempdir, const char *cachedir )
     this->tempdir	= tempdir;
     this->cachedir	= cachedir;
 
-    if( !IsBinary() )
-        MakeBinary();
+// Load sames only for the inner layers.
+// Load downs for all layers but the lowest.
+// Build any missing or stale stores first.
+
+    int		nL = vL.size();
+    long	nreal = 0;
+
+    for( int pass = 0; pass < 2; ++pass ) {
+
+        for( int iL = 0; iL < nL; ++iL ) {
+
+            bool	S = (iL >= zilo && iL <= zihi),
+                    D = (iL > 0);
+            PntStoreHdr	H;
+
+            if( !S && !D )
+                continue;
+
+            if( !ReadHdr( &H, vL[iL].z ) ) {
+
+                if( !pass ) {
+                    vZ.push_back( iL );
+                    continue;
+                }
+
+                printf( "Load: Bad point store for layer %d.\n",
+                vL[iL].z );
+                exit( 42 );
+            }
+
+            if( !pass )
+                continue;
+
+            if( S && H.nsame ) {
+                vS.push_back( CSect( H.z, kBlock, H.nsame ) );
+                nreal += H.rsame;
+            }
+
+            if( D && H.ndown ) {
+                vS.push_back( CSect( H.z,
+                    kBlock + H.nsame * sizeof(CorrPnt), H.ndown ) );
+                nreal += H.rdown;
+            }
+        }
+
+        if( !pass && vZ.size() )
+            MakeStores();
+    }
 
-    LoadBinary();
+    MapStores();
 
     RemapIndices();
 
     StopTiming( stdout, "Total", t0 );
 
-    printf( "Loaded %ld point pairs.\n", vC.size() );
+    printf( "Loaded %ld point pairs.\n", nreal );
 }
 
 
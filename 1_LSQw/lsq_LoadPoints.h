@@ -1,5 +1,3 @@
-
-
 #pragma once
 
 
@@ -16,31 +14,26 @@ using namespace std;
 class CLoadPoints {
     friend void* _Gather( void* ithr );
 private:
-    class CJob {
+    class CSect {
     public:
-        int	z, SorD, x, y;
+        int		z;
+        long	off,	// file offset
+                n;		// padded record count
     public:
-        CJob( int z, int SorD, int x, int y )
-        : z(z), SorD(SorD), x(x), y(y) {};
+        CSect( int z, long off, long n )
+        : z(z), off(off), n(n) {};
     };
 private:
     const char		*tempdir;
     const char		*cachedir;
-    FILE			*fpnts;
-    vector<CJob>	vJ;
-    int				njob,
-                    nthr;
+    vector<int>		vZ;		// layers to (re)build
+    vector<CSect>	vS;		// sections to map
+    int				nthr;
 private:
-    char* NameBinary( char *buf );
-    bool IsBinary();
-    void AppendJobs(
-        int			z,
-        int			SorD,
-        int			xhi,
-        int			yhi );
-    void MakeBinary();
-    void LoadBinary();
-    void Remap();
+    char* NameStore( char *buf, int z );
+    bool ReadHdr( void *hdr, int z );
+    void MakeStores();
+    void MapStores();
 public:
     void Load( const char *tempdir, const char *cachedir );
 };
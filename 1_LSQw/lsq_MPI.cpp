@@ -8,6 +8,9 @@
 
 #include	<stdlib.h>
 
+#include	<vector>
+using namespace std;
+
 
 /* --------------------------------------------------------------- */
 /* Globals ------------------------------------------------------- */
@@ -16,6 +19,12 @@
 int	wkid = 0,	// my worker id (main=0)
     nwks = 1;	// total number workers
 
+/* --------------------------------------------------------------- */
+/* Statics ------------------------------------------------------- */
+/* --------------------------------------------------------------- */
+
+static vector<MPI_Request>	vreq;	// posted, not yet waited
+
 
 
 
@@ -142,4 +151,82 @@ bool MPIRecv( void* buf, int bytes, int wsrc, int tag )
     MPI_Recv( buf, bytes, MPI_CHAR, wsrc, tag, MPI_COMM_WORLD, &st );
 }
 
+/* --------------------------------------------------------------- */
+/* MPIPostSend --------------------------------------------------- */
+/* --------------------------------------------------------------- */
+
+// Start non-blocking send; buf must stay untouched until
+// MPIWaitPosted() returns.
+//
+void MPIPostSend( void* buf, int bytes, int wdst, int tag )
+{
+    MPI_Request	rq;
+
+    MPI_Isend( buf, bytes, MPI_CHAR, wdst, tag, MPI_COMM_WORLD, &rq );
+    vreq.push_back( rq );
+}
+
+/* --------------------------------------------------------------- */
+/* MPIPostRecv --------------------------------------------------- */
+/* --------------------------------------------------------------- */
+
+// Start non-blocking receive; buf is not valid until
+// MPIWaitPosted() returns.
+//
+void MPIPostRecv( void* buf, int bytes, int wsrc, int tag )
+{
+    MPI_Request	rq;
+
+    MPI_Irecv( buf, bytes, MPI_CHAR, wsrc, tag, MPI_COMM_WORLD, &rq );
+    vreq.push_back( rq );
+}
+
+/* --------------------------------------------------------------- */
+/* MPIWaitPosted ------------------------------------------------- */
+/* --------------------------------------------------------------- */
+
+// Block until all posted sends and receives are complete.
+//
+bool MPIWaitPosted()
+{
+    int	nr = vreq.size();
+
+    if( !nr )
+        return true;
+
+    int	err = MPI_Waitall( nr, &vreq[0], MPI_STATUSES_IGNORE );
+
+    vreq.clear();
+
+    return err == MPI_SUCCESS;
+}
+
+/* --------------------------------------------------------------- */
+/* MPISumAll ----------------------------------------------------- */
+/* --------------------------------------------------------------- */
+
+// Replace v[0..n) on every worker by its sum over all workers.
+//
+void MPISumAll( double *v, int n )
+{
+    if( nwks > 1 ) {
+        MPI_Allreduce( MPI_IN_PLACE, v, n,
+            MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD );
+    }
+}
+
+/* --------------------------------------------------------------- */
+/* MPIMaxAll ----------------------------------------------------- */
+/* --------------------------------------------------------------- */
+
+// Replace v[0..n) on every worker by its max over all workers.
+//
+void MPIMaxAll( double *v, int n )
+{
+    if( nwks > 1 ) {
+        MPI_Allreduce( MPI_IN_PLACE, v, n,
+            MPI_DOUBLE, MPI_MAX, MPI_COMM_WORLD );
+    }
+}
+
 
@@ -22,4 +22,11 @@ void MPIWaitForOthers();
 bool MPISend( void* buf, int bytes, int wdst, int tag );
 bool MPIRecv( void* buf, int bytes, int wsrc, int tag );
 
+void MPIPostSend( void* buf, int bytes, int wdst, int tag );
+void MPIPostRecv( void* buf, int bytes, int wsrc, int tag );
+bool MPIWaitPosted();
+
+void MPISumAll( double *v, int n );
+void MPIMaxAll( double *v, int n );
+
 
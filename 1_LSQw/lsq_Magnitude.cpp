@@ -457,7 +457,7 @@ static void CalcLayerwiseMags( const XArray &X )
     if( nthr > ns )
         nthr = ns;
 
-    if( !EZThreads( _Mag, nthr, 1, "_Mag" ) )
+    if( ns > 0 && !thrpool.Run( _Mag, nthr ) )
         exit( 42 );
 }
 
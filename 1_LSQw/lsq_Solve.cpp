@@ -2,6 +2,7 @@
 
 #include	"lsq_Solve.h"
 #include	"lsq_Globals.h"
+#include	"lsq_MPI.h"
 
 #include	"EZThreads.h"
 #include	"LinEqu.h"
@@ -60,23 +61,67 @@ public:
 };
 
 class Thrdat {
-// Each thread's edit tracking data
+// Each thread's edit tracking data.
+// Kept across passes to retain capacity.
 public:
     vector<Todo>	vmark,	// update pnt used flags
                     vcutd,	// cut down pts
                     vkill;	// can't rescue
+    double			dmax,	// max sqr rgn delta this pass
+                    dsum;	// sum sqr rgn deltas
+    long			dn;		// rgns measured
+public:
+    void Clear()
+    {
+        vmark.clear();
+        vcutd.clear();
+        vkill.clear();
+    };
+};
+
+class RgnPnts {
+// Solve-time copy of inner rgn point lists in CSR form:
+// rgn k = K(iz,ir) owns entries [beg[k], beg[k]+cnt[k]).
+// Each entry is oriented: {ax,ay} are the rgn's own point,
+// {bx,by} its partner in rgn {bz,bi}. Passes thus stream
+// through these arrays rather than gathering from vC.
+public:
+    vector<long>	beg;
+    vector<int>		cnt,
+                    roff;	// K(iz,0) for inner iz
+    vector<double>	ax, ay,
+                    bx, by;
+    vector<int>		bz, bi,
+                    ic;		// vC index
+    vector<uint8>	use;	// vC[].used mirror by vC index
+public:
+    inline int K( int iz, int ir ) const
+        {return roff[iz] + ir;};
+
+    void Build();
+    void Store();
 };
 
 /* --------------------------------------------------------------- */
 /* Statics ------------------------------------------------------- */
 /* --------------------------------------------------------------- */
 
-static double			Wr, Etol;
+static double			Wr, Etol,
+                        Dtol;		// stop if max delta <= Dtol
 static XArray			*Xs, *Xd;
 static vector<Thrdat>	vthr;
+static RgnPnts			csr;
+static vector<vector<uint8> >	vclr;	// rgn colors for GS mode
+static vector<vector<uint8> >	vhlo;	// 1 if rgn reads halo layers
 static int				regtype,
                         editdelay,
-                        pass, nthr;
+                        pass, nthr,
+                        nclr,		// num colors in vclr
+                        curclr = -1,	// working color or -1 = all
+                        curhlo = -1;	// working vhlo class or -1 = all
+static bool				gsmode,		// user wants colored in-place
+                        gsnow,		// applicable to this Solve
+                        measure;	// _Delta tabulates this pass
 
 
 
@@ -97,8 +142,12 @@ bool Todo::First( int ithr )
 
         for( ; ir < R.nr; ir += nthr ) {
 
-            if( FLAG_ISUSED( R.flag[ir] ) )
+            if( FLAG_ISUSED( R.flag[ir] )
+                && (curclr < 0 || vclr[iz][ir] == curclr)
+                && (curhlo < 0 || vhlo[iz][ir] == curhlo) ) {
+
                 return true;
+            }
         }
 
         ir -= R.nr;
@@ -121,8 +170,12 @@ bool Todo::Next()
 
         for( ; ir < R.nr; ir += nthr ) {
 
-            if( FLAG_ISUSED( R.flag[ir] ) )
+            if( FLAG_ISUSED( R.flag[ir] )
+                && (curclr < 0 || vclr[iz][ir] == curclr)
+                && (curhlo < 0 || vhlo[iz][ir] == curhlo) ) {
+
                 return true;
+            }
         }
 
         ir -= R.nr;
@@ -200,27 +253,193 @@ static bool SortPnts( int a, int b )
     return A.p2.y < B.p2.y;
 }
 
+/* --------------------------------------------------------------- */
+/* RgnPnts::Build ------------------------------------------------ */
+/* --------------------------------------------------------------- */
+
+// Fill entries for my share of the inner rgns.
+//
+static void* _Build( void* ithr )
+{
+    RgnPnts&	P = csr;
+
+    for( int iz = zilo; iz <= zihi; ++iz ) {
+
+        Rgns&	R = vR[iz];
+
+        for( int ir = (long)ithr; ir < R.nr; ir += nthr ) {
+
+            vector<int>&	vp = R.pts[ir];
+            int				np = vp.size();
+            long			j  = P.beg[P.K( iz, ir )];
+
+            // Sort the points so that cummulative rounding
+            // error tends to be same independent of nwks.
+
+            sort( vp.begin(), vp.end(), SortPnts );
+
+            for( int ip = 0; ip < np; ++ip, ++j ) {
+
+                const CorrPnt&	C = vC[vp[ip]];
+
+                // Which of {1,2} is the A-side?
+
+                if( C.z1 == iz && C.i1 == ir ) {
+                    P.ax[j] = C.p1.x;
+                    P.ay[j] = C.p1.y;
+                    P.bx[j] = C.p2.x;
+                    P.by[j] = C.p2.y;
+                    P.bz[j] = C.z2;
+                    P.bi[j] = C.i2;
+                }
+                else {
+                    P.ax[j] = C.p2.x;
+                    P.ay[j] = C.p2.y;
+                    P.bx[j] = C.p1.x;
+                    P.by[j] = C.p1.y;
+                    P.bz[j] = C.z1;
+                    P.bi[j] = C.i1;
+                }
+
+                P.ic[j] = vp[ip];
+            }
+        }
+    }
+
+    return NULL;
+}
+
+
+void RgnPnts::Build()
+{
+    clock_t	t0 = StartTiming();
+
+// Rgn offsets and entry ranges
+
+    int		nk = 0;
+    long	ne = 0;
+
+    roff.assign( vR.size(), 0 );
+
+    for( int iz = zilo; iz <= zihi; ++iz ) {
+        roff[iz] = nk;
+        nk += vR[iz].nr;
+    }
+
+    beg.resize( nk );
+    cnt.resize( nk );
+
+    for( int iz = zilo; iz <= zihi; ++iz ) {
+
+        const Rgns&	R = vR[iz];
+
+        for( int ir = 0; ir < R.nr; ++ir ) {
+
+            int	k = K( iz, ir );
+
+            beg[k] = ne;
+            cnt[k] = R.pts[ir].size();
+            ne    += cnt[k];
+        }
+    }
+
+    ax.resize( ne );
+    ay.resize( ne );
+    bx.resize( ne );
+    by.resize( ne );
+    bz.resize( ne );
+    bi.resize( ne );
+    ic.resize( ne );
+
+// Used mirror
+
+    long	nc = vC.size();
+
+    use.resize( nc );
+
+    for( long i = 0; i < nc; ++i )
+        use[i] = (vC[i].used != 0);
+
+// Entries
+
+    if( !thrpool.Run( _Build, nthr ) )
+        exit( 42 );
+
+    printf( "NEntr: %ld\n", ne );
+
+    StopTiming( stdout, "Pack", t0 );
+}
+
+/* --------------------------------------------------------------- */
+/* RgnPnts::Store ------------------------------------------------ */
+/* --------------------------------------------------------------- */
+
+// Write the (sorted, shortened) lists back to vR and free all.
+//
+void RgnPnts::Store()
+{
+    for( int iz = zilo; iz <= zihi; ++iz ) {
+
+        Rgns&	R = vR[iz];
+
+        for( int ir = 0; ir < R.nr; ++ir ) {
+
+            vector<int>&	vp = R.pts[ir];
+            int				k  = K( iz, ir ),
+                            np = cnt[k];
+
+            vp.resize( np );
+
+            if( np )
+                memcpy( &vp[0], &ic[beg[k]], np * sizeof(int) );
+        }
+    }
+
+    vector<long>().swap( beg );
+    vector<int>().swap( cnt );
+    vector<int>().swap( roff );
+    vector<double>().swap( ax );
+    vector<double>().swap( ay );
+    vector<double>().swap( bx );
+    vector<double>().swap( by );
+    vector<int>().swap( bz );
+    vector<int>().swap( bi );
+    vector<int>().swap( ic );
+    vector<uint8>().swap( use );
+}
+
 /* --------------------------------------------------------------- */
 /* ShortenList --------------------------------------------------- */
 /* --------------------------------------------------------------- */
 
 static void ShortenList( const Todo& Q, int ithr, int minpts )
 {
-    vector<int>		keep;
-    vector<int>&	vp = vR[Q.iz].pts[Q.ir];
-    int				np = vp.size(),
-                    nu;
+    RgnPnts&	P = csr;
+    int			k  = P.K( Q.iz, Q.ir );
+    long		j0 = P.beg[k],
+                jn = j0 + P.cnt[k],
+                jk = j0;
 
-    for( int ip = 0; ip < np; ++ip ) {
+    for( long j = j0; j < jn; ++j ) {
 
-        if( vC[vp[ip]].used )
-            keep.push_back( vp[ip] );
-    }
+        if( !P.use[P.ic[j]] )
+            continue;
 
-    if( (nu = keep.size()) >= minpts ) {
-        vp.resize( nu );
-        memcpy( &vp[0], &keep[0], nu * sizeof(int) );
+        if( jk < j ) {
+            P.ax[jk] = P.ax[j];
+            P.ay[jk] = P.ay[j];
+            P.bx[jk] = P.bx[j];
+            P.by[jk] = P.by[j];
+            P.bz[jk] = P.bz[j];
+            P.bi[jk] = P.bi[j];
+            P.ic[jk] = P.ic[j];
+        }
+
+        ++jk;
     }
+
+    if( jk - j0 >= minpts )
+        P.cnt[k] = jk - j0;
     else
         KILL( Q );
 }
@@ -236,11 +455,12 @@ static void Cut_A2A( double *RHS, const Todo& Q, int ithr )
 
 // For rgn Q...
 
-    CRigid				*rgd;
-    const Rgns&			R  = vR[Q.iz];
-    const vector<int>&	vp = R.pts[Q.ir];
-    int					np = vp.size(),
-                        nu = 0;	// count pts used
+    CRigid			*rgd;
+    const RgnPnts&	P  = csr;
+    int				k  = P.K( Q.iz, Q.ir ),
+                    nu = 0;	// count pts used
+    long			j0 = P.beg[k],
+                    jn = j0 + P.cnt[k];
 
     if( regtype == 'R' )
         rgd = new CRigid;
@@ -256,63 +476,34 @@ static void Cut_A2A( double *RHS, const Todo& Q, int ithr )
 
     // For each of its points...
 
-    for( int ip = 0; ip < np; ++ip ) {
+    for( long j = j0; j < jn; ++j ) {
 
-        CorrPnt&	C = vC[vp[ip]];
-
-        if( !C.used || C.z1 != C.z2 )
+        if( !P.use[P.ic[j]] || P.bz[j] != Q.iz )
             continue;
 
-        Point	A, B;
-
-        // Which of {1,2} is the A-side?
-
-        if( C.i1 == Q.ir ) {	// A is 1
-
-            if( C.i2 != lastbi ) {
+        if( P.bi[j] != lastbi ) {
 
-                if( !FLAG_ISUSED( vR[C.z2].flag[C.i2] ) )
-                    continue;
-
-                Tb = &X_AS_AFF( Xs->X[C.z2], C.i2 );
-                lastbi = C.i2;
-            }
-
-            Ta->Transform( A = C.p1 );
-            Tb->Transform( B = C.p2 );
-
-            if( pass > editdelay && A.DistSqr( B ) > Etol )
+            if( !FLAG_ISUSED( vR[Q.iz].flag[P.bi[j]] ) )
                 continue;
 
-            B.x = Wb * B.x + (1 - Wb) * A.x;
-            B.y = Wb * B.y + (1 - Wb) * A.y;
-            A = C.p1;
-
-            rgd->Add( A, B );
+            Tb = &X_AS_AFF( Xs->X[Q.iz], P.bi[j] );
+            lastbi = P.bi[j];
         }
-        else {	// A is 2
 
-            if( C.i1 != lastbi ) {
+        Point	A( P.ax[j], P.ay[j] ),
+                B( P.bx[j], P.by[j] );
 
-                if( !FLAG_ISUSED( vR[C.z1].flag[C.i1] ) )
-                    continue;
-
-                Tb = &X_AS_AFF( Xs->X[C.z1], C.i1 );
-                lastbi = C.i1;
-            }
+        Ta->Transform( A );
+        Tb->Transform( B );
 
-            Ta->Transform( A = C.p2 );
-            Tb->Transform( B = C.p1 );
-
-            if( pass > editdelay && A.DistSqr( B ) > Etol )
-                continue;
+        if( pass > editdelay && A.DistSqr( B ) > Etol )
+            continue;
 
-            B.x = Wb * B.x + (1 - Wb) * A.x;
-            B.y = Wb * B.y + (1 - Wb) * A.y;
-            A = C.p2;
+        B.x = Wb * B.x + (1 - Wb) * A.x;
+        B.y = Wb * B.y + (1 - Wb) * A.y;
+        A   = Point( P.ax[j], P.ay[j] );
 
-            rgd->Add( A, B );
-        }
+        rgd->Add( A, B );
 
         ++nu;
 
@@ -348,11 +539,12 @@ static void Cut_A2H( double *RHS, const Todo& Q, int ithr )
 
 // For rgn Q...
 
-    CRigid				*rgd;
-    const Rgns&			R  = vR[Q.iz];
-    const vector<int>&	vp = R.pts[Q.ir];
-    int					np = vp.size(),
-                        nu = 0;	// count pts used
+    CRigid			*rgd;
+    const RgnPnts&	P  = csr;
+    int				k  = P.K( Q.iz, Q.ir ),
+                    nu = 0;	// count pts used
+    long			j0 = P.beg[k],
+                    jn = j0 + P.cnt[k];
 
     if( regtype == 'R' )
         rgd = new CRigid;
@@ -368,57 +560,31 @@ static void Cut_A2H( double *RHS, const Todo& Q, int ithr )
 
     // For each of its points...
 
-    for( int ip = 0; ip < np; ++ip ) {
-
-        const CorrPnt&	C = vC[vp[ip]];
+    for( long j = j0; j < jn; ++j ) {
 
-        if( !C.used || C.z1 != C.z2 )
+        if( !P.use[P.ic[j]] || P.bz[j] != Q.iz )
             continue;
 
-        Point	A, B;
-
-        // Which of {1,2} is the A-side?
-
-        if( C.i1 == Q.ir ) {	// A is 1
-
-            if( C.i2 != lastbi ) {
-
-                if( !FLAG_ISUSED( vR[C.z2].flag[C.i2] ) )
-                    continue;
-
-                Tb = &X_AS_AFF( Xs->X[C.z2], C.i2 );
-                lastbi = C.i2;
-            }
-
-            Ta->Transform( A = C.p1 );
-            Tb->Transform( B = C.p2 );
+        if( P.bi[j] != lastbi ) {
 
-            B.x = Wb * B.x + (1 - Wb) * A.x;
-            B.y = Wb * B.y + (1 - Wb) * A.y;
-            A = C.p1;
+            if( !FLAG_ISUSED( vR[Q.iz].flag[P.bi[j]] ) )
+                continue;
 
-            rgd->Add( A, B );
+            Tb = &X_AS_AFF( Xs->X[Q.iz], P.bi[j] );
+            lastbi = P.bi[j];
         }
-        else {	// A is 2
-
-            if( C.i1 != lastbi ) {
-
-                if( !FLAG_ISUSED( vR[C.z1].flag[C.i1] ) )
-                    continue;
 
-                Tb = &X_AS_AFF( Xs->X[C.z1], C.i1 );
-                lastbi = C.i1;
-            }
+        Point	A( P.ax[j], P.ay[j] ),
+                B( P.bx[j], P.by[j] );
 
-            Ta->Transform( A = C.p2 );
-            Tb->Transform( B = C.p1 );
+        Ta->Transform( A );
+        Tb->Transform( B );
 
-            B.x = Wb * B.x + (1 - Wb) * A.x;
-            B.y = Wb * B.y + (1 - Wb) * A.y;
-            A = C.p2;
+        B.x = Wb * B.x + (1 - Wb) * A.x;
+        B.y = Wb * B.y + (1 - Wb) * A.y;
+        A   = Point( P.ax[j], P.ay[j] );
 
-            rgd->Add( A, B );
-        }
+        rgd->Add( A, B );
 
         ++nu;
 
@@ -458,11 +624,12 @@ static void Cut_H2H( double *RHS, const Todo& Q, int ithr )
 
 // For rgn Q...
 
-    CRigid				*rgd;
-    const Rgns&			R  = vR[Q.iz];
-    const vector<int>&	vp = R.pts[Q.ir];
-    int					np = vp.size(),
-                        nu = 0;	// count pts used
+    CRigid			*rgd;
+    const RgnPnts&	P  = csr;
+    int				k  = P.K( Q.iz, Q.ir ),
+                    nu = 0;	// count pts used
+    long			j0 = P.beg[k],
+                    jn = j0 + P.cnt[k];
 
     if( regtype == 'R' )
         rgd = new CRigid;
@@ -478,63 +645,34 @@ static void Cut_H2H( double *RHS, const Todo& Q, int ithr )
 
     // For each of its points...
 
-    for( int ip = 0; ip < np; ++ip ) {
-
-        CorrPnt&	C = vC[vp[ip]];
+    for( long j = j0; j < jn; ++j ) {
 
-        if( !C.used || C.z1 != C.z2 )
+        if( !P.use[P.ic[j]] || P.bz[j] != Q.iz )
             continue;
 
-        Point	A, B;
-
-        // Which of {1,2} is the A-side?
+        if( P.bi[j] != lastbi ) {
 
-        if( C.i1 == Q.ir ) {	// A is 1
-
-            if( C.i2 != lastbi ) {
-
-                if( !FLAG_ISUSED( vR[C.z2].flag[C.i2] ) )
-                    continue;
-
-                Tb = &X_AS_HMY( Xs->X[C.z2], C.i2 );
-                lastbi = C.i2;
-            }
-
-            Ta->Transform( A = C.p1 );
-            Tb->Transform( B = C.p2 );
-
-            if( pass > editdelay && A.DistSqr( B ) > Etol )
+            if( !FLAG_ISUSED( vR[Q.iz].flag[P.bi[j]] ) )
                 continue;
 
-            B.x = Wb * B.x + (1 - Wb) * A.x;
-            B.y = Wb * B.y + (1 - Wb) * A.y;
-            A = C.p1;
-
-            rgd->Add( A, B );
+            Tb = &X_AS_HMY( Xs->X[Q.iz], P.bi[j] );
+            lastbi = P.bi[j];
         }
-        else {	// A is 2
 
-            if( C.i1 != lastbi ) {
+        Point	A( P.ax[j], P.ay[j] ),
+                B( P.bx[j], P.by[j] );
 
-                if( !FLAG_ISUSED( vR[C.z1].flag[C.i1] ) )
-                    continue;
+        Ta->Transform( A );
+        Tb->Transform( B );
 
-                Tb = &X_AS_HMY( Xs->X[C.z1], C.i1 );
-                lastbi = C.i1;
-            }
+        if( pass > editdelay && A.DistSqr( B ) > Etol )
+            continue;
 
-            Ta->Transform( A = C.p2 );
-            Tb->Transform( B = C.p1 );
+        B.x = Wb * B.x + (1 - Wb) * A.x;
+        B.y = Wb * B.y + (1 - Wb) * A.y;
+        A   = Point( P.ax[j], P.ay[j] );
 
-            if( pass > editdelay && A.DistSqr( B ) > Etol )
-                continue;
-
-            B.x = Wb * B.x + (1 - Wb) * A.x;
-            B.y = Wb * B.y + (1 - Wb) * A.y;
-            A = C.p2;
-
-            rgd->Add( A, B );
-        }
+        rgd->Add( A, B );
 
         ++nu;
 
@@ -574,18 +712,20 @@ static void* _A2A( void* ithr )
     if( !Q.First( (long)ithr ) )
         return NULL;
 
-    int	i1[3] = { 0, 1, 2 },
-        i2[3] = { 3, 4, 5 };
+    const RgnPnts&	P = csr;
+    int				i1[3] = { 0, 1, 2 },
+                    i2[3] = { 3, 4, 5 };
 
 // For each of my rgns...
 
     do {
 
-        CRigid			*rgd;
-        Rgns&			R  = vR[Q.iz];
-        vector<int>&	vp = R.pts[Q.ir];
-        int				np = vp.size(),
-                        nu = 0;	// count pts used
+        CRigid	*rgd;
+        int		k  = P.K( Q.iz, Q.ir ),
+                np = P.cnt[k],
+                nu = 0;	// count pts used
+        long	j0 = P.beg[k],
+                jn = j0 + np;
 
         if( np < 3 ) {
             KILL( Q );
@@ -606,95 +746,51 @@ static void* _A2A( void* ithr )
 
         Zero_Quick( LHS, RHS, 6 );
 
-        // Sort the points so that cummulative rounding
-        // error tends to be same independent of nwks.
-
-        if( !pass )
-            sort( vp.begin(), vp.end(), SortPnts );
-
         // For each of its points...
 
-        for( int ip = 0; ip < np; ++ip ) {
-
-            CorrPnt&	C = vC[vp[ip]];
+        for( long j = j0; j < jn; ++j ) {
 
-            if( !C.used )
+            if( !P.use[P.ic[j]] )
                 continue;
 
-            Point	A, B;
-
-            // Which of {1,2} is the A-side?
-
-            if( C.z1 == Q.iz && C.i1 == Q.ir ) {	// A is 1
-
-                if( C.z2 != lastbz ) {
-                    lastbz = C.z2;
-                    lastbi = -1;
-                }
-
-                if( C.i2 != lastbi ) {
+            int	bz = P.bz[j],
+                bi = P.bi[j];
 
-                    if( !FLAG_ISUSED( vR[C.z2].flag[C.i2] ) ) {
-
-                        // Here's a pnt that's 'used' referencing
-                        // a rgn that's not. It's inefficient, so
-                        // we'll get such points marked 'not used'.
+            if( bz != lastbz ) {
+                lastbz = bz;
+                lastbi = -1;
+            }
 
-                        MARK( Todo( C.z2, C.i2 ) );
-                        continue;
-                    }
+            if( bi != lastbi ) {
 
-                    Tb = &X_AS_AFF( Xs->X[C.z2], C.i2 );
-                    lastbi = C.i2;
-                }
+                if( !FLAG_ISUSED( vR[bz].flag[bi] ) ) {
 
-                Ta->Transform( A = C.p1 );
-                Tb->Transform( B = C.p2 );
+                    // Here's a pnt that's 'used' referencing
+                    // a rgn that's not. It's inefficient, so
+                    // we'll get such points marked 'not used'.
 
-                if( pass > editdelay && A.DistSqr( B ) > Etol )
+                    MARK( Todo( bz, bi ) );
                     continue;
-
-                B.x = Wb * B.x + (1 - Wb) * A.x;
-                B.y = Wb * B.y + (1 - Wb) * A.y;
-                A = C.p1;
-
-                rgd->Add( A, B );
-            }
-            else {	// A is 2
-
-                if( C.z1 != lastbz ) {
-                    lastbz = C.z1;
-                    lastbi = -1;
                 }
 
-                if( C.i1 != lastbi ) {
-
-                    if( !FLAG_ISUSED( vR[C.z1].flag[C.i1] ) ) {
-
-                        // Here's a pnt that's 'used' referencing
-                        // a rgn that's not. It's inefficient, so
-                        // we'll get such points marked 'not used'.
+                Tb = &X_AS_AFF( Xs->X[bz], bi );
+                lastbi = bi;
+            }
 
-                        MARK( Todo( C.z1, C.i1 ) );
-                        continue;
-                    }
+            Point	A( P.ax[j], P.ay[j] ),
+                    B( P.bx[j], P.by[j] );
 
-                    Tb = &X_AS_AFF( Xs->X[C.z1], C.i1 );
-                    lastbi = C.i1;
-                }
+            Ta->Transform( A );
+            Tb->Transform( B );
 
-                Ta->Transform( A = C.p2 );
-                Tb->Transform( B = C.p1 );
-
-                if( pass > editdelay && A.DistSqr( B ) > Etol )
-                    continue;
+            if( pass > editdelay && A.DistSqr( B ) > Etol )
+                continue;
 
-                B.x = Wb * B.x + (1 - Wb) * A.x;
-                B.y = Wb * B.y + (1 - Wb) * A.y;
-                A = C.p2;
+            B.x = Wb * B.x + (1 - Wb) * A.x;
+            B.y = Wb * B.y + (1 - Wb) * A.y;
+            A   = Point( P.ax[j], P.ay[j] );
 
-                rgd->Add( A, B );
-            }
+            rgd->Add( A, B );
 
             ++nu;
 
@@ -753,18 +849,20 @@ static void* _A2H( void* ithr )
     if( !Q.First( (long)ithr ) )
         return NULL;
 
-    int	i1[5] = { 0, 1, 2, 6, 7 },
-        i2[5] = { 3, 4, 5, 6, 7 };
+    const RgnPnts&	P = csr;
+    int				i1[5] = { 0, 1, 2, 6, 7 },
+                    i2[5] = { 3, 4, 5, 6, 7 };
 
 // For each of my rgns...
 
     do {
 
-        CRigid			*rgd;
-        Rgns&			R  = vR[Q.iz];
-        vector<int>&	vp = R.pts[Q.ir];
-        int				np = vp.size(),
-                        nu = 0;	// count pts used
+        CRigid	*rgd;
+        int		k  = P.K( Q.iz, Q.ir ),
+                np = P.cnt[k],
+                nu = 0;	// count pts used
+        long	j0 = P.beg[k],
+                jn = j0 + np;
 
         if( np < 4 ) {
             KILL( Q );
@@ -785,89 +883,48 @@ static void* _A2H( void* ithr )
 
         Zero_Quick( LHS, RHS, 8 );
 
-        // Sort the points so that cummulative rounding
-        // error tends to be same independent of nwks.
-
-        if( !pass )
-            sort( vp.begin(), vp.end(), SortPnts );
-
         // For each of its points...
 
-        for( int ip = 0; ip < np; ++ip ) {
-
-            const CorrPnt&	C = vC[vp[ip]];
+        for( long j = j0; j < jn; ++j ) {
 
-            if( !C.used )
+            if( !P.use[P.ic[j]] )
                 continue;
 
-            Point	A, B;
-
-            // Which of {1,2} is the A-side?
-
-            if( C.z1 == Q.iz && C.i1 == Q.ir ) {	// A is 1
-
-                if( C.z2 != lastbz ) {
-                    lastbz = C.z2;
-                    lastbi = -1;
-                }
+            int	bz = P.bz[j],
+                bi = P.bi[j];
 
-                if( C.i2 != lastbi ) {
+            if( bz != lastbz ) {
+                lastbz = bz;
+                lastbi = -1;
+            }
 
-                    if( !FLAG_ISUSED( vR[C.z2].flag[C.i2] ) ) {
+            if( bi != lastbi ) {
 
-                        // Here's a pnt that's 'used' referencing
-                        // a rgn that's not. It's inefficient, so
-                        // we'll get such points marked 'not used'.
+                if( !FLAG_ISUSED( vR[bz].flag[bi] ) ) {
 
-                        MARK( Todo( C.z2, C.i2 ) );
-                        continue;
-                    }
+                    // Here's a pnt that's 'used' referencing
+                    // a rgn that's not. It's inefficient, so
+                    // we'll get such points marked 'not used'.
 
-                    Tb = &X_AS_AFF( Xs->X[C.z2], C.i2 );
-                    lastbi = C.i2;
+                    MARK( Todo( bz, bi ) );
+                    continue;
                 }
 
-                Ta->Transform( A = C.p1 );
-                Tb->Transform( B = C.p2 );
-
-                B.x = Wb * B.x + (1 - Wb) * A.x;
-                B.y = Wb * B.y + (1 - Wb) * A.y;
-                A = C.p1;
-
-                rgd->Add( A, B );
+                Tb = &X_AS_AFF( Xs->X[bz], bi );
+                lastbi = bi;
             }
-            else {	// A is 2
-
-                if( C.z1 != lastbz ) {
-                    lastbz = C.z1;
-                    lastbi = -1;
-                }
 
-                if( C.i1 != lastbi ) {
+            Point	A( P.ax[j], P.ay[j] ),
+                    B( P.bx[j], P.by[j] );
 
-                    if( !FLAG_ISUSED( vR[C.z1].flag[C.i1] ) ) {
+            Ta->Transform( A );
+            Tb->Transform( B );
 
-                        // Here's a pnt that's 'used' referencing
-                        // a rgn that's not. It's inefficient, so
-                        // we'll get those point marked 'not used'.
-
-                        MARK( Todo( C.z1, C.i1 ) );
-                        continue;
-                    }
-
-                    Tb = &X_AS_AFF( Xs->X[C.z1], C.i1 );
-                    lastbi = C.i1;
-                }
-
-                Ta->Transform( A = C.p2 );
-                Tb->Transform( B = C.p1 );
-
-                B.x = Wb * B.x + (1 - Wb) * A.x;
-                B.y = Wb * B.y + (1 - Wb) * A.y;
-                A = C.p2;
+            B.x = Wb * B.x + (1 - Wb) * A.x;
+            B.y = Wb * B.y + (1 - Wb) * A.y;
+            A   = Point( P.ax[j], P.ay[j] );
 
-                rgd->Add( A, B );
-            }
+            rgd->Add( A, B );
 
             ++nu;
 
@@ -915,18 +972,20 @@ static void* _H2H( void* ithr )
     if( !Q.First( (long)ithr ) )
         return NULL;
 
-    int	i1[5] = { 0, 1, 2, 6, 7 },
-        i2[5] = { 3, 4, 5, 6, 7 };
+    const RgnPnts&	P = csr;
+    int				i1[5] = { 0, 1, 2, 6, 7 },
+                    i2[5] = { 3, 4, 5, 6, 7 };
 
 // For each of my rgns...
 
     do {
 
-        CRigid			*rgd;
-        Rgns&			R  = vR[Q.iz];
-        vector<int>&	vp = R.pts[Q.ir];
-        int				np = vp.size(),
-                        nu = 0;	// count pts used
+        CRigid	*rgd;
+        int		k  = P.K( Q.iz, Q.ir ),
+                np = P.cnt[k],
+                nu = 0;	// count pts used
+        long	j0 = P.beg[k],
+                jn = j0 + np;
 
         if( np < 4 ) {
             KILL( Q );
@@ -947,95 +1006,51 @@ static void* _H2H( void* ithr )
 
         Zero_Quick( LHS, RHS, 8 );
 
-        // Sort the points so that cummulative rounding
-        // error tends to be same independent of nwks.
-
-        if( !pass )
-            sort( vp.begin(), vp.end(), SortPnts );
-
         // For each of its points...
 
-        for( int ip = 0; ip < np; ++ip ) {
-
-            CorrPnt&	C = vC[vp[ip]];
+        for( long j = j0; j < jn; ++j ) {
 
-            if( !C.used )
+            if( !P.use[P.ic[j]] )
                 continue;
 
-            Point	A, B;
-
-            // Which of {1,2} is the A-side?
-
-            if( C.z1 == Q.iz && C.i1 == Q.ir ) {	// A is 1
-
-                if( C.z2 != lastbz ) {
-                    lastbz = C.z2;
-                    lastbi = -1;
-                }
-
-                if( C.i2 != lastbi ) {
+            int	bz = P.bz[j],
+                bi = P.bi[j];
 
-                    if( !FLAG_ISUSED( vR[C.z2].flag[C.i2] ) ) {
-
-                        // Here's a pnt that's 'used' referencing
-                        // a rgn that's not. It's inefficient, so
-                        // we'll get those point marked 'not used'.
+            if( bz != lastbz ) {
+                lastbz = bz;
+                lastbi = -1;
+            }
 
-                        MARK( Todo( C.z2, C.i2 ) );
-                        continue;
-                    }
+            if( bi != lastbi ) {
 
-                    Tb = &X_AS_HMY( Xs->X[C.z2], C.i2 );
-                    lastbi = C.i2;
-                }
+                if( !FLAG_ISUSED( vR[bz].flag[bi] ) ) {
 
-                Ta->Transform( A = C.p1 );
-                Tb->Transform( B = C.p2 );
+                    // Here's a pnt that's 'used' referencing
+                    // a rgn that's not. It's inefficient, so
+                    // we'll get such points marked 'not used'.
 
-                if( pass > editdelay && A.DistSqr( B ) > Etol )
+                    MARK( Todo( bz, bi ) );
                     continue;
-
-                B.x = Wb * B.x + (1 - Wb) * A.x;
-                B.y = Wb * B.y + (1 - Wb) * A.y;
-                A = C.p1;
-
-                rgd->Add( A, B );
-            }
-            else {	// A is 2
-
-                if( C.z1 != lastbz ) {
-                    lastbz = C.z1;
-                    lastbi = -1;
                 }
 
-                if( C.i1 != lastbi ) {
-
-                    if( !FLAG_ISUSED( vR[C.z1].flag[C.i1] ) ) {
-
-                        // Here's a pnt that's 'used' referencing
-                        // a rgn that's not. It's inefficient, so
-                        // we'll get those point marked 'not used'.
+                Tb = &X_AS_HMY( Xs->X[bz], bi );
+                lastbi = bi;
+            }
 
-                        MARK( Todo( C.z1, C.i1 ) );
-                        continue;
-                    }
+            Point	A( P.ax[j], P.ay[j] ),
+                    B( P.bx[j], P.by[j] );
 
-                    Tb = &X_AS_HMY( Xs->X[C.z1], C.i1 );
-                    lastbi = C.i1;
-                }
+            Ta->Transform( A );
+            Tb->Transform( B );
 
-                Ta->Transform( A = C.p2 );
-                Tb->Transform( B = C.p1 );
-
-                if( pass > editdelay && A.DistSqr( B ) > Etol )
-                    continue;
+            if( pass > editdelay && A.DistSqr( B ) > Etol )
+                continue;
 
-                B.x = Wb * B.x + (1 - Wb) * A.x;
-                B.y = Wb * B.y + (1 - Wb) * A.y;
-                A = C.p2;
+            B.x = Wb * B.x + (1 - Wb) * A.x;
+            B.y = Wb * B.y + (1 - Wb) * A.y;
+            A   = Point( P.ax[j], P.ay[j] );
 
-                rgd->Add( A, B );
-            }
+            rgd->Add( A, B );
 
             ++nu;
 
@@ -1105,7 +1120,9 @@ static void* _H2H( void* ithr )
 //
 // (3) As an efficiency measure, each rgn's list of points can be
 // shortened to remove those that are not used. These lists are
-// private to each thread so are edited in the solve phase.
+// private to each thread so are edited in the solve phase. The
+// shortened lists live in csr; vR pts lists (a superset) are
+// updated only at the end of Solve, so may be used here.
 //
 static void UpdateFlags()
 {
@@ -1133,8 +1150,10 @@ static void UpdateFlags()
             int				np = vp.size();
 
             // mark all its pnts
-            for( int ip = 0; ip < np; ++ip )
+            for( int ip = 0; ip < np; ++ip ) {
                 vC[vp[ip]].used = false;
+                csr.use[vp[ip]] = 0;
+            }
         }
 
         // Process cuts
@@ -1157,8 +1176,10 @@ static void UpdateFlags()
 
                 CorrPnt& C = vC[vp[ip]];
 
-                if( C.z1 != C.z2 )
+                if( C.z1 != C.z2 ) {
                     C.used = false;
+                    csr.use[vp[ip]] = 0;
+                }
             }
         }
 
@@ -1178,9 +1199,13 @@ static void UpdateFlags()
             FLAG_ADDKILL( R.flag[e.ir] );
 
             // mark all its pnts
-            for( int ip = 0; ip < np; ++ip )
+            for( int ip = 0; ip < np; ++ip ) {
                 vC[vp[ip]].used = false;
+                csr.use[vp[ip]] = 0;
+            }
         }
+
+        vthr[it].Clear();
     }
 
 // Report activity this pass
@@ -1191,28 +1216,351 @@ static void UpdateFlags()
     }
 }
 
+/* --------------------------------------------------------------- */
+/* ColorRgns ----------------------------------------------------- */
+/* --------------------------------------------------------------- */
+
+// For Gauss-Seidel mode, greedily color my inner rgns such that
+// no two rgns joined by a point pair share a color. All rgns of
+// one color can then be solved concurrently, each reading the
+// freshest values of its neighbors from earlier color phases.
+//
+// Rgns outside [zilo,zihi] are owned by other workers and are
+// read-only here, so they don't constrain the coloring.
+//
+// Return false if more than 255 colors would be needed.
+//
+static bool ColorRgns()
+{
+    clock_t	t0 = StartTiming();
+
+    vector<int>	stamp( 256, -1 );
+    int			nused = 0;
+
+    vclr.resize( vR.size() );
+    nclr = 0;
+
+    for( int iz = zilo; iz <= zihi; ++iz ) {
+
+        const Rgns&	R = vR[iz];
+
+        vclr[iz].assign( R.nr, 0xFF );
+
+        for( int ir = 0; ir < R.nr; ++ir ) {
+
+            if( !FLAG_ISUSED( R.flag[ir] ) )
+                continue;
+
+            // Stamp neighbor colors
+
+            const vector<int>&	vp = R.pts[ir];
+            int					np = vp.size();
+
+            for( int ip = 0; ip < np; ++ip ) {
+
+                const CorrPnt&	C = vC[vp[ip]];
+                int				zo, io;
+
+                if( C.z1 == iz && C.i1 == ir ) {
+                    zo = C.z2;
+                    io = C.i2;
+                }
+                else {
+                    zo = C.z1;
+                    io = C.i1;
+                }
+
+                if( zo >= zilo && zo <= zihi ) {
+
+                    int	c = vclr[zo][io];
+
+                    if( c != 0xFF )
+                        stamp[c] = nused;
+                }
+            }
+
+            // Lowest free color
+
+            int	c = 0;
+
+            while( c < 255 && stamp[c] == nused )
+                ++c;
+
+            if( c == 255 )
+                return false;
+
+            vclr[iz][ir] = c;
+
+            if( c >= nclr )
+                nclr = c + 1;
+
+            ++nused;
+        }
+    }
+
+    printf( "NColr: %d\n", nclr );
+
+    StopTiming( stdout, "Color", t0 );
+
+    return true;
+}
+
+/* --------------------------------------------------------------- */
+/* MarkHalo ------------------------------------------------------ */
+/* --------------------------------------------------------------- */
+
+// Set vhlo[iz][ir] = 1 for inner rgns having points into wing
+// layers that are refreshed from neighbor workers, else zero.
+// Interior rgns can then be solved while the halo exchange is
+// still in flight.
+//
+// Return false if there are no neighbors.
+//
+static bool MarkHalo()
+{
+    if( nwks <= 1 )
+        return false;
+
+    int	nh = 0;
+
+    vhlo.resize( vR.size() );
+
+    for( int iz = zilo; iz <= zihi; ++iz ) {
+
+        const Rgns&	R = vR[iz];
+
+        vhlo[iz].assign( R.nr, 0 );
+
+        for( int ir = 0; ir < R.nr; ++ir ) {
+
+            const vector<int>&	vp = R.pts[ir];
+            int					np = vp.size();
+
+            for( int ip = 0; ip < np; ++ip ) {
+
+                const CorrPnt&	C = vC[vp[ip]];
+                int				zo = (C.z1 == iz && C.i1 == ir ?
+                                        C.z2 : C.z1);
+
+                if( (zo < zilo && wkid > 0) ||
+                    (zo > zihi && wkid < nwks - 1) ) {
+
+                    vhlo[iz][ir] = 1;
+                    ++nh;
+                    break;
+                }
+            }
+        }
+    }
+
+    printf( "NHalo: %d\n", nh );
+
+    return true;
+}
+
+/* --------------------------------------------------------------- */
+/* RgnDelta ------------------------------------------------------ */
+/* --------------------------------------------------------------- */
+
+// Return largest squared displacement of an image corner
+// between rgn Q's old (Xs) and new (Xd) tforms.
+//
+static double RgnDelta( const Todo& Q )
+{
+    Point	cnr[4] = {
+                Point( 0, 0 ), Point( gW, 0 ),
+                Point( 0, gH ), Point( gW, gH )};
+    double	d = 0.0;
+
+    for( int i = 0; i < 4; ++i ) {
+
+        Point	a = cnr[i], b = cnr[i];
+
+        if( Xs->NE == 6 ) {
+            X_AS_AFF( Xs->X[Q.iz], Q.ir ).Transform( a );
+            X_AS_AFF( Xd->X[Q.iz], Q.ir ).Transform( b );
+        }
+        else {
+            X_AS_HMY( Xs->X[Q.iz], Q.ir ).Transform( a );
+            X_AS_HMY( Xd->X[Q.iz], Q.ir ).Transform( b );
+        }
+
+        d = max( d, a.DistSqr( b ) );
+    }
+
+    return d;
+}
+
+/* --------------------------------------------------------------- */
+/* _Delta -------------------------------------------------------- */
+/* --------------------------------------------------------------- */
+
+// Post-solve step over surviving rgns of current color:
+// - If measure, tabulate how far each tform moved.
+// - If gsnow, publish new tform Xd -> Xs so that later
+//   color phases of this pass see it.
+//
+static void* _Delta( void* ithr )
+{
+    Todo	Q;
+
+    if( !Q.First( (long)ithr ) )
+        return NULL;
+
+    Thrdat&	T  = vthr[(long)ithr];
+    int		NE = Xs->NE;
+
+    do {
+
+        if( measure ) {
+
+            double	d = RgnDelta( Q );
+
+            if( d > T.dmax )
+                T.dmax = d;
+
+            T.dsum += d;
+            ++T.dn;
+        }
+
+        if( gsnow ) {
+
+            memcpy( &Xs->X[Q.iz][Q.ir * NE],
+                &Xd->X[Q.iz][Q.ir * NE], NE * sizeof(double) );
+        }
+
+    } while( Q.Next() );
+
+    return NULL;
+}
+
+/* --------------------------------------------------------------- */
+/* Converged ----------------------------------------------------- */
+/* --------------------------------------------------------------- */
+
+// Combine thread and worker deltas for this pass, report them
+// periodically, and return true if max delta is within Dtol.
+//
+static bool Converged()
+{
+    double	vmax[1] = {0.0},
+            vsum[2] = {0.0, 0.0};
+    int		nt = vthr.size();
+
+    for( int it = 0; it < nt; ++it ) {
+
+        const Thrdat&	T = vthr[it];
+
+        vmax[0]  = max( vmax[0], T.dmax );
+        vsum[0] += T.dsum;
+        vsum[1] += T.dn;
+    }
+
+    MPIMaxAll( vmax, 1 );
+    MPISumAll( vsum, 2 );
+
+    double	dmax = sqrt( vmax[0] ),
+            drms = (vsum[1] ? sqrt( vsum[0] / vsum[1] ) : 0.0);
+    bool	done = dmax <= Dtol;
+
+    if( done || !(pass % 100) ) {
+        printf( "Pass %d: delta [max, rms] = [%g, %g].\n",
+        pass, dmax, drms );
+    }
+
+    return done;
+}
+
 /* --------------------------------------------------------------- */
 /* Do1Pass ------------------------------------------------------- */
 /* --------------------------------------------------------------- */
 
-static void Do1Pass( EZThreadproc proc )
+// Workers come from the persistent thrpool, and each one's
+// Thrdat lists are emptied (not freed) by UpdateFlags, so a
+// pass costs no thread creation or edit-list reallocation.
+//
+// In GS mode the pass is split into color phases. Each phase
+// applies its edits (UpdateFlags) before publishing its new
+// tforms, so killed rgns never leak into later phases.
+//
+// In Jacobi mode with neighbor workers, the halo exchange of the
+// previous pass's results is overlapped with solving this pass's
+// interior rgns; only the halo rgns (vhlo) wait for it.
+//
+// Return true if converged (only tested if Dtol > 0).
+//
+static bool Do1Pass( EZThreadproc proc )
 {
-// multithreaded phase
+    measure = Dtol > 0 && pass > editdelay && Xs->NE == Xd->NE;
 
-    vthr.clear();
-    vthr.resize( nthr );
+    if( measure ) {
 
-    if( !EZThreads( proc, nthr, 1, "Solveproc" ) )
-        exit( 42 );
+        for( int it = 0; it < nthr; ++it ) {
+            vthr[it].dmax	= 0.0;
+            vthr[it].dsum	= 0.0;
+            vthr[it].dn		= 0;
+        }
+    }
 
-// single-threaded phase
+// multithreaded phase(s)
 
-    UpdateFlags();
-    vthr.clear();
+    if( gsnow ) {
+
+        Xs->UpdtWait();
+
+        for( curclr = 0; curclr < nclr; ++curclr ) {
+
+            if( !thrpool.Run( proc, nthr ) )
+                exit( 42 );
+
+            UpdateFlags();
+
+            if( !thrpool.Run( _Delta, nthr ) )
+                exit( 42 );
+        }
+
+        curclr = -1;
+    }
+    else if( Xs->UpdtPending() ) {
+
+        curhlo = 0;
+
+        if( !thrpool.Run( proc, nthr ) )
+            exit( 42 );
+
+        Xs->UpdtWait();
+
+        curhlo = 1;
+
+        if( !thrpool.Run( proc, nthr ) )
+            exit( 42 );
+
+        curhlo = -1;
+
+        UpdateFlags();
+
+        if( measure && !thrpool.Run( _Delta, nthr ) )
+            exit( 42 );
+    }
+    else {
+
+        if( !thrpool.Run( proc, nthr ) )
+            exit( 42 );
+
+        UpdateFlags();
+
+        if( measure && !thrpool.Run( _Delta, nthr ) )
+            exit( 42 );
+    }
 
 // synchronize
 
-    Xd->Updt();
+    if( vhlo.size() )
+        Xd->UpdtStart();
+    else
+        Xd->Updt();
+
+    return measure && Converged();
 }
 
 /* --------------------------------------------------------------- */
@@ -1230,11 +1578,25 @@ static void Do1Pass( EZThreadproc proc )
 //
 // inEtol is the largest permitted point error.
 //
-void SetSolveParams( int type, double inWr, double inEtol )
+// inDtol > 0 enables early stopping: once edits are enabled,
+// stop as soon as no tform moves any image corner by more
+// than inDtol pixels in one pass (over all workers).
+//
+// inGS selects colored in-place (Gauss-Seidel) updating; see
+// ColorRgns(). Cross-worker halo layers remain Jacobi-style.
+//
+void SetSolveParams(
+    int		type,
+    double	inWr,
+    double	inEtol,
+    double	inDtol,
+    bool	inGS )
 {
     Etol	= inEtol * inEtol;
     Wr		= inWr;
     regtype	= type;
+    Dtol	= inDtol;
+    gsmode	= inGS;
 }
 
 /* --------------------------------------------------------------- */
@@ -1247,7 +1609,10 @@ void SetSolveParams( int type, double inWr, double inEtol )
 // Next the src/dst roles are swapped (Xs/Xd pointer swap) and
 // the process repeats.
 //
-void Solve( XArray &Xsrc, XArray &Xdst, int iters )
+// Return count of passes actually done (<= iters), which sets
+// whether the result is in Xsrc (even) or Xdst (odd).
+//
+int Solve( XArray &Xsrc, XArray &Xdst, int iters )
 {
     clock_t	t0 = StartTiming();
 
@@ -1283,6 +1648,24 @@ void Solve( XArray &Xsrc, XArray &Xdst, int iters )
     printf( "Solve: %c to %c (Wr %c, %g Etol %g iters %d)\n",
     cS, cD, regtype, Wr, sqrt( Etol ), iters );
 
+    curclr	= -1;
+    gsnow	= gsmode && cS == cD;
+
+    if( gsnow && !ColorRgns() ) {
+        printf( "Solve: Too many colors; using Jacobi mode.\n" );
+        gsnow = false;
+    }
+
+    if( gsnow || Dtol > 0 ) {
+        printf( "Solve: Mode %s, Dtol %g\n",
+        (gsnow ? "GS" : "Jacobi"), Dtol );
+    }
+
+    curhlo = -1;
+
+    if( gsnow || !MarkHalo() )
+        vhlo.clear();
+
 /* -------- */
 /* Set nthr */
 /* -------- */
@@ -1308,18 +1691,39 @@ void Solve( XArray &Xsrc, XArray &Xdst, int iters )
     Xs = &Xsrc;
     Xd = &Xdst;
 
+    vthr.clear();
+    vthr.resize( nthr );
+
+    csr.Build();
+
     for( pass = 0; pass < iters; ++pass ) {
 
-        Do1Pass( proc );
+        bool	done = Do1Pass( proc );
 
         // swap Xs<->Xd
         XArray	*Xt = Xs; Xs = Xd; Xd = Xt;
 
         if( !((long)DeltaSeconds( t0 ) % 300) )
             fflush( stdout );
+
+        if( done ) {
+            printf( "Solve: Converged after %d passes.\n", ++pass );
+            break;
+        }
     }
 
+    // complete last exchange (result now in Xs)
+    Xs->UpdtWait();
+
+    csr.Store();
+
+    vthr.clear();
+    vclr.clear();
+    vhlo.clear();
+
     StopTiming( stdout, "Solve", t0 );
+
+    return pass;
 }
 
 
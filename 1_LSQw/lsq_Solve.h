@@ -10,8 +10,13 @@
 /* Functions ----------------------------------------------------- */
 /* --------------------------------------------------------------- */
 
-void SetSolveParams( int type, double inWr, double inEtol );
-
-void Solve( XArray &Xsrc, XArray &Xdst, int iters );
+void SetSolveParams(
+    int		type,
+    double	inWr,
+    double	inEtol,
+    double	inDtol,
+    bool	inGS );
+
+int Solve( XArray &Xsrc, XArray &Xdst, int iters );
 
 
@@ -11,6 +11,7 @@
 
 #include	<string.h>
 
+#include	<algorithm>
 #include	<stack>
 using namespace std;
 
@@ -34,19 +35,68 @@ public:
     GDrty() : L(1), R(1) {};
 };
 
+class CLink {
+// Two colors joined by a cross-layer connection; a < b
+public:
+    int	a, b;
+public:
+    CLink( int c1, int c2 )
+    : a(min( c1, c2 )), b(max( c1, c2 )) {};
+
+    bool operator < ( const CLink &rhs ) const
+        {return a < rhs.a || (a == rhs.a && b < rhs.b);};
+
+    bool operator == ( const CLink &rhs ) const
+        {return a == rhs.a && b == rhs.b;};
+};
+
+class CClrUF {
+// Union-find over color labels. Each set's root is its
+// lowest color, so roots name pieces exactly as min-color
+// propagation would.
+public:
+    vector<int>	clr,	// distinct colors, ascending
+                up,		// parent index
+                rt;		// final (global) root color
+public:
+    void Init( vector<int> &v );
+
+    int Idx( int c ) const
+        {return lower_bound( clr.begin(), clr.end(), c ) - clr.begin();};
+
+    int Find( int i )
+        {
+            while( up[i] != i )
+                i = up[i] = up[up[i]];
+
+            return i;
+        };
+
+    void Join( int c1, int c2 )
+        {
+            int	i = Find( Idx( c1 ) ),
+                j = Find( Idx( c2 ) );
+
+            if( i < j )
+                up[j] = i;
+            else if( j < i )
+                up[i] = j;
+        };
+
+    int Root( int c )
+        {return clr[Find( Idx( c ) )];};
+};
+
 /* --------------------------------------------------------------- */
 /* Statics ------------------------------------------------------- */
 /* --------------------------------------------------------------- */
 
-static Split*			ME;
-static const char		*gpath;
-static vector<GDrty>	gdrty;
-static vector<uint8>	drtyS, drtyD;
-static vector<int>		vzd;
-static int				nthr,
-                        saveclr,
-                        maxspan,
-                        zs;
+static Split*					ME;
+static const char				*gpath;
+static vector<GDrty>			gdrty;
+static vector<vector<CLink> >	vlnk;	// per inner layer
+static int						nthr,
+                                saveclr;
 
 
 
@@ -161,34 +211,6 @@ void Split::ColorMontages()
         exit( 42 );
 }
 
-/* --------------------------------------------------------------- */
-/* GUpdt --------------------------------------------------------- */
-/* --------------------------------------------------------------- */
-
-void Split::GUpdt()
-{
-// Send my GDrty to master; then get global vector
-
-    if( wkid > 0 ) {
-
-        // send mine
-        MPISend( &gdrty[wkid], sizeof(GDrty), 0, wkid );
-
-        // get all
-        MPIRecv( &gdrty[0], nwks * sizeof(GDrty), 0, wkid );
-    }
-    else if( nwks > 1 ) {
-
-        // get each worker
-        for( int iw = 1; iw < nwks; ++iw )
-            MPIRecv( &gdrty[iw], sizeof(GDrty), iw, iw );
-
-        // send each worker
-        for( int iw = 1; iw < nwks; ++iw )
-            MPISend( &gdrty[0], nwks * sizeof(GDrty), iw, iw );
-    }
-}
-
 /* --------------------------------------------------------------- */
 /* KSend --------------------------------------------------------- */
 /* --------------------------------------------------------------- */
@@ -315,167 +337,260 @@ bool Split::KUpdt()
 }
 
 /* --------------------------------------------------------------- */
-/* _Propagate1 --------------------------------------------------- */
+/* CClrUF::Init -------------------------------------------------- */
 /* --------------------------------------------------------------- */
 
-static void* _Propagate1( void* ithr )
+// Make singleton sets of the distinct colors in v (v is sorted).
+//
+void CClrUF::Init( vector<int> &v )
 {
-    int	nd = vzd.size();
+    sort( v.begin(), v.end() );
+    v.erase( unique( v.begin(), v.end() ), v.end() );
 
-    const Rgns&		Rs = vR[zs];
-    vector<int>&	ks = ME->K[zs];
+    clr = v;
 
-    for( int id = (long)ithr; id < nd; id += nthr ) {
+    int	nc = clr.size();
 
-        int				zd = vzd[id];
-        vector<int>&	kd = ME->K[zd];
-        int				nd = vR[zd].nr;
+    up.resize( nc );
 
-        for( int ir = 0; ir < Rs.nr; ++ir ) {
+    for( int i = 0; i < nc; ++i )
+        up[i] = i;
+}
+
+/* --------------------------------------------------------------- */
+/* _GatherLinks -------------------------------------------------- */
+/* --------------------------------------------------------------- */
+
+// List distinct color pairs joined by used cross-layer points
+// from each inner layer. Used points have an inner end, so
+// this sees every connection propagation would have.
+//
+static void* _GatherLinks( void* ithr )
+{
+    for( int iz = zilo + (long)ithr; iz <= zihi; iz += nthr ) {
+
+        const Rgns&			R = vR[iz];
+        const vector<int>&	k = ME->K[iz];
+        vector<CLink>&		L = vlnk[iz - zilo];
 
-            int	ksrc = ks[ir];
+        for( int ir = 0; ir < R.nr; ++ir ) {
+
+            int	ksrc = k[ir];
 
             // Valid tile?
             if( !ksrc )
                 continue;
 
-            const vector<int>&	P  = Rs.pts[ir];
+            const vector<int>&	P  = R.pts[ir];
             int					np = P.size();
 
             for( int ip = 0; ip < np; ++ip ) {
 
                 const CorrPnt&	C = vC[P[ip]];
 
-                if( !C.used )
+                if( !C.used || C.z1 == C.z2 )
                     continue;
 
-                int	jr;
+                int	kdst;
 
-                if( C.z1 == zd )
-                    jr = C.i1;
-                else if( C.z2 == zd )
-                    jr = C.i2;
+                if( C.z1 == iz )
+                    kdst = ME->K[C.z2][C.i2];
                 else
-                    continue;
-
-                int	kdst = kd[jr];
-
-                if( !kdst )
-                    continue;
-
-                if( kdst == ksrc )
-                    continue;
-
-                // Note any difference by setting the
-                // drtyD flag now. But at this time,
-                // we only update dst colors if the
-                // src color is lower. If the dst is
-                // lower, it will propagate to us on
-                // a later loop iteration.
+                    kdst = ME->K[C.z1][C.i1];
 
-                drtyD[zd] = 1;
-
-                if( ksrc < kdst ) {
-                    for( int ik = 0; ik < nd; ++ik ) {
-                        if( kd[ik] == kdst )
-                            kd[ik] = ksrc;
-                    }
-                }
+                if( kdst && kdst != ksrc )
+                    L.push_back( CLink( ksrc, kdst ) );
             }
         }
+
+        sort( L.begin(), L.end() );
+        L.erase( unique( L.begin(), L.end() ), L.end() );
     }
 
     return NULL;
 }
 
 /* --------------------------------------------------------------- */
-/* Propagate1 ---------------------------------------------------- */
+/* JoinLocal ----------------------------------------------------- */
 /* --------------------------------------------------------------- */
 
-// Propagate colors from source layer zs to its connectees.
+// Union montage colors across Z using my points.
 //
-// To do this with threads that don't collide, all the threads
-// will read from same source layer zs, but each will write to
-// a unique dst layer zd.
-//
-void Split::Propagate1()
+void Split::JoinLocal( CClrUF &U )
 {
-    vzd.clear();
+// All colors I know, including outer layers
+
+    vector<int>	v;
 
-    int	zlo = max( zs - maxspan, zilo ),
-        zhi = min( zs + maxspan, zihi ),
-        nd  = zhi - zlo + 1;
+    for( int iz = zolo; iz <= zohi; ++iz ) {
 
-    for( int i = 0; i < nd; ++i ) {
-        if( i + zlo != zs )
-            vzd.push_back( i + zlo );
+        const vector<int>&	k = K[iz];
+        int					nr = vR[iz].nr;
+
+        for( int ir = 0; ir < nr; ++ir ) {
+
+            if( k[ir] )
+                v.push_back( k[ir] );
+        }
     }
 
-    ME		= (Split*)this;
-    nd		= vzd.size();
+    U.Init( v );
+
+// Gather links in parallel; join serially
+
+    int	nz = zihi - zilo + 1;
+
+    vlnk.clear();
+    vlnk.resize( nz );
+
+    ME		= this;
     nthr	= maxthreads;
 
-    if( nthr > nd )
-        nthr = nd;
+    if( nthr > nz )
+        nthr = nz;
 
-    if( !EZThreads( _Propagate1, nthr, 1, "_Propagate1" ) )
+    if( !EZThreads( _GatherLinks, nthr, 1, "_GatherLinks" ) )
         exit( 42 );
+
+    for( int iz = 0; iz < nz; ++iz ) {
+
+        const vector<CLink>&	L  = vlnk[iz];
+        int						nl = L.size();
+
+        for( int il = 0; il < nl; ++il )
+            U.Join( L[il].a, L[il].b );
+    }
+
+    vlnk.clear();
 }
 
 /* --------------------------------------------------------------- */
-/* PropagateLocally ---------------------------------------------- */
+/* JoinGlobal ---------------------------------------------------- */
 /* --------------------------------------------------------------- */
 
-// Propagate each dirty layer in a loop until no more dirty
-// flags in our local block's interior. However, gdrty flags
-// cummulatively record any changes to communicate globally.
+// Workers share pieces through their outer layers. Each sends
+// master {color, local root} for all its colors; master joins
+// them all and returns each color's global root.
 //
-void Split::PropagateLocally()
+void Split::JoinGlobal( CClrUF &U )
 {
-// clear cummulative dst flags
-    gdrty[wkid].L = 0;
-    gdrty[wkid].R = 0;
+    int	nc = U.clr.size();
+
+    if( nwks <= 1 ) {
+
+        U.rt.resize( nc );
+
+        for( int i = 0; i < nc; ++i )
+            U.rt[i] = U.clr[U.Find( i )];
 
-    for(;;) {
+        return;
+    }
 
-        memset( &drtyD[0], 0, zohi - zolo + 1 );
+    if( wkid > 0 ) {
 
-        /* ---------- */
-        /* Do a round */
-        /* ---------- */
+        vector<CLink>	vs;
+        vector<int>		vr( nc );
 
-        for( zs = zolo; zs <= zohi; ++zs ) {
+        for( int i = 0; i < nc; ++i )
+            vs.push_back( CLink( U.clr[i], U.clr[U.Find( i )] ) );
+
+        // send mine
+        MPISend( &nc, sizeof(int), 0, wkid );
 
-            if( drtyS[zs] )
-                Propagate1();
+        if( nc ) {
+            MPISend( &vs[0], nc * sizeof(CLink), 0, wkid );
+            MPIRecv( &vr[0], nc * sizeof(int), 0, wkid );
         }
 
-        /* ------------------ */
-        /* Neighbors touched? */
-        /* ------------------ */
+        // adopt global roots
+        U.rt = vr;
+    }
+    else {
 
-        if( wkid > 0 ) {
-            for( int iz = zLlo; iz <= zLhi; ++iz )
-                gdrty[wkid].L |= drtyD[iz];
+        vector<vector<CLink> >	vw( nwks );
+        vector<int>				v;
+        CClrUF					G;
+
+        // get each worker
+        for( int iw = 1; iw < nwks; ++iw ) {
+
+            int	n;
+
+            MPIRecv( &n, sizeof(int), iw, iw );
+            vw[iw].resize( n, CLink( 0, 0 ) );
+
+            if( n )
+                MPIRecv( &vw[iw][0], n * sizeof(CLink), iw, iw );
         }
 
-        if( wkid + 1 < nwks ) {
-            for( int iz = zRlo; iz <= zRhi; ++iz )
-                gdrty[wkid].R |= drtyD[iz];
+        // add mine
+        for( int i = 0; i < nc; ++i )
+            vw[0].push_back( CLink( U.clr[i], U.clr[U.Find( i )] ) );
+
+        // join all; links are ordered (a < b), and either end
+        // may be the sender's color, so G must know both
+        for( int iw = 0; iw < nwks; ++iw ) {
+
+            const vector<CLink>&	L = vw[iw];
+            int						n = L.size();
+
+            for( int i = 0; i < n; ++i ) {
+                v.push_back( L[i].a );
+                v.push_back( L[i].b );
+            }
         }
 
-        /* ----- */
-        /* Done? */
-        /* ----- */
+        G.Init( v );
+
+        for( int iw = 0; iw < nwks; ++iw ) {
 
-        memcpy( &drtyS[0], &drtyD[0], zohi - zolo + 1 );
+            const vector<CLink>&	L = vw[iw];
+            int						n = L.size();
 
-        int	drty = 0;
-        for( int iz = zilo; iz <= zihi; ++iz )
-            drty |= drtyD[iz];
+            for( int i = 0; i < n; ++i )
+                G.Join( L[i].a, L[i].b );
+        }
+
+        // send each worker
+        for( int iw = 1; iw < nwks; ++iw ) {
+
+            const vector<CLink>&	L = vw[iw];
+            int						n = L.size();
+            vector<int>				vr( n );
+
+            for( int i = 0; i < n; ++i )
+                vr[i] = G.Root( L[i].a );
+
+            if( n )
+                MPISend( &vr[0], n * sizeof(int), iw, iw );
+        }
 
-        if( !drty )
-            break;
+        // adopt global roots
+        U.rt.resize( nc );
+
+        for( int i = 0; i < nc; ++i )
+            U.rt[i] = G.Root( U.clr[i] );
+    }
+}
+
+/* --------------------------------------------------------------- */
+/* Relabel ------------------------------------------------------- */
+/* --------------------------------------------------------------- */
+
+// Replace inner colors by their piece's (lowest) color.
+//
+void Split::Relabel( CClrUF &U )
+{
+    for( int iz = zilo; iz <= zihi; ++iz ) {
+
+        vector<int>&	k = K[iz];
+        int				nr = vR[iz].nr;
+
+        for( int ir = 0; ir < nr; ++ir ) {
+
+            if( k[ir] )
+                k[ir] = U.rt[U.Idx( k[ir] )];
+        }
     }
 }
 
@@ -783,61 +898,24 @@ void Split::Run()
 
     ColorMontages();
 
-// Initially everything dirty
+// Get neighbors' montage colors for my outer layers
 
     gdrty.resize( nwks );
     gdrty[0].L			= 0;
     gdrty[nwks - 1].R	= 0;
 
-    drtyS.resize( zohi - zolo + 1, 1 );
-    drtyD.resize( zohi - zolo + 1, 0 );
-
-    maxspan = LayerCat_MaxSpan( vL );
-
-// Propagate colors across Z until no changes
-
-    for(;;) {
-
-        /* ---------- */
-        /* Do a round */
-        /* ---------- */
-
-        // get src data
-        KUpdt();
-
-        // set src flags
-        if( wkid > 0 && gdrty[wkid - 1].R ) {
-
-            for( int iz = zolo; iz < zilo; ++iz )
-                drtyS[iz] = 1;
-        }
+    KUpdt();
 
-        if( wkid + 1 < nwks && gdrty[wkid + 1].L ) {
-
-            for( int iz = zihi + 1; iz <= zohi; ++iz )
-                drtyS[iz] = 1;
-        }
-
-        PropagateLocally();
-
-        /* -------------- */
-        /* Done globally? */
-        /* -------------- */
-
-        GUpdt();
+    gdrty.clear();
 
-        int	drty = 0;
-        for( int iw = 0; iw < nwks; ++iw )
-            drty |= gdrty[iw].L | gdrty[iw].R;
+// Join montage colors across Z, locally then globally.
+// Each piece takes the lowest color of its montages.
 
-        if( !drty )
-            break;
-    }
+    CClrUF	U;
 
-    vzd.clear();
-    drtyD.clear();
-    drtyS.clear();
-    gdrty.clear();
+    JoinLocal( U );
+    JoinGlobal( U );
+    Relabel( U );
 
 // Split according to final coloring
 
@@ -13,6 +13,8 @@ using namespace std;
 /* Types --------------------------------------------------------- */
 /* --------------------------------------------------------------- */
 
+class CClrUF;
+
 class Split {
 public:
     const XArray&			X;
@@ -24,12 +26,12 @@ public:
 private:
     void Resize();
     void ColorMontages();
-    void GUpdt();
     bool KSend( int zlo, int zhi, int toLorR );
     bool KRecv( int zlo, int zhi, int fmLorR );
     bool KUpdt();
-    void Propagate1();
-    void PropagateLocally();
+    void JoinLocal( CClrUF &U );
+    void JoinGlobal( CClrUF &U );
+    void Relabel( CClrUF &U );
     void ReportCount( const map<int,int>& m );
     void CountColors( map<int,int>& m );
     void Save();
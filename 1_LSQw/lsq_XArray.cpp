@@ -645,137 +645,148 @@ void XArray::UpdtFS()
 }
 
 /* --------------------------------------------------------------- */
-/* Send ---------------------------------------------------------- */
+/* PackBytes ----------------------------------------------------- */
 /* --------------------------------------------------------------- */
 
-bool XArray::Send( int zlo, int zhi, int XorF, int toLorR )
+// Size of packed {X, flags} for layers [zlo, zhi].
+//
+int XArray::PackBytes( int zlo, int zhi ) const
 {
-    void	*buf;
-    int		bytes,
-            wdst;
+    int	bytes = 0;
 
-    if( toLorR == 'L' ) {
+    for( int iz = zlo; iz <= zhi; ++iz )
+        bytes += vR[iz].nr * (NE * sizeof(double) + 1);
 
-        wdst = wkid - 1;
+    return bytes;
+}
 
-        if( wdst < 0 )
-            return true;
-    }
-    else {
-        wdst = wkid + 1;
+/* --------------------------------------------------------------- */
+/* Pack ---------------------------------------------------------- */
+/* --------------------------------------------------------------- */
 
-        if( wdst >= nwks )
-            return true;
-    }
+// Pack X then flags for each layer [zlo, zhi] into buf.
+//
+void XArray::Pack( vector<char> &buf, int zlo, int zhi ) const
+{
+    buf.resize( PackBytes( zlo, zhi ) );
+
+    char	*p = &buf[0];
 
     for( int iz = zlo; iz <= zhi; ++iz ) {
 
-        if( XorF == 'X' ) {
-            buf		= (void*)&X[iz][0];
-            bytes	= sizeof(double) * X[iz].size();
-        }
-        else {
-            buf		= (void*)&vR[iz].flag[0];
-            bytes	= vR[iz].nr;
-        }
+        int	nx = X[iz].size() * sizeof(double),
+            nf = vR[iz].nr;
 
-        MPISend( buf, bytes, wdst, iz - zlo );
-    }
+        memcpy( p, &X[iz][0], nx );
+        p += nx;
 
-    return true;
+        memcpy( p, &vR[iz].flag[0], nf );
+        p += nf;
+    }
 }
 
 /* --------------------------------------------------------------- */
-/* Recv ---------------------------------------------------------- */
+/* Unpack -------------------------------------------------------- */
 /* --------------------------------------------------------------- */
 
-bool XArray::Recv( int zlo, int zhi, int XorF, int fmLorR )
+void XArray::Unpack( const vector<char> &buf, int zlo, int zhi )
 {
-    void	*buf;
-    int		bytes,
-            wsrc;
-
-    if( fmLorR == 'L' ) {
-
-        wsrc = wkid - 1;
-
-        if( wsrc < 0 )
-            return true;
-    }
-    else {
-        wsrc = wkid + 1;
-
-        if( wsrc >= nwks )
-            return true;
-    }
+    const char	*p = &buf[0];
 
     for( int iz = zlo; iz <= zhi; ++iz ) {
 
-        if( XorF == 'X' ) {
-            buf		= (void*)&X[iz][0];
-            bytes	= sizeof(double) * X[iz].size();
-        }
-        else {
-            buf		= (void*)&vR[iz].flag[0];
-            bytes	= vR[iz].nr;
-        }
+        int	nx = X[iz].size() * sizeof(double),
+            nf = vR[iz].nr;
 
-        MPIRecv( buf, bytes, wsrc, iz - zlo );
-    }
+        memcpy( &X[iz][0], p, nx );
+        p += nx;
 
-    return true;
+        memcpy( &vR[iz].flag[0], p, nf );
+        p += nf;
+    }
 }
 
 /* --------------------------------------------------------------- */
-/* Updt ---------------------------------------------------------- */
+/* UpdtStart ----------------------------------------------------- */
 /* --------------------------------------------------------------- */
 
-bool XArray::Updt()
+// Begin halo exchange with neighbor workers: one packed message
+// of {X, flags} each way per neighbor, all in flight at once.
+// Caller may compute on anything but the wing layers (and must
+// not alter the wings) until UpdtWait().
+//
+// Layers sent are copied at this call; they may be modified
+// freely thereafter.
+//
+void XArray::UpdtStart()
 {
     if( nwks <= 1 )
-        return true;
+        return;
 
-// To avoid deadlocks, we arrange that at any given time,
-// any node is just sending or just receiving. Easily done
-// by odd/even role assignment.
+    if( wkid > 0 ) {
 
-// Odd send
+        rbufL.resize( PackBytes( zolo, zilo - 1 ) );
 
-    if( wkid & 1 ) {
+        if( rbufL.size() )
+            MPIPostRecv( &rbufL[0], rbufL.size(), wkid - 1, 0 );
 
-        Send( zLlo, zLhi, 'X', 'L' );
-        Send( zLlo, zLhi, 'F', 'L' );
+        Pack( sbufL, zLlo, zLhi );
 
-        Send( zRlo, zRhi, 'X', 'R' );
-        Send( zRlo, zRhi, 'F', 'R' );
+        if( sbufL.size() )
+            MPIPostSend( &sbufL[0], sbufL.size(), wkid - 1, 0 );
     }
-    else {
 
-        Recv( zihi + 1, zohi, 'X', 'R' );
-        Recv( zihi + 1, zohi, 'F', 'R' );
+    if( wkid < nwks - 1 ) {
+
+        rbufR.resize( PackBytes( zihi + 1, zohi ) );
 
-        Recv( zolo, zilo - 1, 'X', 'L' );
-        Recv( zolo, zilo - 1, 'F', 'L' );
+        if( rbufR.size() )
+            MPIPostRecv( &rbufR[0], rbufR.size(), wkid + 1, 0 );
+
+        Pack( sbufR, zRlo, zRhi );
+
+        if( sbufR.size() )
+            MPIPostSend( &sbufR[0], sbufR.size(), wkid + 1, 0 );
     }
 
-// Even send
+    posted = true;
+}
 
-    if( !(wkid & 1) ) {
+/* --------------------------------------------------------------- */
+/* UpdtWait ------------------------------------------------------ */
+/* --------------------------------------------------------------- */
 
-        Send( zLlo, zLhi, 'X', 'L' );
-        Send( zLlo, zLhi, 'F', 'L' );
+// Complete exchange begun by UpdtStart() and fill the wings.
+//
+void XArray::UpdtWait()
+{
+    if( !posted )
+        return;
 
-        Send( zRlo, zRhi, 'X', 'R' );
-        Send( zRlo, zRhi, 'F', 'R' );
+    if( !MPIWaitPosted() ) {
+        printf( "UpdtWait: MPI exchange failed.\n" );
+        exit( 42 );
     }
-    else {
 
-        Recv( zihi + 1, zohi, 'X', 'R' );
-        Recv( zihi + 1, zohi, 'F', 'R' );
+    if( rbufL.size() )
+        Unpack( rbufL, zolo, zilo - 1 );
 
-        Recv( zolo, zilo - 1, 'X', 'L' );
-        Recv( zolo, zilo - 1, 'F', 'L' );
-    }
+    if( rbufR.size() )
+        Unpack( rbufR, zihi + 1, zohi );
+
+    posted = false;
+}
+
+/* --------------------------------------------------------------- */
+/* Updt ---------------------------------------------------------- */
+/* --------------------------------------------------------------- */
+
+// Blocking form of halo exchange.
+//
+bool XArray::Updt()
+{
+    UpdtStart();
+    UpdtWait();
 
     return true;
 }
@@ -15,15 +15,25 @@ class XArray {
 public:
     int						NE;
     vector<vector<double> >	X;
+private:
+    vector<char>			sbufL, sbufR,	// packed halo traffic
+                            rbufL, rbufR;
+    bool					posted;
 public:
+    XArray() : posted(false) {};
+
     void Resize( int ne );
     void Load( const char *path );
     void Save() const;
     void UpdtFS();
 private:
-    bool Send( int zlo, int zhi, int XorF, int toLorR );
-    bool Recv( int zlo, int zhi, int XorF, int fmLorR );
+    void Pack( vector<char> &buf, int zlo, int zhi ) const;
+    void Unpack( const vector<char> &buf, int zlo, int zhi );
+    int PackBytes( int zlo, int zhi ) const;
 public:
+    void UpdtStart();
+    void UpdtWait();
+    bool UpdtPending() const	{return posted;};
     bool Updt();
 };
 
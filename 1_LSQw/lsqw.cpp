@@ -27,7 +27,8 @@ class CArgs {
 
 public:
     double		Wr,				// Aff -> (1-Wr)*Aff + Wr*Rgd
-                Etol;			// point error tolerance
+                Etol,			// point error tolerance
+                Dtol;			// converged if tforms move less
     const char	*tempdir,		// master workspace
                 *cachedir,		// {catalog, pnts} files
                 *prior,			// start from these solutions
@@ -39,13 +40,15 @@ public:
                 regtype,		// regularizer {T,R}
                 iters,			// solve iterations
                 splitmin;		// separate islands > splitmin tiles
-    bool		untwist;		// iff prior are affines
+    bool		untwist,		// iff prior are affines
+                gs;				// Gauss-Seidel (colored) updates
 
 public:
     CArgs()
     {
         Wr			= 0.001;
         Etol		= 30;
+        Dtol		= 0;
         tempdir		= NULL;
         cachedir	= NULL;
         prior		= NULL;
@@ -58,6 +61,7 @@ public:
         iters		= 2000;
         splitmin	= 1000;
         untwist		= false;
+        gs			= false;
     };
 
     bool SetCmdLine( int argc, char* argv[] );
@@ -134,6 +138,8 @@ bool CArgs::SetCmdLine( int argc, char* argv[] )
         }
         else if( GetArg( &Etol, "-Etol=%lf", argv[i] ) )
             printf( "Error  tol: %g\n", Etol );
+        else if( GetArg( &Dtol, "-dtol=%lf", argv[i] ) )
+            printf( "Delta  tol: %g\n", Dtol );
         else if( GetArg( &iters, "-iters=%d", argv[i] ) )
             printf( "Iterations: %d\n", iters );
         else if( GetArg( &splitmin, "-splitmin=%d", argv[i] ) )
@@ -142,6 +148,8 @@ bool CArgs::SetCmdLine( int argc, char* argv[] )
             printf( "Maxthreads: %d\n", maxthreads );
         else if( IsArg( "-untwist", argv[i] ) )
             untwist = true;
+        else if( IsArg( "-gs", argv[i] ) )
+            gs = true;
         else {
             printf( "Did not understand option '%s'.\n", argv[i] );
             return false;
@@ -277,6 +285,14 @@ int main( int argc, char **argv )
         exit( 42 );
     }
 
+// Worker pool shared by solver passes and reporting
+
+    if( !thrpool.Start( maxthreads, 1, "lsqw" ) ) {
+
+        MPIExit();
+        exit( 42 );
+    }
+
 /* ------------ */
 /* Initial data */
 /* ------------ */
@@ -302,7 +318,8 @@ int main( int argc, char **argv )
 
     printf( "\n---- Solve ----\n" );
 
-    SetSolveParams( gArgs.regtype, gArgs.Wr, gArgs.Etol );
+    SetSolveParams( gArgs.regtype, gArgs.Wr, gArgs.Etol,
+        gArgs.Dtol, gArgs.gs );
 
     XArray	Xevn, Xodd;
 
@@ -314,7 +331,7 @@ int main( int argc, char **argv )
             UntwistAffines( Xevn );
 
         Xodd.Resize( 6 );
-        Solve( Xevn, Xodd, gArgs.iters );
+        gArgs.iters = Solve( Xevn, Xodd, gArgs.iters );
     }
     else if( !strcmp( gArgs.mode, "A2H" ) ) {
 
@@ -332,13 +349,13 @@ int main( int argc, char **argv )
         }
 
         Xodd.Resize( 8 );
-        Solve( Xevn, Xodd, gArgs.iters );
+        gArgs.iters = Solve( Xevn, Xodd, gArgs.iters );
     }
     else if( !strcmp( gArgs.mode, "H2H" ) ) {
 
         Xevn.Load( gArgs.prior );
         Xodd.Resize( 8 );
-        Solve( Xevn, Xodd, gArgs.iters );
+        gArgs.iters = Solve( Xevn, Xodd, gArgs.iters );
     }
     else if( !strcmp( gArgs.mode, "eval" ) ) {
 
@@ -379,6 +396,8 @@ int main( int argc, char **argv )
 /* Cleanup */
 /* ------- */
 
+    thrpool.Stop();
+
     if( !wkid ) {
         printf( "\n" );
         StopTiming( stdout, "Lsq", t0 );
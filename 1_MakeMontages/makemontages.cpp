@@ -86,6 +86,7 @@ public:
                 *exenam;
     int			zmin,
                 zmax;
+    bool		batch;
 
 public:
     CArgs_scr()
@@ -95,6 +96,7 @@ public:
         exenam		= "ptest";
         zmin		= 0;
         zmax		= 32768;
+        batch		= false;
     };
 
     void SetCmdLine( int argc, char* argv[] );
@@ -163,6 +165,8 @@ void CArgs_scr::SetCmdLine( int argc, char* argv[] )
             idb=pchar;
         else if( GetArgStr( exenam, "-exe=", argv[i] ) )
             ;
+        else if( IsArg( "-batch", argv[i] ) )
+            batch = true;
         else if( GetArgList( vi, "-z=", argv[i] ) ) {
 
             if( 2 == vi.size() ) {
@@ -435,8 +439,15 @@ static void WriteSSubNFile()
     fprintf( f, "#!/bin/sh\n" );
     fprintf( f, "\n" );
     fprintf( f, "# Purpose:\n" );
-    fprintf( f, "# For layer range, submit all make.same and use the make option -j <n>\n" );
-    fprintf( f, "# to set number of concurrent jobs.\n" );
+    if( gArgs.batch ) {
+        fprintf( f, "# For layer range, submit each make.same block as one batch ptest job\n" );
+        fprintf( f, "# that loads and conditions each tile image only once.\n" );
+        fprintf( f, "# Batch jobs run their pairs serially, so take just one slot.\n" );
+    }
+    else {
+        fprintf( f, "# For layer range, submit all make.same and use the make option -j <n>\n" );
+        fprintf( f, "# to set number of concurrent jobs.\n" );
+    }
     fprintf( f, "#\n" );
     fprintf( f, "# > ./ssub.sht <zmin> [zmax]\n" );
     fprintf( f, "\n" );
@@ -465,7 +476,10 @@ static void WriteSSubNFile()
     fprintf( f, "\t\tfor jb in $(ls -d * | grep -E 'S[0-9]{1,}_[0-9]{1,}')\n" );
     fprintf( f, "\t\tdo\n" );
     fprintf( f, "\t\t\tcd $jb\n" );
-    fprintf( f, "\t\t\tQSUB_1NODE.sht 2 \"q$jb-$lyr\" \"\" 1 $nslot \"make -f make.same -j $nproc EXTRA='\"\"'\"\n" );
+    if( gArgs.batch )
+        fprintf( f, "\t\t\tQSUB_1NODE.sht 2 \"q$jb-$lyr\" \"\" 1 1 \"%s -batch=make.same\"\n", gArgs.exenam );
+    else
+        fprintf( f, "\t\t\tQSUB_1NODE.sht 2 \"q$jb-$lyr\" \"\" 1 $nslot \"make -f make.same -j $nproc EXTRA='\"\"'\"\n" );
     fprintf( f, "\t\t\tcd ..\n" );
     fprintf( f, "\t\tdone\n" );
     fprintf( f, "\n" );
@@ -493,8 +507,15 @@ static void WriteDSubNFile()
     fprintf( f, "#!/bin/sh\n" );
     fprintf( f, "\n" );
     fprintf( f, "# Purpose:\n" );
-    fprintf( f, "# For layer range, submit all make.down and use the make option -j <n>\n" );
-    fprintf( f, "# to set number of concurrent jobs.\n" );
+    if( gArgs.batch ) {
+        fprintf( f, "# For layer range, submit each make.down block as one batch ptest job\n" );
+        fprintf( f, "# that loads and conditions each tile image only once.\n" );
+        fprintf( f, "# Batch jobs run their pairs serially, so take just one slot.\n" );
+    }
+    else {
+        fprintf( f, "# For layer range, submit all make.down and use the make option -j <n>\n" );
+        fprintf( f, "# to set number of concurrent jobs.\n" );
+    }
     fprintf( f, "#\n" );
     fprintf( f, "# > ./dsub.sht <zmin> [zmax]\n" );
     fprintf( f, "\n" );
@@ -526,7 +547,10 @@ static void WriteDSubNFile()
     fprintf( f, "\n" );
     fprintf( f, "\t\t\tif [ -e make.down ]\n" );
     fprintf( f, "\t\t\tthen\n" );
-    fprintf( f, "\t\t\t\tQSUB_1NODE.sht 3 \"q$jb-$lyr\" \"\" 1 $nslot \"make -f make.down -j $nproc EXTRA='\"\"'\"\n" );
+    if( gArgs.batch )
+        fprintf( f, "\t\t\t\tQSUB_1NODE.sht 3 \"q$jb-$lyr\" \"\" 1 1 \"%s -batch=make.down\"\n", gArgs.exenam );
+    else
+        fprintf( f, "\t\t\t\tQSUB_1NODE.sht 3 \"q$jb-$lyr\" \"\" 1 $nslot \"make -f make.down -j $nproc EXTRA='\"\"'\"\n" );
     fprintf( f, "\t\t\tfi\n" );
     fprintf( f, "\n" );
     fprintf( f, "\t\t\tcd ..\n" );
@@ -1014,15 +1038,22 @@ void BlockSet::PartitionJobs( int is0, int isN )
     K.clear();
     K.resize( nb );
 
-    int	W2 = gW/2,
-        H2 = gH/2;
+    vector<Point>	cnr;
+    vector<int>		vb;
+    int				W2 = gW/2,
+                    H2 = gH/2;
+
+    TS.IndexLayer( is0, isN );
+    Set4Corners( cnr, gW, gH );
 
     for( int a = is0; a < isN; ++a ) {
 
-        Point	pa( W2, H2 );
-        int		ix, iy, rowa, cola;
+        Point			pa( W2, H2 );
+        vector<Point>	c = cnr;
+        int				ix, iy, rowa, cola;
 
         TS.vtil[a].T.Transform( pa );
+        TS.vtil[a].T.Transform( c );
 
         ix = int(pa.x / dx);
 
@@ -1044,7 +1075,16 @@ void BlockSet::PartitionJobs( int is0, int isN )
             rowa = TS.vtil[a].row;
         }
 
-        for( int b = a + 1; b < isN; ++b ) {
+        TS.TilesOverlapping( vb, c, tsOlapPad );
+
+        int	nc = vb.size();
+
+        for( int ib = 0; ib < nc; ++ib ) {
+
+            int	b = vb[ib];
+
+            if( b <= a )
+                continue;
 
             if( scr.ignorecorners ) {
 
@@ -178,8 +178,10 @@ public:
                 *bmap_dir;
     int			scale,
                 x0, y0, xsize, ysize,
-                lspec1, lspec2;
+                lspec1, lspec2,
+                slvthr;
     bool		debug,
+                slu,
                 strings,
                 warp,
                 foldmasks,
@@ -209,7 +211,9 @@ public:
         ysize				= -1;
         lspec1				= -1;		// user's layer range
         lspec2				= -1;
+        slvthr				= 0;		// in-process solver threads
         debug				= false;
+        slu					= false;	// external SuperLU solver
         strings				= false;
         warp				= false;	// seam healing
         foldmasks			= true;
@@ -304,6 +308,10 @@ void CArgs_mos::SetCmdLine( int argc, char* argv[] )
             ;
         else if( GetArg( &scale, "-s=%d", argv[i] ) )
             ;
+        else if( GetArg( &slvthr, "-slvthr=%d", argv[i] ) )
+            ;
+        else if( IsArg( "-slu", argv[i] ) )
+            slu = true;
         else if( IsArg( "-d", argv[i] ) )
             debug = true;
         else if( IsArg( "-strings", argv[i] ) )
@@ -3777,7 +3785,11 @@ for(int out_layer = lowest; out_layer <= highest; out_layer++) {  //keep going u
     // Solve the system
     vector<double> X(2*nvs);
     fflush(stdout);
-    WriteSolveRead( X, norm_mat, RHS, "A-mos", 1, !gArgs.debug );
+    // SuperLU unless in-process solver requested with -slvthr
+    bool	pcg = (gArgs.slvthr > 0 && !gArgs.slu);
+    WriteSolveRead( X, norm_mat, RHS, "A-mos",
+        (pcg ? gArgs.slvthr : 1), !gArgs.debug,
+        (pcg ? 'C' : 'S') );
     PrintMagnitude( X );
     fflush(stdout);
 
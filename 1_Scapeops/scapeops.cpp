@@ -7,7 +7,12 @@
 //
 //	If drawing a montage...
 //
-//	-mb -zb=%d
+//	-mb -zb=%d [-mbtif=tile]
+//
+// -mbtif paints the montage out-of-core, straight to a tiled TIFF
+// (montages/M_%d_0.tif) of tile x tile tiles (multiple of 16),
+// instead of an in-memory png. Source tile cache budget is env
+// ScapeCacheMB, else 1024. Note cross_lowres stacks list the png.
 //
 // If aligning strips...
 //
@@ -27,6 +32,7 @@
 #include	"Memory.h"
 #include	"Debug.h"
 
+#include	<stdlib.h>
 #include	<string.h>
 
 
@@ -50,7 +56,7 @@ class CSuperscape {
 
 public:
     DBox	B;			// oriented bounding box
-    Point	Opts;		// origin of aligned point list
+    Point	Opts;		// origin of aligned dense image
     double	x0, y0;		// scape corner in oriented system
     uint8	*ras;		// scape pixels
     uint32	ws, hs;		// scape dims
@@ -90,12 +96,13 @@ public:
     void OrientLayer();
 
     bool MakeWholeRaster();
+    bool MakeWholeTif( const char *name );
     bool MakeRasV();
     bool MakeRasH();
 
     void WriteMeta( char clbl, int z );
 
-    void MakePoints( vector<double> &v, vector<Point> &p );
+    void MakeDense( DenseImg &I );
 };
 
 /* --------------------------------------------------------------- */
@@ -110,7 +117,8 @@ public:
     const char	*srcmons,
                 *script;
     int			za,
-                zb;
+                zb,
+                mbtile;
     bool		ismb,
                 isab,
                 abdbg,
@@ -124,6 +132,7 @@ public:
         script		= NULL;
         za			= -1;
         zb			= -1;
+        mbtile		= 0;
         ismb		= false;
         isab		= false;
         abdbg		= false;
@@ -215,6 +224,8 @@ void CArgs_scp::SetCmdLine( int argc, char* argv[] )
             ;
         else if( GetArg( &abctr, "-abctr=%lf", argv[i] ) )
             ;
+        else if( GetArg( &mbtile, "-mbtif=%d", argv[i] ) )
+            ;
         else if( IsArg( "-mb", argv[i] ) )
             ismb = true;
         else if( IsArg( "-ab", argv[i] ) )
@@ -325,6 +336,33 @@ bool CSuperscape::MakeWholeRaster()
     return (ras != NULL);
 }
 
+/* --------------------------------------------------------------- */
+/* MakeWholeTif -------------------------------------------------- */
+/* --------------------------------------------------------------- */
+
+// As MakeWholeRaster, but painted straight to tiled TIFF (name)
+// without holding the whole montage in memory.
+//
+bool CSuperscape::MakeWholeTif( const char *name )
+{
+    vector<int>	vid( isN - is0 );
+
+    for( int i = is0; i < isN; ++i )
+        vid[i - is0] = i;
+
+    const char	*s		= getenv( "ScapeCacheMB" );
+    int			cacheMB	= (s ? atoi( s ) : 0);
+
+    if( cacheMB <= 0 )
+        cacheMB = 1024;
+
+    return TS.ScapeToTif( name, ws, hs, x0, y0,
+            vid, inv_scl, 1, 0,
+            scr.legendremaxorder, scr.rendersdevcnts,
+            scr.maskoutresin, scr.stripslots,
+            gArgs.mbtile, cacheMB );
+}
+
 /* --------------------------------------------------------------- */
 /* MakeRasV ------------------------------------------------------ */
 /* --------------------------------------------------------------- */
@@ -416,48 +454,74 @@ void CSuperscape::WriteMeta( char clbl, int z )
 }
 
 /* --------------------------------------------------------------- */
-/* MakePoints ---------------------------------------------------- */
+/* MakeDense ----------------------------------------------------- */
 /* --------------------------------------------------------------- */
 
-void CSuperscape::MakePoints( vector<double> &v, vector<Point> &p )
+// Crop scape to bbox of its non-zero pixels, which become the
+// valid pixels of I. I has origin (0,0) and Opts is the crop
+// corner in scape coords.
+//
+void CSuperscape::MakeDense( DenseImg &I )
 {
-// collect point and value lists
+// get bbox of non-zero pixels
+
+    int	xlo = ws, xhi = -1, ylo = hs, yhi = -1;
 
-    int		np = ws * hs;
+    for( int iy = 0; iy < hs; ++iy ) {
 
-    for( int i = 0; i < np; ++i ) {
+        const uint8	*row = &ras[ws*iy];
 
-        if( ras[i] ) {
+        for( int ix = 0; ix < ws; ++ix ) {
 
-            int	iy = i / ws,
-                ix = i - ws * iy;
+            if( row[ix] ) {
 
-            v.push_back( ras[i] );
-            p.push_back( Point( ix, iy ) );
+                if( ix < xlo )
+                    xlo = ix;
+
+                if( ix > xhi )
+                    xhi = ix;
+
+                if( iy < ylo )
+                    ylo = iy;
+
+                yhi = iy;
+            }
         }
     }
 
-    if( !(np = p.size()) ) {
+    if( xhi < 0 ) {
         fprintf( flog, "FAIL: Block has no non-zero pixels.\n" );
         exit( 42 );
     }
 
-// get points origin and translate to zero
+    Opts = Point( xlo, ylo );
+
+// copy cropped pixels and mask
 
-    DBox	bb;
+    I.x0	= 0;
+    I.y0	= 0;
+    I.w		= xhi - xlo + 1;
+    I.h		= yhi - ylo + 1;
 
-    BBoxFromPoints( bb, p );
-    Opts = Point( bb.L, bb.B );
+    I.v.resize( I.w * I.h );
+    I.m.resize( I.w * I.h );
 
-    for( int i = 0; i < np; ++i ) {
+    for( int iy = 0; iy < I.h; ++iy ) {
 
-        p[i].x -= Opts.x;
-        p[i].y -= Opts.y;
+        const uint8	*row = &ras[xlo + ws*(ylo + iy)];
+
+        for( int ix = 0; ix < I.w; ++ix ) {
+
+            int	i = ix + I.w*iy;
+
+            I.v[i] = row[ix];
+            I.m[i] = (row[ix] != 0);
+        }
     }
 
 // normalize values
 
-    if( !Normalize( v ) ) {
+    if( !I.Normalize() ) {
         fprintf( flog, "FAIL: Scape stdev = 0.\n" );
         exit( 42 );
     }
@@ -521,10 +585,10 @@ static int AlignWithStrips(
 
     t0 = StopTiming( flog, "MakeStrips", t0 );
 
-    A.MakePoints( thm.av, thm.ap );
+    A.MakeDense( thm.a );
     A.WriteMeta( 'A', gArgs.za );
 
-    B.MakePoints( thm.bv, thm.bp );
+    B.MakeDense( thm.b );
     B.WriteMeta( 'B', gArgs.zb );
 
     thm.ftc.clear();
@@ -539,6 +603,7 @@ static int AlignWithStrips(
     S.SetSweepPretweak( true );
     S.SetSweepNThreads( scr.stripslots );
     S.SetUseCorrR( true );
+    S.SetSweepFMCand( scr.stripsweepfm );
     S.SetNewAngProc( StripAngProc );
 
     gA = &A;
@@ -607,7 +672,7 @@ static void AlignFull(
     sprintf( buf, "strips/AF_%d.png", gArgs.za );
     A.DrawRas( buf );
 
-    if( gArgs.ismb ) {
+    if( gArgs.ismb && !gArgs.mbtile ) {
         B = M;
         sprintf( buf, "montages/M_%d_0.png", gArgs.zb );
         B.Load( buf, flog );
@@ -620,10 +685,10 @@ static void AlignFull(
 
     t0 = StopTiming( flog, "MakeFull", t0 );
 
-    A.MakePoints( thm.av, thm.ap );
+    A.MakeDense( thm.a );
     A.WriteMeta( 'A', gArgs.za );
 
-    B.MakePoints( thm.bv, thm.bp );
+    B.MakeDense( thm.b );
     B.WriteMeta( 'B', gArgs.zb );
 
     thm.ftc.clear();
@@ -638,6 +703,7 @@ static void AlignFull(
     S.SetSweepPretweak( true );
     S.SetSweepNThreads( scr.stripslots );
     S.SetUseCorrR( true );
+    S.SetSweepFMCand( scr.stripsweepfm );
     S.SetDisc( 0, 0, -1, -1 );
 
     gA = &A;
@@ -729,10 +795,22 @@ static void ScapeStuff()
 
         fprintf( flog, "\n---- Paint montage ----\n" );
 
-        B.MakeWholeRaster();
-        sprintf( buf, "montages/M_%d_0.png", gArgs.zb );
-        B.DrawRas( buf );
-        B.KillRas();
+        if( gArgs.mbtile ) {
+
+            sprintf( buf, "montages/M_%d_0.tif", gArgs.zb );
+
+            if( !B.MakeWholeTif( buf ) ) {
+                fprintf( flog, "Montage tif failed [%s].\n", buf );
+                exit( 42 );
+            }
+        }
+        else {
+            B.MakeWholeRaster();
+            sprintf( buf, "montages/M_%d_0.png", gArgs.zb );
+            B.DrawRas( buf );
+            B.KillRas();
+        }
+
         B.WriteMeta( 'M', gArgs.zb );
         M = B;	// reuse montage metadata in AlignFull
         t0 = StopTiming( flog, "MakeMontage", t0 );
@@ -5,6 +5,7 @@
 #include	"Cmdline.h"
 #include	"File.h"
 #include	"CAffineLens.h"
+#include	"Correlation.h"
 #include	"Debug.h"
 
 
@@ -128,6 +129,8 @@ bool CGBL_Thumbs::SetCmdLine( int argc, char* argv[] )
             arg.SingleFold = true;
         else if( IsArg( "-dbgcor", argv[i] ) )
             dbgCor = true;
+        else if( IsArg( "-corrf", argv[i] ) )
+            corrFloat = true;
         else {
             printf( "Did not understand option '%s'.\n", argv[i] );
             return false;
@@ -8,6 +8,7 @@
 #include	"Disk.h"
 #include	"File.h"
 #include	"ImageIO.h"
+#include	"ImgPrefetch.h"
 #include	"Maths.h"
 #include	"TAffine.h"
 #include	"CMask.h"
@@ -353,25 +354,45 @@ static void DoChannel( FILE* fout, int &z, int chan )
     FILE		*frick = FileOpenOrDie( rick, "r" );
     CLineScan	LS;
 
-// For each line...
-// Get its image-name, x, y
-// Do pixel ops on that image and write it to FF folder
-// Output new full path to modified image
-// Output rescaled x, y and updated z
+// Collect each line's image-name, x, y; forcing channel name.
+// Images are then read ahead while earlier ones are processed.
+
+    vector<string>	vname, vpath;
+    vector<Point>	vxy;
 
     while( LS.Get( frick ) > 0 ) {
 
         char	path[2048], name[64];
         double	x, y;
-        int		lname;
 
-        // Get native line data
         sscanf( LS.line, "%s%lf%lf", name, &x, &y );
+        name[strlen( name ) - 5] = '0' + chan;
+        sprintf( path, "%s/%s", tifdir, name );
 
-        lname = strlen( name );
+        vname.push_back( name );
+        vpath.push_back( path );
+        vxy.push_back( Point( x, y ) );
+    }
 
-        // Force channel name
-        name[lname - 5] = '0' + chan;
+    fclose( frick );
+
+    ImgPrefetch	PF;
+    int			nl = vname.size();
+
+    PF.Start( vpath, pfRas16, 0, 0, 0, flog );
+
+// For each line...
+// Do pixel ops on that image and write it to FF folder
+// Output new full path to modified image
+// Output rescaled x, y and updated z
+
+    for( int il = 0; il < nl; ++il ) {
+
+        char		path[2048];
+        const char	*name	= vname[il].c_str();
+        double		x		= vxy[il].x,
+                    y		= vxy[il].y;
+        int			lname	= vname[il].size();
 
         // Get well tag length and test change
         int	len = strchr( name, '_' ) - name;
@@ -382,12 +403,11 @@ static void DoChannel( FILE* fout, int &z, int chan )
             ++z;
         }
 
-        // Read the image
-        sprintf( path, "%s/%s", tifdir, name );
-        uint16*	ras = Raster16FromTif16( path, gW, gH, flog );
+        // Get the image
+        uint16*	ras = (uint16*)PF.Next( gW, gH );
 
         if( !ras ) {
-            fprintf( flog, "Missing image=[%s]\n", path );
+            fprintf( flog, "Missing image=[%s]\n", vpath[il].c_str() );
             continue;
         }
 
@@ -417,8 +437,6 @@ static void DoChannel( FILE* fout, int &z, int chan )
 
         RasterFree( ras );
     }
-
-    fclose( frick );
 }
 
 /* --------------------------------------------------------------- */
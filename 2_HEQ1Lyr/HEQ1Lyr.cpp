@@ -12,6 +12,7 @@
 #include	"File.h"
 #include	"TrakEM2_UTL.h"
 #include	"ImageIO.h"
+#include	"ImgPrefetch.h"
 #include	"Maths.h"
 #include	"TAffine.h"
 #include	"Timer.h"
@@ -284,24 +285,36 @@ static void WriteImages(
     int						smin,
     int						smax )
 {
-    double	scale	= 255.0 / log((double)smax - smin);
-    int		np		= vp.size(),
-            npx		= gW * gH;
+    double			scale	= 255.0 / log((double)smax - smin);
+    vector<string>	vpath;
+    vector<int>		vi;
+    ImgPrefetch		PF;
+    int				np		= vp.size(),
+                    npx		= gW * gH;
+
+// images are read ahead
 
     for( int i = 0; i < np; ++i ) {
 
-        const Picture	&p = vp[i];
-        char			buf[2048];
+        if( DskExists( vp[i].fname.c_str() ) ) {
+            vpath.push_back( vp[i].fname );
+            vi.push_back( i );
+        }
+    }
 
-        if( !DskExists( p.fname.c_str() ) )
-            continue;
+    PF.Start( vpath, pfRas16, 0, 0, 0, flog );
+
+    np = vi.size();
+
+    for( int k = 0; k < np; ++k ) {
+
+        const Picture	&p = vp[vi[k]];
+        char			buf[2048];
 
         MakeFolder( p );
 
         uint32	w, h;
-        uint16*	ras = Raster16FromTif16(
-                        p.fname.c_str(),
-                        w, h, flog );
+        uint16*	ras = (uint16*)PF.Next( w, h );
 
         vector<uint8>	i8( npx );
 
@@ -339,20 +352,25 @@ static void ScaleLayer( const vector<Picture> &vp )
     int				np   = vp.size(),
                     T, imin, smin, smax;
 
-// histogram whole layer
+// histogram whole layer; images are read ahead
+
+    vector<string>	vpath;
+    ImgPrefetch		PF;
 
     for( int i = 0; i < np; ++i ) {
 
-        if( !InROI( vp[i] ) )
-            continue;
+        if( InROI( vp[i] ) && DskExists( vp[i].fname.c_str() ) )
+            vpath.push_back( vp[i].fname );
+    }
 
-        if( !DskExists( vp[i].fname.c_str() ) )
-            continue;
+    PF.Start( vpath, pfRas16, 0, 0, 0, flog );
+
+    np = vpath.size();
+
+    for( int i = 0; i < np; ++i ) {
 
         uint32	w, h;
-        uint16*	ras = Raster16FromTif16(
-                        vp[i].fname.c_str(),
-                        w, h, flog );
+        uint16*	ras = (uint16*)PF.Next( w, h );
 
         Histogram( uflo, oflo, &bins[0], nbins,
             0.0, nbins, ras, w * h, false );
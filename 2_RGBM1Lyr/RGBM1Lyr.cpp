@@ -21,6 +21,7 @@
 #include	"File.h"
 #include	"TrakEM2_UTL.h"
 #include	"ImageIO.h"
+#include	"ImgPrefetch.h"
 #include	"Maths.h"
 #include	"TAffine.h"
 #include	"Timer.h"
@@ -382,17 +383,30 @@ static void Scale1Clr(
     }
     else {
 
-        // whole layer
+        // whole layer; images are read ahead
+
+        vector<string>	vpath;
+        ImgPrefetch		PF;
 
         for( int i = 0; i < np; ++i ) {
 
-            uint16*	ras;
+            char	buf[2048];
 
             if( !InROI( vp[i] ) )
                 continue;
 
-            if( !GetRas16( ras, vp[i], gArgs.RGB[rgb] ) )
-                continue;
+            if( DskExists( ChanName( buf, vp[i], gArgs.RGB[rgb] ) ) )
+                vpath.push_back( buf );
+        }
+
+        PF.Start( vpath, pfRas16, 0, 0, 0, flog );
+
+        np = vpath.size();
+
+        for( int i = 0; i < np; ++i ) {
+
+            uint32	w, h;
+            uint16*	ras = (uint16*)PF.Next( w, h );
 
             Histogram( uflo, oflo, &bins[0], nbins,
                 0.0, nbins, ras, gW * gH, false );
@@ -0,0 +1,166 @@
+// Regression check of single (corrFloat) versus double precision
+// CorrImagesF/R on an image pair. A is the central half of imgA,
+// B is all of imgB. Exits 1 if the results disagree.
+//
+// Usage: corrcheck imgA imgB [Ox Oy Rx Ry]
+//
+
+
+#include	"Correlation.h"
+#include	"ImageIO.h"
+#include	"Maths.h"
+
+#include	<math.h>
+#include	<stdlib.h>
+
+
+
+
+
+
+/* --------------------------------------------------------------- */
+/* Constants ----------------------------------------------------- */
+/* --------------------------------------------------------------- */
+
+const double	kTolR	= 1e-3;		// |r_f - r_d|
+const double	kTolXY	= 0.05;		// |dx_f - dx_d| pixels
+
+/* --------------------------------------------------------------- */
+/* Statics ------------------------------------------------------- */
+/* --------------------------------------------------------------- */
+
+static vector<Point>	ap, bp;
+static vector<double>	av, bv;
+static int				reqArea;
+
+/* --------------------------------------------------------------- */
+/* BigEnough ----------------------------------------------------- */
+/* --------------------------------------------------------------- */
+
+static bool BigEnough( int sx, int sy, void *a )
+{
+    return (long)sx * sy > reqArea;
+}
+
+/* --------------------------------------------------------------- */
+/* LoadPts ------------------------------------------------------- */
+/* --------------------------------------------------------------- */
+
+// Load normalized image pixels as points, only the central
+// half if center.
+//
+static void LoadPts(
+    vector<Point>	&vp,
+    vector<double>	&vv,
+    const char		*name,
+    bool			center )
+{
+    uint32	w, h;
+    uint8	*ras = Raster8FromAny( name, w, h );
+
+    int	x0 = 0, y0 = 0, x1 = w, y1 = h;
+
+    if( center ) {
+        x0 = w / 4;
+        x1 = x0 + w / 2;
+        y0 = h / 4;
+        y1 = y0 + h / 2;
+    }
+
+    for( int y = y0; y < y1; ++y ) {
+
+        for( int x = x0; x < x1; ++x ) {
+
+            vp.push_back( Point( x, y ) );
+            vv.push_back( ras[x + w*y] );
+        }
+    }
+
+    RasterFree( ras );
+
+    Normalize( vv );
+}
+
+/* --------------------------------------------------------------- */
+/* Run ----------------------------------------------------------- */
+/* --------------------------------------------------------------- */
+
+static double Run(
+    double	&dx,
+    double	&dy,
+    bool	F,
+    int		Ox,
+    int		Oy,
+    int		Rx,
+    int		Ry )
+{
+    CorrCtxB	ctxb;
+
+    if( F ) {
+        return CorrImagesF(
+            stdout, false, dx, dy,
+            ap, av, bp, bv,
+            BigEnough, NULL, NULL, NULL,
+            0.0, 0.9, Ox, Oy, Rx, Ry, ctxb );
+    }
+
+    return CorrImagesR(
+        stdout, false, dx, dy,
+        ap, av, bp, bv,
+        BigEnough, NULL, NULL, NULL,
+        0.0, 0.9, Ox, Oy, Rx, Ry, ctxb );
+}
+
+/* --------------------------------------------------------------- */
+/* main ---------------------------------------------------------- */
+/* --------------------------------------------------------------- */
+
+int main( int argc, char **argv )
+{
+    if( argc != 3 && argc != 7 ) {
+        printf( "Usage: corrcheck imgA imgB [Ox Oy Rx Ry]\n" );
+        return 42;
+    }
+
+    int	Ox = 0, Oy = 0, Rx = -1, Ry = -1;
+
+    if( argc == 7 ) {
+        Ox = atoi( argv[3] );
+        Oy = atoi( argv[4] );
+        Rx = atoi( argv[5] );
+        Ry = atoi( argv[6] );
+    }
+
+    LoadPts( ap, av, argv[1], true );
+    LoadPts( bp, bv, argv[2], false );
+
+    reqArea = ap.size() / 4;
+
+    int	bad = 0;
+
+    for( int F = 0; F < 2; ++F ) {
+
+        double	rd, xd, yd, rf, xf, yf;
+
+        corrFloat = false;
+        rd = Run( xd, yd, F, Ox, Oy, Rx, Ry );
+
+        corrFloat = true;
+        rf = Run( xf, yf, F, Ox, Oy, Rx, Ry );
+
+        bool	ok = fabs( rf - rd ) <= kTolR &&
+                    fabs( xf - xd ) <= kTolXY &&
+                    fabs( yf - yd ) <= kTolXY;
+
+        printf( "%s: double r=%.6f (%.3f,%.3f)"
+        " float r=%.6f (%.3f,%.3f) %s\n",
+        (F ? "CorrImagesF" : "CorrImagesR"),
+        rd, xd, yd, rf, xf, yf, (ok ? "OK" : "MISMATCH") );
+
+        bad += !ok;
+    }
+
+    return (bad ? 1 : 0);
+}
+
+
@@ -39,7 +39,7 @@ typedef struct {
 typedef struct {
     vector<double>	av, bv;
     vector<Point>	apts, bpts;
-    vector<CD>		ftc;	// fourier transform cache
+    CorrCtxB		ftc;	// B-side correlation cache
     long			reqArea;
     int				scl;
 } Thumbs;
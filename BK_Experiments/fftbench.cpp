@@ -0,0 +1,80 @@
+// Times FFT-based correlation workspaces sized by CeilPow2
+// versus FFTSize, to confirm FFTSize choices on this host.
+//
+// Usage: fftbench [reps]
+//
+
+
+#include	"Correlation.h"
+#include	"Maths.h"
+#include	"Timer.h"
+
+#include	<stdlib.h>
+
+
+
+
+
+
+/* --------------------------------------------------------------- */
+/* Statics ------------------------------------------------------- */
+/* --------------------------------------------------------------- */
+
+// Typical thumbnail and block-block overlap dims
+static const int	vn[] = {200, 300, 550, 700, 1100, 1500, 2100};
+
+/* --------------------------------------------------------------- */
+/* TimeCorr ------------------------------------------------------ */
+/* --------------------------------------------------------------- */
+
+// Return seconds per forward+inverse pair on NxN workspace.
+//
+static double TimeCorr( int N, int reps )
+{
+    vector<double>	in( N * N ), out;
+    vector<CD>		ft;
+
+    for( int i = 0; i < N * N; ++i )
+        in[i] = rand() % 256;
+
+// Warm up plan caches
+
+    FFT_2D( ft, in, N, N, false, stdout );
+    IFT_2D( out, ft, N, N, stdout );
+
+    clock_t	t0 = StartTiming();
+
+    for( int i = 0; i < reps; ++i ) {
+        FFT_2D( ft, in, N, N, false, stdout );
+        IFT_2D( out, ft, N, N, stdout );
+    }
+
+    return DeltaSeconds( t0 ) / reps;
+}
+
+/* --------------------------------------------------------------- */
+/* main ---------------------------------------------------------- */
+/* --------------------------------------------------------------- */
+
+int main( int argc, char **argv )
+{
+    int	reps = (argc > 1 ? atoi( argv[1] ) : 50);
+
+    printf( "    n  pow2  smooth   t_pow2(ms) t_smooth(ms)  ratio\n" );
+
+    for( int i = 0; i < sizeof(vn) / sizeof(int); ++i ) {
+
+        int		n	= vn[i],
+                N2	= CeilPow2( 2 * n - 1 ),
+                Ns	= FFTSize( n, n );
+        double	t2	= TimeCorr( N2, reps ),
+                ts	= TimeCorr( Ns, reps );
+
+        printf( "%5d %5d %7d %12.3f %12.3f %6.2f\n",
+        n, N2, Ns, 1000 * t2, 1000 * ts, ts / t2 );
+    }
+
+    return 0;
+}
+
+